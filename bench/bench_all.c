@@ -0,0 +1,817 @@
+/// Single compilation unit comprising the benchmarks of the Alloha library.
+///
+/// Every allocator operation is timed individually and recorded into a latency histogram, so that
+/// the reported percentiles show the tail latency and not only the average. Each thread records
+/// into its own histograms, which are merged once all threads are done.
+///
+/// By default the benchmarks run in a closed loop: the next operation starts as soon as the
+/// previous one finishes. With `--rate`, the benchmarks run in an open loop instead: operations are
+/// scheduled at a fixed rate and latencies are measured from the *scheduled* start time, so that
+/// a stall delaying subsequent operations is accounted for in all of them (avoiding coordinated
+/// omission).
+///
+/// Usage: bench_all [--threads <count>] [--iterations <count>] [--rate <operations per second>]
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include "../src/all.c"
+
+#include <alloha/arena.h>
+#include <alloha/context.h>
+#include <alloha/core.h>
+#include <alloha/down_arena.h>
+#include <alloha/fiber_stack.h>
+#include <alloha/gc.h>
+#include <alloha/jobs.h>
+#include <alloha/recycle_arena.h>
+#include <alloha/region.h>
+#include <alloha/sample.h>
+#include <alloha/stack.h>
+#include <alloha/temp.h>
+#include <alloha/thread.h>
+#include <alloha/vmem.h>
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#    define WIN32_LEAN_AND_MEAN
+#    include <windows.h>
+#else
+#    include <time.h>
+#endif
+
+#if defined(__linux__)
+#    include <linux/perf_event.h>
+#    include <sys/ioctl.h>
+#    include <sys/syscall.h>
+#    include <unistd.h>
+#endif
+
+#include "histogram.c"
+
+#define BENCH_MAX_OPS            4
+#define BENCH_DEFAULT_ITERATIONS 1000000
+#define BENCH_BUF_SIZE           (1u << 20)
+
+// -----------------------------------------------------------------------------
+// Timing.
+// -----------------------------------------------------------------------------
+
+static u64 bench_now_ns(void) {
+#if defined(_WIN32)
+    static LARGE_INTEGER frequency = {0};
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (u64)((f64)counter.QuadPart * (1e9 / (f64)frequency.QuadPart));
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+#endif
+}
+
+/// Scheduler of the operation start times.
+struct bench_timer {
+    u64 interval_ns;  ///< Interval between scheduled operations, zero for a closed loop.
+    u64 next_ns;      ///< Next scheduled start time.
+};
+
+/// Mark the start of a timed operation.
+///
+/// Return: The time from which the latency of the operation should be measured. In an open loop
+///         this is the scheduled start time, even if we're running behind schedule.
+static u64 bench_op_start(struct bench_timer* timer) {
+    if (timer->interval_ns == 0) {
+        return bench_now_ns();
+    }
+
+    if (timer->next_ns == 0) {
+        timer->next_ns = bench_now_ns();
+    }
+    u64 const scheduled = timer->next_ns;
+    while (bench_now_ns() < scheduled) {
+    }
+    timer->next_ns += timer->interval_ns;
+    return scheduled;
+}
+
+static void bench_op_end(struct histogram* hist, u64 start_ns) {
+    histogram_record(hist, bench_now_ns() - start_ns);
+}
+
+/// Sink preventing the compiler from optimizing away the benchmarked operations.
+static u8* volatile bench_sink;
+
+// -----------------------------------------------------------------------------
+// Workloads.
+// -----------------------------------------------------------------------------
+
+struct bench_thread {
+    struct alloha_thread handle;
+    struct bench_timer   timer;
+    u64                  iterations;
+    u8*                  buf;
+    struct histogram*    hists;  ///< One histogram per operation of the workload.
+    void (*workload)(struct bench_thread*);
+};
+
+static void bench_arena_alloc(struct bench_thread* t) {
+    struct arena arena = arena_new(BENCH_BUF_SIZE, t->buf);
+    for (u64 it = 0; it < t->iterations; ++it) {
+        if (arena.offset + 64 > arena.capacity) {
+            arena_clear(&arena);
+        }
+        u64 const start = bench_op_start(&t->timer);
+        bench_sink      = arena_alloc(&arena, 64);
+        bench_op_end(&t->hists[0], start);
+    }
+}
+
+static void bench_arena_realloc(struct bench_thread* t) {
+    struct arena arena = arena_new(BENCH_BUF_SIZE, t->buf);
+    u8*          block = NULL;
+    usize        size  = 0;
+    for (u64 it = 0; it < t->iterations; ++it) {
+        if (size == 0 || size >= 4096) {
+            arena_clear(&arena);
+            size  = 16;
+            block = arena_alloc(&arena, size);
+        }
+        u64 const start = bench_op_start(&t->timer);
+        block           = arena_realloc(&arena, block, size, size + 16, ALLOHA_DEFAULT_ALIGNMENT);
+        bench_op_end(&t->hists[0], start);
+        size += 16;
+    }
+    bench_sink = block;
+}
+
+static void bench_scratch_arena(struct bench_thread* t) {
+    struct arena arena = arena_new(BENCH_BUF_SIZE, t->buf);
+    for (u64 it = 0; it < t->iterations; ++it) {
+        u64 const            start   = bench_op_start(&t->timer);
+        struct scratch_arena scratch = scratch_arena_start(&arena);
+        bench_sink                   = arena_alloc(&arena, 256);
+        scratch_arena_end(&scratch);
+        bench_op_end(&t->hists[0], start);
+    }
+}
+
+static void bench_down_arena_alloc(struct bench_thread* t) {
+    struct down_arena arena = down_arena_new(BENCH_BUF_SIZE, t->buf);
+    for (u64 it = 0; it < t->iterations; ++it) {
+        if (down_arena_used(&arena) + 64 > arena.capacity) {
+            down_arena_clear(&arena);
+        }
+        u64 const start = bench_op_start(&t->timer);
+        bench_sink      = down_arena_alloc(&arena, 64);
+        bench_op_end(&t->hists[0], start);
+    }
+}
+
+static void bench_scratch_down_arena(struct bench_thread* t) {
+    struct down_arena arena = down_arena_new(BENCH_BUF_SIZE, t->buf);
+    for (u64 it = 0; it < t->iterations; ++it) {
+        u64 const                 start   = bench_op_start(&t->timer);
+        struct scratch_down_arena scratch = scratch_down_arena_start(&arena);
+        bench_sink                        = down_arena_alloc(&arena, 256);
+        scratch_down_arena_end(&scratch);
+        bench_op_end(&t->hists[0], start);
+    }
+}
+
+/// Churn through a window of live objects of a few sizes, which the arena recycles.
+static void bench_recycle_arena_churn(struct bench_thread* t) {
+    struct recycle_arena arena = recycle_arena_new(BENCH_BUF_SIZE, t->buf);
+    u8*                  live[64] = {0};
+    for (u64 it = 0; it < t->iterations; ++it) {
+        u32 const   slot = (u32)(it % 64);
+        usize const size = (usize)16 << (it % 4);
+        if (live[slot]) {
+            u64 const start = bench_op_start(&t->timer);
+            recycle_arena_free(&arena, live[slot], (usize)16 << ((it - 64) % 4));
+            bench_op_end(&t->hists[1], start);
+        }
+        u64 const start = bench_op_start(&t->timer);
+        live[slot]      = recycle_arena_alloc(&arena, size);
+        bench_op_end(&t->hists[0], start);
+    }
+    bench_sink = live[0];
+}
+
+#define BENCH_FIBER_STACK_SIZE (64u << 10)
+#define BENCH_FIBER_WINDOW     64
+
+/// Create and destroy fibers, keeping a window of live ones, each touching the top of its stack.
+static void bench_fiber_stack_cache(struct bench_thread* t) {
+    struct fiber_stack_config const config = {
+        .stack_size = BENCH_FIBER_STACK_SIZE,
+        .max_stacks = BENCH_FIBER_WINDOW + FIBER_STACK_CACHE_SIZE,
+        .lazy       = true,
+    };
+    struct fiber_stack_pool pool;
+    bool const              created = fiber_stack_pool_create(&pool, config);
+    assert(created && "bench_fiber_stack_cache unable to create the pool");
+
+    struct fiber_stack_cache cache;
+    fiber_stack_cache_init(&cache, &pool);
+    struct fiber_stack live[BENCH_FIBER_WINDOW] = {{0}};
+    for (u64 it = 0; it < t->iterations; ++it) {
+        struct fiber_stack* fiber = &live[it % BENCH_FIBER_WINDOW];
+        if (fiber->base) {
+            u64 const start = bench_op_start(&t->timer);
+            fiber_stack_cache_release(&cache, *fiber);
+            bench_op_end(&t->hists[1], start);
+        }
+        u64 const start               = bench_op_start(&t->timer);
+        *fiber                        = fiber_stack_cache_acquire(&cache);
+        fiber->base[fiber->size - 64] = 1;
+        bench_op_end(&t->hists[0], start);
+    }
+    for (u32 i = 0; i < BENCH_FIBER_WINDOW; ++i) {
+        fiber_stack_cache_release(&cache, live[i]);
+    }
+    fiber_stack_cache_flush(&cache);
+    fiber_stack_pool_destroy(&pool);
+}
+
+/// Same as `bench_fiber_stack_cache`, mapping each stack and its guard page.
+static void bench_fiber_stack_mmap(struct bench_thread* t) {
+    usize const page_size                = vmem_page_size();
+    usize const slot_size                = BENCH_FIBER_STACK_SIZE + page_size;
+    u8*         live[BENCH_FIBER_WINDOW] = {0};
+    for (u64 it = 0; it < t->iterations; ++it) {
+        u8** fiber = &live[it % BENCH_FIBER_WINDOW];
+        if (*fiber) {
+            u64 const start = bench_op_start(&t->timer);
+            vmem_free(*fiber, slot_size);
+            bench_op_end(&t->hists[1], start);
+        }
+        u64 const start = bench_op_start(&t->timer);
+        *fiber          = vmem_alloc(slot_size, VMEM_RESERVE);
+        alloha_discard(vmem_commit(*fiber + page_size, BENCH_FIBER_STACK_SIZE));
+        (*fiber)[slot_size - 64] = 1;
+        bench_op_end(&t->hists[0], start);
+    }
+    for (u32 i = 0; i < BENCH_FIBER_WINDOW; ++i) {
+        vmem_free(live[i], slot_size);
+    }
+}
+
+/// Object of the collected heap, linked to the previous one.
+struct bench_gc_node {
+    struct bench_gc_node* next;
+    u64                   payload[5];
+};
+
+static usize const bench_gc_node_pointers[] = {offsetof(struct bench_gc_node, next)};
+
+static struct gc_type const bench_gc_node_type = {
+    .size            = sizeof(struct bench_gc_node),
+    .pointer_count   = 1,
+    .pointer_offsets = bench_gc_node_pointers,
+};
+
+/// Allocate from a collected heap keeping a window of short chains alive, so that collections copy
+/// a small live set. Collections show up in the tail of the allocation latencies.
+static void bench_gc_alloc(struct bench_thread* t) {
+    struct gc_config const config = {.space_capacity = BENCH_BUF_SIZE / 2, .max_roots = 64};
+    struct gc_heap         heap;
+    bool const             created = gc_heap_create(&heap, config);
+    assert(created && "bench_gc_alloc unable to create the heap");
+
+    struct bench_gc_node* live[64] = {0};
+    for (u32 i = 0; i < 64; ++i) {
+        alloha_discard(gc_add_root(&heap, &live[i]));
+    }
+    for (u64 it = 0; it < t->iterations; ++it) {
+        u32 const             slot  = (u32)(it % 64);
+        u64 const             start = bench_op_start(&t->timer);
+        struct bench_gc_node* node  = (struct bench_gc_node*)gc_alloc(&heap, &bench_gc_node_type);
+        bench_op_end(&t->hists[0], start);
+
+        // Chains are cut every 8 slots, bounding the live set.
+        node->next = (slot % 8 != 0) ? live[slot - 1] : NULL;
+        live[slot] = node;
+    }
+    bench_sink = (u8*)live[0];
+    gc_heap_destroy(&heap);
+}
+
+static void bench_stack_alloc_pop(struct bench_thread* t) {
+    struct stack stack = stack_new(BENCH_BUF_SIZE, t->buf);
+    for (u64 it = 0; it < t->iterations; ++it) {
+        u64 start  = bench_op_start(&t->timer);
+        bench_sink = stack_alloc(&stack, 64);
+        bench_op_end(&t->hists[0], start);
+
+        start = bench_op_start(&t->timer);
+        alloha_discard(stack_pop(&stack));
+        bench_op_end(&t->hists[1], start);
+    }
+}
+
+struct bench_workload {
+    void (*run)(struct bench_thread*);
+    char const* op_names[BENCH_MAX_OPS];
+};
+
+static struct bench_workload const bench_workloads[] = {
+    {bench_arena_alloc, {"arena_alloc"}},
+    {bench_arena_realloc, {"arena_realloc"}},
+    {bench_scratch_arena, {"scratch_arena_cycle"}},
+    {bench_down_arena_alloc, {"down_arena_alloc"}},
+    {bench_scratch_down_arena, {"scratch_down_cycle"}},
+    {bench_recycle_arena_churn, {"recycle_alloc", "recycle_free"}},
+    {bench_fiber_stack_cache, {"fiber_cache_create", "fiber_cache_destroy"}},
+    {bench_fiber_stack_mmap, {"fiber_mmap_create", "fiber_mmap_destroy"}},
+    {bench_gc_alloc, {"gc_alloc"}},
+    {bench_stack_alloc_pop, {"stack_alloc", "stack_pop"}},
+};
+
+// -----------------------------------------------------------------------------
+// Driver.
+// -----------------------------------------------------------------------------
+
+struct bench_config {
+    u32 thread_count;
+    u64 iterations;
+    f64 rate;  ///< Target operations per second per thread, zero for a closed loop.
+};
+
+static int bench_thread_main(void* arg) {
+    struct bench_thread* t = (struct bench_thread*)arg;
+    t->workload(t);
+    return 0;
+}
+
+static void bench_print_header(void) {
+    printf(
+        "%-22s %12s %9s %9s %9s %9s %9s %9s\n",
+        "operation",
+        "count",
+        "min",
+        "p50",
+        "p99",
+        "p99.9",
+        "p99.99",
+        "max");
+}
+
+static void bench_print_row(char const* name, struct histogram const* hist) {
+    printf(
+        "%-22s %12llu %9llu %9llu %9llu %9llu %9llu %9llu\n",
+        name,
+        (unsigned long long)hist->total,
+        (unsigned long long)hist->min,
+        (unsigned long long)histogram_percentile(hist, 50.0),
+        (unsigned long long)histogram_percentile(hist, 99.0),
+        (unsigned long long)histogram_percentile(hist, 99.9),
+        (unsigned long long)histogram_percentile(hist, 99.99),
+        (unsigned long long)hist->max);
+}
+
+static void bench_run_workload(struct bench_config const* config, struct bench_workload const* w) {
+    u32 op_count = 0;
+    while (op_count < BENCH_MAX_OPS && w->op_names[op_count]) {
+        ++op_count;
+    }
+
+    struct bench_thread* threads =
+        (struct bench_thread*)calloc(config->thread_count, sizeof(struct bench_thread));
+    assert(threads && "bench_run_workload unable to allocate the thread data");
+
+    u64 const interval_ns = (config->rate > 0.0) ? (u64)(1e9 / config->rate) : 0;
+    for (u32 idx = 0; idx < config->thread_count; ++idx) {
+        struct bench_thread* t = &threads[idx];
+        t->timer               = (struct bench_timer){.interval_ns = interval_ns, .next_ns = 0};
+        t->iterations          = config->iterations;
+        t->workload            = w->run;
+        t->buf                 = (u8*)malloc(BENCH_BUF_SIZE);
+        t->hists = (struct histogram*)malloc(op_count * sizeof(struct histogram));
+        assert(t->buf && t->hists && "bench_run_workload unable to allocate the thread data");
+        for (u32 op = 0; op < op_count; ++op) {
+            histogram_reset(&t->hists[op]);
+        }
+    }
+
+    for (u32 idx = 0; idx < config->thread_count; ++idx) {
+        bool const created =
+            alloha_thread_create(&threads[idx].handle, bench_thread_main, &threads[idx]);
+        assert(created && "bench_run_workload unable to create a thread");
+    }
+    for (u32 idx = 0; idx < config->thread_count; ++idx) {
+        alloha_discard(alloha_thread_join(&threads[idx].handle));
+    }
+
+    // Merge the per-thread results into the histograms of the first thread.
+    for (u32 op = 0; op < op_count; ++op) {
+        for (u32 idx = 1; idx < config->thread_count; ++idx) {
+            histogram_merge(&threads[0].hists[op], &threads[idx].hists[op]);
+        }
+        bench_print_row(w->op_names[op], &threads[0].hists[op]);
+    }
+
+    for (u32 idx = 0; idx < config->thread_count; ++idx) {
+        free(threads[idx].buf);
+        free(threads[idx].hists);
+    }
+    free(threads);
+}
+
+// -----------------------------------------------------------------------------
+// Bump direction: throughput and retired instructions of upward and downward arenas.
+//
+// Single allocations are too short to be timed one by one, so batches of allocations of mixed sizes
+// and alignments are measured as a whole. Instructions are counted via `perf_event_open` when
+// available (Linux, with `perf_event_paranoid` allowing user space counting).
+// -----------------------------------------------------------------------------
+
+#define BENCH_BUMP_BATCH 1024
+
+static usize const bench_bump_sizes[]      = {8, 24, 64, 16, 40, 128, 32, 8};
+static u32 const   bench_bump_alignments[] = {8, 16, 8, 32};
+
+/// Retired user space instructions counter, `fd` is negative if unavailable.
+struct bench_counter {
+    int fd;
+};
+
+static struct bench_counter bench_counter_open(void) {
+    struct bench_counter counter = {.fd = -1};
+#if defined(__linux__)
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.size           = sizeof(attr);
+    attr.config         = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled       = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    counter.fd          = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    return counter;
+}
+
+static void bench_counter_start(struct bench_counter const* counter) {
+#if defined(__linux__)
+    if (counter->fd >= 0) {
+        ioctl(counter->fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counter->fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#else
+    alloha_discard(counter);
+#endif
+}
+
+/// Return: Instructions retired since `bench_counter_start`, or zero if unavailable.
+static u64 bench_counter_stop(struct bench_counter const* counter) {
+    u64 count = 0;
+#if defined(__linux__)
+    if (counter->fd >= 0) {
+        ioctl(counter->fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(counter->fd, &count, sizeof(count)) != (ssize_t)sizeof(count)) {
+            count = 0;
+        }
+    }
+#else
+    alloha_discard(counter);
+#endif
+    return count;
+}
+
+static void bench_counter_close(struct bench_counter* counter) {
+#if defined(__linux__)
+    if (counter->fd >= 0) {
+        close(counter->fd);
+    }
+#endif
+    counter->fd = -1;
+}
+
+static void bench_bump_up(u8* buf, u64 batches) {
+    struct arena arena = arena_new(BENCH_BUF_SIZE, buf);
+    for (u64 batch = 0; batch < batches; ++batch) {
+        arena_clear(&arena);
+        for (u32 it = 0; it < BENCH_BUMP_BATCH; ++it) {
+            bench_sink = arena_alloc_aligned(
+                &arena,
+                bench_bump_sizes[it % 8],
+                bench_bump_alignments[it % 4]);
+        }
+    }
+}
+
+static void bench_bump_down(u8* buf, u64 batches) {
+    struct down_arena arena = down_arena_new(BENCH_BUF_SIZE, buf);
+    for (u64 batch = 0; batch < batches; ++batch) {
+        down_arena_clear(&arena);
+        for (u32 it = 0; it < BENCH_BUMP_BATCH; ++it) {
+            bench_sink = down_arena_alloc_aligned(
+                &arena,
+                bench_bump_sizes[it % 8],
+                bench_bump_alignments[it % 4]);
+        }
+    }
+}
+
+/// Same as `bench_bump_up`, allocating through the thread-local allocator context.
+static void bench_bump_context(u8* buf, u64 batches) {
+    struct arena arena = arena_new(BENCH_BUF_SIZE, buf);
+    alloha_discard(alloha_push_allocator(alloha_arena_allocator(&arena)));
+    for (u64 batch = 0; batch < batches; ++batch) {
+        arena_clear(&arena);
+        for (u32 it = 0; it < BENCH_BUMP_BATCH; ++it) {
+            bench_sink =
+                alloha_ctx_alloc_aligned(bench_bump_sizes[it % 8], bench_bump_alignments[it % 4]);
+        }
+    }
+    alloha_pop_allocator();
+}
+
+/// Same as `bench_bump_up`, pushing to the thread-local temporary stack.
+static void bench_bump_temp(u8* buf, u64 batches) {
+    alloha_discard(buf);
+    usize const mark = alloha_temp_mark();
+    for (u64 batch = 0; batch < batches; ++batch) {
+        alloha_temp_pop_to(mark);
+        for (u32 it = 0; it < BENCH_BUMP_BATCH; ++it) {
+            bench_sink = alloha_temp_push(bench_bump_sizes[it % 8], bench_bump_alignments[it % 4]);
+        }
+    }
+    alloha_temp_pop_to(mark);
+}
+
+/// Same as `bench_bump_up`, with the heap profiler sampling at its default period.
+static void bench_bump_sampled(u8* buf, u64 batches) {
+    bool const started = alloha_sample_start((struct alloha_sample_config){0});
+    assert(started && "bench_bump_sampled unable to start the heap profiler");
+    alloha_discard(started);
+    bench_bump_up(buf, batches);
+    alloha_sample_stop();
+}
+
+/// Each batch builds a region and releases it as a whole, as a shared object would once unused.
+static void bench_bump_region(u8* buf, u64 batches) {
+    alloha_discard(buf);
+    for (u64 batch = 0; batch < batches; ++batch) {
+        struct region* region = region_create(0);
+        for (u32 it = 0; it < BENCH_BUMP_BATCH; ++it) {
+            bench_sink = region_alloc_aligned(
+                region,
+                bench_bump_sizes[it % 8],
+                bench_bump_alignments[it % 4]);
+        }
+        alloha_discard(region_release(region));
+    }
+}
+
+/// Same as `bench_bump_region`, with each block freed individually via `free`.
+static void bench_bump_malloc(u8* buf, u64 batches) {
+    u8** blocks = (u8**)buf;
+    for (u64 batch = 0; batch < batches; ++batch) {
+        for (u32 it = 0; it < BENCH_BUMP_BATCH; ++it) {
+            blocks[it] = (u8*)malloc(bench_bump_sizes[it % 8]);
+            bench_sink = blocks[it];
+        }
+        for (u32 it = 0; it < BENCH_BUMP_BATCH; ++it) {
+            free(blocks[it]);
+        }
+    }
+}
+
+static void bench_run_bump(char const* name, void (*run)(u8*, u64), u64 iterations) {
+    u8* buf = (u8*)malloc(BENCH_BUF_SIZE);
+    assert(buf && "bench_run_bump unable to allocate the arena buffer");
+    u64 const batches = alloha_max(iterations / BENCH_BUMP_BATCH, 1);
+    u64 const ops     = batches * BENCH_BUMP_BATCH;
+
+    run(buf, alloha_max(batches / 16, 1));  // Warm up.
+
+    struct bench_counter counter = bench_counter_open();
+    bench_counter_start(&counter);
+    u64 const start = bench_now_ns();
+    run(buf, batches);
+    u64 const elapsed_ns   = bench_now_ns() - start;
+    u64 const instructions = bench_counter_stop(&counter);
+
+    if (counter.fd >= 0) {
+        printf(
+            "%-22s %12llu %12.2f %12.2f\n",
+            name,
+            (unsigned long long)ops,
+            (f64)elapsed_ns / (f64)ops,
+            (f64)instructions / (f64)ops);
+    } else {
+        printf(
+            "%-22s %12llu %12.2f %12s\n",
+            name,
+            (unsigned long long)ops,
+            (f64)elapsed_ns / (f64)ops,
+            "n/a");
+    }
+
+    bench_counter_close(&counter);
+    free(buf);
+}
+
+// -----------------------------------------------------------------------------
+// Startup: latency of the first requests served by freshly mapped memory.
+//
+// Each request allocates a block from a new arena and writes to it, as a request handler would.
+// Without pre-faulting, each request pays for the page faults of the pages it touches first.
+// -----------------------------------------------------------------------------
+
+#define BENCH_STARTUP_TRIALS       16
+#define BENCH_STARTUP_REQUESTS     2048
+#define BENCH_STARTUP_REQUEST_SIZE 4096
+#define BENCH_STARTUP_BUF_SIZE     (BENCH_STARTUP_REQUESTS * BENCH_STARTUP_REQUEST_SIZE)
+
+static void bench_startup(bool prefault, struct histogram* requests, struct histogram* warmup) {
+    struct bench_timer timer = {0};
+    for (u32 trial = 0; trial < BENCH_STARTUP_TRIALS; ++trial) {
+        u8* buf = vmem_alloc(BENCH_STARTUP_BUF_SIZE, VMEM_DEFAULT);
+        assert(buf && "bench_startup unable to map memory");
+        struct arena arena = arena_new(BENCH_STARTUP_BUF_SIZE, buf);
+
+        if (prefault) {
+            u64 const start = bench_op_start(&timer);
+            arena_prefault(&arena, 1);
+            bench_op_end(warmup, start);
+        }
+
+        for (u32 req = 0; req < BENCH_STARTUP_REQUESTS; ++req) {
+            u64 const start = bench_op_start(&timer);
+            u8*       block = arena_alloc(&arena, BENCH_STARTUP_REQUEST_SIZE);
+            memset(block, (int)req, BENCH_STARTUP_REQUEST_SIZE);
+            bench_op_end(requests, start);
+        }
+
+        vmem_free(buf, BENCH_STARTUP_BUF_SIZE);
+    }
+}
+
+static void bench_run_startup(void) {
+    struct histogram* hists = (struct histogram*)malloc(3 * sizeof(struct histogram));
+    assert(hists && "bench_run_startup unable to allocate the histograms");
+    for (u32 h = 0; h < 3; ++h) {
+        histogram_reset(&hists[h]);
+    }
+
+    bench_startup(false, &hists[0], NULL);
+    bench_startup(true, &hists[1], &hists[2]);
+
+    bench_print_row("first_request_cold", &hists[0]);
+    bench_print_row("first_request_warm", &hists[1]);
+    bench_print_row("arena_prefault", &hists[2]);
+    free(hists);
+}
+
+// -----------------------------------------------------------------------------
+// Parallel jobs: temporaries of each job allocated from the scratch arena of its worker, or via
+// `malloc`.
+// -----------------------------------------------------------------------------
+
+#define BENCH_JOB_TEMPORARIES 16
+
+/// Allocate and touch the temporaries of a job from the scratch arena of the worker.
+static void bench_job_scratch(void* arg, struct arena* scratch) {
+    alloha_discard(arg);
+    for (u32 it = 0; it < BENCH_JOB_TEMPORARIES; ++it) {
+        usize const size  = 4 * bench_bump_sizes[it % 8];
+        u8*         block = arena_alloc(scratch, size);
+        memset(block, (int)it, size);
+        bench_sink = block;
+    }
+}
+
+/// Same as `bench_job_scratch`, with the temporaries obtained via `malloc`.
+static void bench_job_malloc(void* arg, struct arena* scratch) {
+    alloha_discard(arg);
+    alloha_discard(scratch);
+    u8* blocks[BENCH_JOB_TEMPORARIES];
+    for (u32 it = 0; it < BENCH_JOB_TEMPORARIES; ++it) {
+        usize const size = 4 * bench_bump_sizes[it % 8];
+        blocks[it]       = (u8*)malloc(size);
+        memset(blocks[it], (int)it, size);
+        bench_sink = blocks[it];
+    }
+    for (u32 it = 0; it < BENCH_JOB_TEMPORARIES; ++it) {
+        free(blocks[it]);
+    }
+}
+
+static void bench_run_jobs(char const* name, job_fn fn, u32 worker_count, u64 job_count) {
+    struct job_config const config  = {.worker_count = worker_count};
+    struct job_system       system;
+    bool const              created = job_system_create(&system, config);
+    struct job*             jobs    = (struct job*)calloc(job_count, sizeof(struct job));
+    assert(created && jobs && "bench_run_jobs unable to create the job system");
+
+    struct job_counter counter;
+    job_counter_init(&counter);
+    for (u64 it = 0; it < job_count; ++it) {
+        jobs[it] = (struct job){.fn = fn, .counter = &counter};
+    }
+
+    u64 const start = bench_now_ns();
+    for (u64 it = 0; it < job_count; ++it) {
+        job_submit(&system, &jobs[it]);
+    }
+    job_wait(&system, &counter);
+    u64 const elapsed_ns = bench_now_ns() - start;
+
+    printf(
+        "%-22s %12llu %12.2f\n",
+        name,
+        (unsigned long long)job_count,
+        (f64)elapsed_ns / (f64)job_count);
+
+    job_system_destroy(&system);
+    free(jobs);
+}
+
+/// Smallest observed difference between two consecutive clock readings.
+static u64 bench_timer_overhead_ns(void) {
+    u64 overhead = UINT64_MAX;
+    for (u32 it = 0; it < 10000; ++it) {
+        u64 const start = bench_now_ns();
+        overhead        = alloha_min(overhead, bench_now_ns() - start);
+    }
+    return overhead;
+}
+
+int main(int argc, char** argv) {
+    struct bench_config config = {
+        .thread_count = 1,
+        .iterations   = BENCH_DEFAULT_ITERATIONS,
+        .rate         = 0.0,
+    };
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--threads") == 0) {
+            config.thread_count = (u32)alloha_max(strtoul(argv[i + 1], NULL, 10), 1);
+        } else if (strcmp(argv[i], "--iterations") == 0) {
+            config.iterations = (u64)strtoull(argv[i + 1], NULL, 10);
+        } else if (strcmp(argv[i], "--rate") == 0) {
+            config.rate = strtod(argv[i + 1], NULL);
+        } else {
+            fprintf(stderr, "Unknown option `%s`.\n", argv[i]);
+            return 1;
+        }
+    }
+
+    printf(
+        "threads: %u, iterations per thread: %llu, mode: ",
+        config.thread_count,
+        (unsigned long long)config.iterations);
+    if (config.rate > 0.0) {
+        printf("open loop at %.0f ops/s per thread\n", config.rate);
+    } else {
+        printf("closed loop\n");
+    }
+    printf(
+        "latencies in ns, clock overhead of ~%llu ns included\n\n",
+        (unsigned long long)bench_timer_overhead_ns());
+
+    bench_print_header();
+    for (usize w = 0; w < sizeof(bench_workloads) / sizeof(bench_workloads[0]); ++w) {
+        bench_run_workload(&config, &bench_workloads[w]);
+    }
+
+    printf(
+        "\nbatched bumps: batches of %u allocations of mixed sizes and alignments\n\n",
+        BENCH_BUMP_BATCH);
+    printf("%-22s %12s %12s %12s\n", "operation", "count", "ns/op", "instr/op");
+    bench_run_bump("arena_mixed", bench_bump_up, config.iterations);
+    bench_run_bump("down_arena_mixed", bench_bump_down, config.iterations);
+    bench_run_bump("context_arena_mixed", bench_bump_context, config.iterations);
+    bench_run_bump("temp_mixed", bench_bump_temp, config.iterations);
+    bench_run_bump("arena_mixed_sampled", bench_bump_sampled, config.iterations);
+    bench_run_bump("region_mixed", bench_bump_region, config.iterations);
+    bench_run_bump("malloc_free_mixed", bench_bump_malloc, config.iterations);
+
+    printf(
+        "\nstartup: first %u requests of %u bytes on a fresh %u MiB arena, with and without "
+        "pre-faulting\n\n",
+        BENCH_STARTUP_REQUESTS,
+        BENCH_STARTUP_REQUEST_SIZE,
+        BENCH_STARTUP_BUF_SIZE >> 20);
+    bench_print_header();
+    bench_run_startup();
+
+    u64 const job_count = alloha_max(config.iterations / 4, 1);
+    printf(
+        "\nparallel jobs: %u workers, %u temporaries per job, submitted from the main thread\n\n",
+        config.thread_count,
+        BENCH_JOB_TEMPORARIES);
+    printf("%-22s %12s %12s\n", "operation", "count", "ns/job");
+    bench_run_jobs("jobs_scratch", bench_job_scratch, config.thread_count, job_count);
+    bench_run_jobs("jobs_malloc", bench_job_malloc, config.thread_count, job_count);
+    return 0;
+}
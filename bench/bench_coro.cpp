@@ -0,0 +1,211 @@
+/// Benchmarks of the allocation of C++20 coroutine frames.
+///
+/// Runs a chain of nested async calls, each awaiting the next one down to a fixed depth, with the
+/// frames allocated by `alloha::frame_promise` and by the global `operator new`. Each run of a
+/// whole chain is timed and recorded into a latency histogram.
+///
+/// Usage: bench_coro [--iterations <count>] [--depth <depth>]
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/coro.hpp>
+
+#include <alloha/core.h>
+#include <cassert>
+#include <chrono>
+#include <coroutine>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <utility>
+
+#include "histogram.c"
+
+#define BENCH_CORO_DEFAULT_ITERATIONS 100000
+#define BENCH_CORO_DEFAULT_DEPTH      64
+#define BENCH_CORO_ROUNDS             10
+
+static u64 bench_now_ns() {
+    auto const now = std::chrono::steady_clock::now().time_since_epoch();
+    return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+/// Sink preventing the compiler from optimizing away the benchmarked chains.
+static volatile u64 bench_sink;
+
+/// Promise base keeping the default frame allocation.
+struct heap_frames {};
+
+/// Lazily started task, resuming its awaiter on completion via symmetric transfer.
+template <typename FrameBase>
+struct task {
+    struct promise_type : FrameBase {
+        u64                     value = 0;
+        std::coroutine_handle<> continuation;
+
+        task get_return_object() {
+            return task{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        auto final_suspend() noexcept {
+            struct final_awaiter {
+                bool await_ready() noexcept {
+                    return false;
+                }
+                std::coroutine_handle<> await_suspend(
+                    std::coroutine_handle<promise_type> handle) noexcept {
+                    auto continuation = handle.promise().continuation;
+                    return continuation ? continuation : std::noop_coroutine();
+                }
+                void await_resume() noexcept {}
+            };
+            return final_awaiter{};
+        }
+
+        void return_value(u64 result) {
+            value = result;
+        }
+
+        void unhandled_exception() {
+            std::terminate();
+        }
+    };
+
+    explicit task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+    task(task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    task(task const&) = delete;
+
+    ~task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+        handle.promise().continuation = awaiter;
+        return handle;
+    }
+
+    u64 await_resume() const noexcept {
+        return handle.promise().value;
+    }
+
+    u64 run() {
+        handle.resume();
+        return handle.promise().value;
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+template <typename FrameBase>
+static task<FrameBase> bench_chain(u32 depth) {
+    if (depth == 0) {
+        co_return 1;
+    }
+    co_return 1 + co_await bench_chain<FrameBase>(depth - 1);
+}
+
+/// Timings of the chains of one kind of frame allocation.
+struct bench_result {
+    struct histogram hist;
+    u64              total_ns;
+};
+
+/// Run `iterations` chains, recording their timings into the histogram of the current round.
+template <typename FrameBase>
+static void bench_run_chain(struct histogram* round, u64* total_ns, u64 iterations, u32 depth) {
+    histogram_reset(round);
+    for (u64 it = 0; it < iterations; ++it) {
+        u64 const start = bench_now_ns();
+        {
+            task<FrameBase> root = bench_chain<FrameBase>(depth);
+            bench_sink           = root.run();
+        }
+        u64 const elapsed = bench_now_ns() - start;
+        histogram_record(round, elapsed);
+        *total_ns += elapsed;
+    }
+}
+
+static void bench_print_result(char const* name, struct bench_result const* result, u64 frames) {
+    struct histogram const* hist = &result->hist;
+    printf(
+        "%-22s %12llu %9llu %9llu %9llu %9llu %12.2f\n",
+        name,
+        (unsigned long long)hist->total,
+        (unsigned long long)hist->min,
+        (unsigned long long)histogram_percentile(hist, 50.0),
+        (unsigned long long)histogram_percentile(hist, 99.0),
+        (unsigned long long)hist->max,
+        frames ? (f64)result->total_ns / (f64)frames : 0.0);
+}
+
+int main(int argc, char** argv) {
+    u64 iterations = BENCH_CORO_DEFAULT_ITERATIONS;
+    u32 depth      = BENCH_CORO_DEFAULT_DEPTH;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--iterations") == 0) {
+            iterations = (u64)strtoull(argv[i + 1], NULL, 10);
+        } else if (strcmp(argv[i], "--depth") == 0) {
+            depth = (u32)strtoul(argv[i + 1], NULL, 10);
+        } else {
+            fprintf(stderr, "Unknown option `%s`.\n", argv[i]);
+            return 1;
+        }
+    }
+
+    printf(
+        "async chains of %u nested calls, %llu runs each, latencies in ns per chain\n\n",
+        depth,
+        (unsigned long long)iterations);
+    printf(
+        "%-22s %12s %9s %9s %9s %9s %12s\n",
+        "operation",
+        "count",
+        "min",
+        "p50",
+        "p99",
+        "max",
+        "ns/frame");
+
+    usize const          result_size   = sizeof(struct bench_result);
+    struct bench_result* alloha_frames = (struct bench_result*)calloc(1, result_size);
+    struct bench_result* new_frames    = (struct bench_result*)calloc(1, result_size);
+    struct histogram*    round         = (struct histogram*)malloc(sizeof(struct histogram));
+    assert(alloha_frames && new_frames && round && "bench_coro unable to allocate the histograms");
+    histogram_reset(&alloha_frames->hist);
+    histogram_reset(&new_frames->hist);
+
+    // Warm up the frame allocator of the thread, and the heap.
+    bench_sink = bench_chain<alloha::frame_promise>(depth).run();
+    bench_sink = bench_chain<heap_frames>(depth).run();
+
+    // Both kinds of allocation alternate in rounds, so that they see the same machine conditions.
+    u64 const rounds = alloha_min(iterations, BENCH_CORO_ROUNDS);
+    for (u64 r = 0; r < rounds; ++r) {
+        u64 const count = iterations / rounds + (r < iterations % rounds ? 1 : 0);
+        bench_run_chain<alloha::frame_promise>(round, &alloha_frames->total_ns, count, depth);
+        histogram_merge(&alloha_frames->hist, round);
+        bench_run_chain<heap_frames>(round, &new_frames->total_ns, count, depth);
+        histogram_merge(&new_frames->hist, round);
+    }
+
+    u64 const frames = iterations * (depth + 1);
+    bench_print_result("coro_chain_alloha", alloha_frames, frames);
+    bench_print_result("coro_chain_new", new_frames, frames);
+
+    free(alloha_frames);
+    free(new_frames);
+    free(round);
+    return 0;
+}
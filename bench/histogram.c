@@ -0,0 +1,95 @@
+/// Latency histogram for the benchmarks.
+///
+/// High dynamic range histogram with log-linear buckets: values below `HISTOGRAM_SUB_BUCKETS` are
+/// recorded exactly, and every power of two above that is split into `HISTOGRAM_SUB_BUCKETS / 2`
+/// linear sub-buckets, which bounds the relative error of any recorded value to under 2%.
+/// Histograms have a fixed layout, so the histograms of different threads can be merged by
+/// summing their counts.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/core.h>
+
+#include <string.h>
+
+#define HISTOGRAM_SUB_BUCKET_BITS 7
+#define HISTOGRAM_SUB_BUCKETS     (1u << HISTOGRAM_SUB_BUCKET_BITS)
+#define HISTOGRAM_HALF_BUCKETS    (HISTOGRAM_SUB_BUCKETS / 2)
+#define HISTOGRAM_BUCKETS \
+    (HISTOGRAM_SUB_BUCKETS + (64 - HISTOGRAM_SUB_BUCKET_BITS) * HISTOGRAM_HALF_BUCKETS)
+
+struct histogram {
+    u64 counts[HISTOGRAM_BUCKETS];
+    u64 total;
+    u64 min;
+    u64 max;
+};
+
+static u32 histogram_msb(u64 value) {
+    u32 msb = 0;
+    while (value >>= 1) {
+        ++msb;
+    }
+    return msb;
+}
+
+static usize histogram_index(u64 value) {
+    if (value < HISTOGRAM_SUB_BUCKETS) {
+        return (usize)value;
+    }
+    u32 const shift = histogram_msb(value) - HISTOGRAM_SUB_BUCKET_BITS + 1;
+    u64 const top   = value >> shift;  // In [HISTOGRAM_HALF_BUCKETS, HISTOGRAM_SUB_BUCKETS).
+    return HISTOGRAM_SUB_BUCKETS + (usize)(shift - 1) * HISTOGRAM_HALF_BUCKETS +
+           (usize)(top - HISTOGRAM_HALF_BUCKETS);
+}
+
+/// Largest value that falls into the bucket at `idx`.
+static u64 histogram_bucket_upper_bound(usize idx) {
+    if (idx < HISTOGRAM_SUB_BUCKETS) {
+        return (u64)idx;
+    }
+    usize const rel   = idx - HISTOGRAM_SUB_BUCKETS;
+    u32 const   shift = (u32)(rel / HISTOGRAM_HALF_BUCKETS) + 1;
+    u64 const   top   = (u64)(rel % HISTOGRAM_HALF_BUCKETS) + HISTOGRAM_HALF_BUCKETS;
+    return ((top + 1) << shift) - 1;
+}
+
+static void histogram_reset(struct histogram* hist) {
+    memset(hist, 0, sizeof(*hist));
+    hist->min = UINT64_MAX;
+}
+
+static void histogram_record(struct histogram* hist, u64 value) {
+    ++hist->counts[histogram_index(value)];
+    ++hist->total;
+    hist->min = alloha_min(hist->min, value);
+    hist->max = alloha_max(hist->max, value);
+}
+
+static void histogram_merge(struct histogram* restrict dst, struct histogram const* restrict src) {
+    for (usize idx = 0; idx < HISTOGRAM_BUCKETS; ++idx) {
+        dst->counts[idx] += src->counts[idx];
+    }
+    dst->total += src->total;
+    dst->min = alloha_min(dst->min, src->min);
+    dst->max = alloha_max(dst->max, src->max);
+}
+
+/// Value below which `percentile` percent of the recorded values lie.
+static u64 histogram_percentile(struct histogram const* hist, f64 percentile) {
+    if (hist->total == 0) {
+        return 0;
+    }
+
+    u64 rank = (u64)((percentile / 100.0) * (f64)hist->total + 0.5);
+    rank     = alloha_max(rank, 1);
+
+    u64 seen = 0;
+    for (usize idx = 0; idx < HISTOGRAM_BUCKETS; ++idx) {
+        seen += hist->counts[idx];
+        if (seen >= rank) {
+            return alloha_min(histogram_bucket_upper_bound(idx), hist->max);
+        }
+    }
+    return hist->max;
+}
@@ -21,8 +21,15 @@ local options = {
     clang = false,
     gcc = false,
     msvc = false,
+    -- Also build the library as a shared object (`liballoha.so` or `liballoha.dll`).
+    shared = false,
     -- Build and run tests.
     test = false,
+    -- Build and run the benchmarks (always with release flags).
+    bench = false,
+    -- Build and run the tests for every configuration of the test matrix, and the benchmarks for
+    -- every compiler, both for C and the C++ interface (Linux only).
+    matrix = false,
     -- Whether or not to print the commands ran by the build script and their output.
     quiet = false,
 }
@@ -38,12 +45,14 @@ if os_windows then
     os_info.silence_cmd = " > NUL 2>&1"
     os_info.obj_ext = ".obj"
     os_info.lib_ext = ".lib"
+    os_info.dll_ext = ".dll"
     os_info.exe_ext = ".exe"
 else
     os_info.path_sep = "/"
     os_info.silence_cmd = " > /dev/null 2>&1"
     os_info.obj_ext = ".o"
     os_info.lib_ext = ".a"
+    os_info.dll_ext = ".so"
     os_info.exe_ext = ""
 end
 
@@ -69,6 +78,17 @@ function concat(arr, join, is_prefix)
     return acc
 end
 
+function join(lhs, rhs)
+    local acc = {}
+    for _, v in ipairs(lhs) do
+        table.insert(acc, v)
+    end
+    for _, v in ipairs(rhs) do
+        table.insert(acc, v)
+    end
+    return acc
+end
+
 -- -----------------------------------------------------------------------------
 -- Project configuration
 -- -----------------------------------------------------------------------------
@@ -76,36 +96,53 @@ end
 local compilers = {
     clang = {
         cc = "clang",
+        cxx = "clang++",
         opt_include = "-I",
         opt_define = "-D",
         opt_std = "-std=",
         opt_no_link = "-c",
         opt_out_obj = "-o",
         opt_out_exe = "-o",
-        flags_common = "-pedantic -Wall -Wextra -Wpedantic -Wuninitialized -Wconversion -Wnull-pointer-arithmetic -Wnull-dereference -Wformat=2 -Wno-unused-variable -Wno-switch-enum -Wno-unsafe-buffer-usage -Wno-declaration-after-statement -Wno-cast-align",
-        flags_debug = "-Werror -g -O0 -fsanitize=address -fsanitize=pointer-compare -fsanitize=pointer-subtract -fsanitize=undefined -fstack-protector-strong -fsanitize=leak",
+        flags_common = "-pedantic -Wall -Wextra -Wpedantic -Wuninitialized -Wconversion -Wnull-pointer-arithmetic -Wnull-dereference -Wformat=2 -Wno-unused-variable -Wno-switch-enum -Wno-unsafe-buffer-usage -Wno-declaration-after-statement -Wno-cast-align -pthread",
+        flags_cxx = "-std=c++20 -pedantic -Wall -Wextra -Wconversion -Wno-unused-variable -pthread",
+        flags_debug = "-Werror -g -O0 -fstack-protector-strong",
         flags_release = "-O2",
+        flags_sanitize = "-fsanitize=address -fsanitize=pointer-compare -fsanitize=pointer-subtract -fsanitize=undefined -fsanitize=leak",
+        flags_sanitize_thread = "-fsanitize=thread",
         ar = "llvm-ar",
         ar_out = "",
         ar_flags = "rcs",
+        flags_shared = "-fPIC -fvisibility=hidden",
+        ld_shared = "clang -shared",
+        ld_out = "-o",
+        ld_export_list = "-Wl,--version-script=",
     },
     gcc = {
         cc = "gcc",
+        cxx = "g++",
         opt_include = "-I",
         opt_define = "-D",
         opt_std = "-std=",
         opt_no_link = "-c",
         opt_out_obj = "-o",
         opt_out_exe = "-o",
-        flags_common = "-pedantic -Wall -Wextra -Wpedantic -Wuninitialized -Wconversion -Wnull-dereference -Wformat=2 -Wno-unused-variable -Wno-cast-align",
-        flags_debug = "-Werror -g -O0 -fsanitize=address -fsanitize=pointer-compare -fsanitize=pointer-subtract -fsanitize=undefined -fstack-protector-strong -fsanitize=leak",
+        flags_common = "-pedantic -Wall -Wextra -Wpedantic -Wuninitialized -Wconversion -Wnull-dereference -Wformat=2 -Wno-unused-variable -Wno-cast-align -pthread",
+        flags_cxx = "-std=c++20 -pedantic -Wall -Wextra -Wconversion -Wno-unused-variable -pthread",
+        flags_debug = "-Werror -g -O0 -fstack-protector-strong",
         flags_release = "-O2",
+        flags_sanitize = "-fsanitize=address -fsanitize=pointer-compare -fsanitize=pointer-subtract -fsanitize=undefined -fsanitize=leak",
+        flags_sanitize_thread = "-fsanitize=thread",
         ar = "ar",
         ar_out = "",
         ar_flags = "rcs",
+        flags_shared = "-fPIC -fvisibility=hidden",
+        ld_shared = "gcc -shared",
+        ld_out = "-o",
+        ld_export_list = "-Wl,--version-script=",
     },
     msvc = {
         cc = "cl",
+        cxx = "cl",
         opt_include = "-I",
         opt_define = "-D",
         opt_std = "/std:",
@@ -113,14 +150,22 @@ local compilers = {
         opt_out_obj = "/Fo:",
         opt_out_exe = "/Fe:",
         flags_common = "-nologo -Oi -TC -MP -FC -GF -GA /fp:except- -GR- -EHsc- /INCREMENTAL:NO /W3",
+        flags_cxx = "-nologo -TP /std:c++20 -EHsc /W3",
         flags_debug = "/Ob0 /Od /Oy- /Z7 /RTC1 /MTd",
         flags_release = "/O2 /MT",
+        flags_sanitize = "",
+        flags_sanitize_thread = nil,
         ar = "lib",
         ar_out = "/out:",
         ar_flags = "/nologo",
+        flags_shared = "",
+        ld_shared = "link /nologo /DLL",
+        ld_out = "/out:",
+        ld_export_list = nil,
     },
     clang_cl = {
         cc = "clang-cl",
+        cxx = "clang-cl",
         opt_include = "-I",
         opt_define = "-D",
         opt_std = "/std:",
@@ -128,11 +173,18 @@ local compilers = {
         opt_out_obj = "-o",
         opt_out_exe = "-o",
         flags_common = "/TC -Wall -Wextra -Wconversion -Wuninitialized -Wnull-pointer-arithmetic -Wnull-dereference -Wformat=2 -Wno-unused-variable -Wno-switch-enum -Wno-unsafe-buffer-usage -Wno-declaration-after-statement -Wno-cast-align",
+        flags_cxx = "/TP /std:c++20 /EHsc -Wall -Wextra -Wconversion -Wno-unused-variable",
         flags_debug = "-Ob0 /Od /Oy- /Z7 /RTC1 -g /MTd",
         flags_release = "-O2 /MT",
+        flags_sanitize = "",
+        flags_sanitize_thread = nil,
         ar = "llvm-lib",
         ar_out = "/out:",
         ar_flags = "/nologo",
+        flags_shared = "",
+        ld_shared = "lld-link /nologo /DLL",
+        ld_out = "/out:",
+        ld_export_list = nil,
     },
 }
 
@@ -141,9 +193,18 @@ local alloha = {
     test_src = "tests/test_all.c",
     include_dir = "include",
     defines = { "_CRT_SECURE_NO_WARNINGS" },
+    shared_defines = { "ALLOHA_BUILD_SHARED" },
+    export_list = "src/alloha.map",
     debug_defines = { "YO_DEBUG" },
     lib = "liballoha",
     test_exe = "test_all",
+    bench_src = "bench/bench_all.c",
+    bench_exe = "bench_all",
+    -- C++ interface (`alloha/coro.hpp`), linked against the library.
+    test_cxx_src = "tests/test_coro.cpp",
+    test_cxx_exe = "test_coro",
+    bench_cxx_src = "bench/bench_coro.cpp",
+    bench_cxx_exe = "bench_coro",
     std = "c11",
 }
 
@@ -161,12 +222,16 @@ elseif options.msvc then
     tc = compilers.msvc
 end
 
+local function debug_flags(toolchain)
+    return toolchain.flags_debug .. " " .. toolchain.flags_sanitize
+end
+
 -- -----------------------------------------------------------------------------
 -- Execute build instructions
 -- -----------------------------------------------------------------------------
 
 if options.fmt then
-    exec("clang-format -i include/alloha/*.h src/*.c")
+    exec("clang-format -i include/alloha/*.h include/alloha/*.hpp src/*.c tests/*.cpp bench/*.cpp")
 end
 
 local out_dir = "build"
@@ -182,7 +247,7 @@ exec(
         tc.opt_no_link,
         tc.opt_std .. alloha.std,
         tc.flags_common,
-        options.release and tc.flags_release or tc.flags_debug,
+        options.release and tc.flags_release or debug_flags(tc),
         concat(alloha.defines, " " .. tc.opt_define, true),
         tc.opt_include .. alloha.include_dir,
         tc.opt_out_obj .. obj_out,
@@ -192,6 +257,39 @@ exec(
 -- Archive objs into a library.
 exec(string.format("%s %s %s %s", tc.ar, tc.ar_flags, tc.ar_out .. lib_out, obj_out))
 
+if options.shared then
+    -- The shared library needs its own position independent object, where only the symbols marked
+    -- with `ALLOHA_API` (and listed in the export list) are visible. Sanitizers are left out, since
+    -- their runtime isn't linked into the library and its consumers may not link it either.
+    local shared_obj_out = out_dir .. os_info.path_sep .. alloha.lib .. "_shared" .. os_info.obj_ext
+    local shared_out = out_dir .. os_info.path_sep .. alloha.lib .. os_info.dll_ext
+    exec(
+        string.format(
+            string.rep("%s ", 11),
+            tc.cc,
+            tc.opt_no_link,
+            tc.opt_std .. alloha.std,
+            tc.flags_common,
+            tc.flags_shared,
+            options.release and tc.flags_release or tc.flags_debug,
+            concat(alloha.defines, " " .. tc.opt_define, true),
+            concat(alloha.shared_defines, " " .. tc.opt_define, true),
+            tc.opt_include .. alloha.include_dir,
+            tc.opt_out_obj .. shared_obj_out,
+            alloha.src
+        )
+    )
+    exec(
+        string.format(
+            "%s %s %s %s",
+            tc.ld_shared,
+            tc.ld_out .. shared_out,
+            shared_obj_out,
+            tc.ld_export_list and (tc.ld_export_list .. alloha.export_list) or ""
+        )
+    )
+end
+
 if options.test then
     -- Compile tests with debug flags.
     local test_exe_out = out_dir .. os_info.path_sep .. alloha.test_exe .. os_info.exe_ext
@@ -201,7 +299,7 @@ if options.test then
             tc.cc,
             tc.opt_std .. alloha.std,
             tc.flags_common,
-            tc.flags_debug,
+            debug_flags(tc),
             concat(alloha.defines, " " .. tc.opt_define, true),
             concat(alloha.debug_defines, " " .. tc.opt_define, true),
             tc.opt_include .. alloha.include_dir,
@@ -212,6 +310,242 @@ if options.test then
     )
     -- Run tests.
     exec(test_exe_out)
+
+    -- Compile the tests of the C++ interface, linking against the library.
+    local test_cxx_exe_out = out_dir .. os_info.path_sep .. alloha.test_cxx_exe .. os_info.exe_ext
+    exec(
+        string.format(
+            string.rep("%s ", 9),
+            tc.cxx,
+            tc.flags_cxx,
+            debug_flags(tc),
+            concat(alloha.defines, " " .. tc.opt_define, true),
+            concat(alloha.debug_defines, " " .. tc.opt_define, true),
+            tc.opt_include .. alloha.include_dir,
+            tc.opt_out_exe .. test_cxx_exe_out,
+            alloha.test_cxx_src,
+            lib_out
+        )
+    )
+    exec(test_cxx_exe_out)
+end
+
+if options.bench then
+    local bench_exe_out = out_dir .. os_info.path_sep .. alloha.bench_exe .. os_info.exe_ext
+    exec(
+        string.format(
+            string.rep("%s ", 9),
+            tc.cc,
+            tc.opt_std .. alloha.std,
+            tc.flags_common,
+            tc.flags_release,
+            concat(alloha.defines, " " .. tc.opt_define, true),
+            tc.opt_include .. alloha.include_dir,
+            tc.opt_out_obj .. out_dir .. os_info.path_sep .. alloha.bench_exe .. os_info.obj_ext,
+            tc.opt_out_exe .. bench_exe_out,
+            alloha.bench_src
+        )
+    )
+    exec(bench_exe_out)
+
+    -- The C++ benchmarks link against a release build of the library.
+    local bench_obj_out = out_dir .. os_info.path_sep .. alloha.lib .. "_bench" .. os_info.obj_ext
+    local bench_cxx_exe_out = out_dir .. os_info.path_sep .. alloha.bench_cxx_exe .. os_info.exe_ext
+    exec(
+        string.format(
+            string.rep("%s ", 9),
+            tc.cc,
+            tc.opt_no_link,
+            tc.opt_std .. alloha.std,
+            tc.flags_common,
+            tc.flags_release,
+            concat(alloha.defines, " " .. tc.opt_define, true),
+            tc.opt_include .. alloha.include_dir,
+            tc.opt_out_obj .. bench_obj_out,
+            alloha.src
+        )
+    )
+    exec(
+        string.format(
+            string.rep("%s ", 8),
+            tc.cxx,
+            tc.flags_cxx,
+            tc.flags_release,
+            concat(alloha.defines, " " .. tc.opt_define, true),
+            tc.opt_include .. alloha.include_dir,
+            tc.opt_out_exe .. bench_cxx_exe_out,
+            alloha.bench_cxx_src,
+            bench_obj_out
+        )
+    )
+    exec(bench_cxx_exe_out)
+end
+
+if options.matrix then
+    assert(not os_windows, "The test matrix is only supported on Linux")
+
+    local matrix_dir = out_dir .. os_info.path_sep .. "matrix"
+    exec("mkdir -p " .. matrix_dir, true)
+
+    -- Optional features are either all compiled in or all left out, so that both the hooks in the
+    -- allocation paths and their absence get tested. With the features on, random yields are also
+    -- injected at the scheduling points of the concurrent code paths (see `ALLOHA_SCHED_POINT`).
+    local features = {
+        { name = "on", defines = { "ALLOHA_STRESS_SCHEDULE", "ALLOHA_ARENA_TAGGING" } },
+        { name = "off", defines = { "ALLOHA_NO_SAMPLE", "ALLOHA_NO_USDT" } },
+    }
+
+    -- Collect every configuration of the matrix: compiler x build type x sanitizers x features.
+    local configs = {}
+    for _, cc_name in ipairs({ "gcc", "clang" }) do
+        local cc = compilers[cc_name]
+        local found = os.execute("command -v " .. cc.cc .. os_info.silence_cmd)
+        if found == true or found == 0 then
+            local sanitizers = {
+                { name = "nosan", flags = "" },
+                { name = "asan", flags = cc.flags_sanitize },
+                { name = "tsan", flags = cc.flags_sanitize_thread },
+            }
+            for _, build_type in ipairs({ "debug", "release" }) do
+                for _, san in ipairs(sanitizers) do
+                    for _, feature in ipairs(features) do
+                        table.insert(configs, {
+                            name = string.format("%s-%s-%s-%s", cc_name, build_type, san.name, feature.name),
+                            src = alloha.test_src,
+                            exe = alloha.test_exe,
+                            tc = cc,
+                            flags = (build_type == "release" and cc.flags_release or cc.flags_debug)
+                                .. " "
+                                .. san.flags,
+                            defines = join(
+                                (build_type == "release") and alloha.defines
+                                    or join(alloha.defines, alloha.debug_defines),
+                                feature.defines
+                            ),
+                        })
+                    end
+                end
+            end
+
+            -- The tests of the C++ interface, linked against the library.
+            table.insert(configs, {
+                name = string.format("%s-debug-asan-coro", cc_name),
+                src = alloha.src,
+                cxx_src = alloha.test_cxx_src,
+                exe = alloha.test_cxx_exe,
+                tc = cc,
+                flags = debug_flags(cc),
+                defines = join(alloha.defines, alloha.debug_defines),
+            })
+
+            -- Benchmarks are only meaningful in release builds without sanitizers.
+            table.insert(configs, {
+                name = string.format("%s-release-bench", cc_name),
+                src = alloha.bench_src,
+                exe = alloha.bench_exe,
+                tc = cc,
+                flags = cc.flags_release,
+                defines = alloha.defines,
+            })
+            table.insert(configs, {
+                name = string.format("%s-release-bench-coro", cc_name),
+                src = alloha.src,
+                cxx_src = alloha.bench_cxx_src,
+                exe = alloha.bench_cxx_exe,
+                tc = cc,
+                flags = cc.flags_release,
+                defines = alloha.defines,
+            })
+        else
+            print(string.format("\x1b[1;33mskipping ::\x1b[0m %s not found", cc.cc))
+        end
+    end
+
+    -- Spawn one worker process per configuration, they all run in parallel. Each worker compiles and
+    -- runs its test executable, logging to its own file and reporting its exit status and duration.
+    local workers = {}
+    for _, cfg in ipairs(configs) do
+        local exe = matrix_dir .. os_info.path_sep .. cfg.exe .. "_" .. cfg.name
+        local log = exe .. ".log"
+        local compile = nil
+        if cfg.cxx_src then
+            -- The C++ sources are linked against an object of the library.
+            local obj = exe .. os_info.obj_ext
+            compile = string.format(
+                string.rep("%s ", 9) .. "&& " .. string.rep("%s ", 8),
+                cfg.tc.cc,
+                cfg.tc.opt_no_link,
+                cfg.tc.opt_std .. alloha.std,
+                cfg.tc.flags_common,
+                cfg.flags,
+                concat(cfg.defines, " " .. cfg.tc.opt_define, true),
+                cfg.tc.opt_include .. alloha.include_dir,
+                cfg.tc.opt_out_obj .. obj,
+                cfg.src,
+                cfg.tc.cxx,
+                cfg.tc.flags_cxx,
+                cfg.flags,
+                concat(cfg.defines, " " .. cfg.tc.opt_define, true),
+                cfg.tc.opt_include .. alloha.include_dir,
+                cfg.tc.opt_out_exe .. exe,
+                cfg.cxx_src,
+                obj
+            )
+        else
+            compile = string.format(
+                string.rep("%s ", 8),
+                cfg.tc.cc,
+                cfg.tc.opt_std .. alloha.std,
+                cfg.tc.flags_common,
+                cfg.flags,
+                concat(cfg.defines, " " .. cfg.tc.opt_define, true),
+                cfg.tc.opt_include .. alloha.include_dir,
+                cfg.tc.opt_out_exe .. exe,
+                cfg.src
+            )
+        end
+        local script = string.format(
+            "start=$(date +%%s%%N); (%s && %s) > %s 2>&1; status=$?; "
+                .. "echo \"$status $(( ($(date +%%s%%N) - start) / 1000000 ))\"",
+            compile,
+            exe,
+            log
+        )
+        if not options.quiet then
+            print("\x1b[1;35mspawning ::\x1b[0m " .. cfg.name)
+        end
+        table.insert(workers, { cfg = cfg, log = log, handle = io.popen("sh -c '" .. script .. "'") })
+    end
+
+    -- Wait for the workers and summarize the results.
+    local failures = 0
+    print(string.format("\n%-28s %-6s %10s", "configuration", "result", "time (ms)"))
+    print(string.rep("-", 46))
+    for _, w in ipairs(workers) do
+        local status, elapsed_ms = w.handle:read("*a"):match("(%d+)%s+(%d+)")
+        w.handle:close()
+        local passed = (status == "0")
+        if not passed then
+            failures = failures + 1
+        end
+        print(
+            string.format(
+                "%-28s %s %10s",
+                w.cfg.name,
+                passed and "\x1b[1;32mpass  \x1b[0m" or "\x1b[1;31mfail  \x1b[0m",
+                elapsed_ms or "?"
+            )
+        )
+        if not passed then
+            print("    log: " .. w.log)
+        end
+    end
+    print(string.rep("-", 46))
+    print(string.format("%d of %d configurations passed", #workers - failures, #workers))
+
+    if failures ~= 0 then
+        os.exit(1)
+    end
 end
 
 print(string.format("\x1b[1;35mtime elapsed ::\x1b[0m %.5f seconds", os.clock() - start_time))
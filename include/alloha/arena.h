@@ -5,6 +5,40 @@
 #pragma once
 
 #include <alloha/core.h>
+#include <alloha/oom.h>
+
+ALLOHA_EXTERN_C_BEGIN
+
+struct stack;
+
+/// Limit on the memory that sub-arenas may carve from their parents, see `arena_sub`.
+///
+/// A budget is charged once per sub-arena, with its whole capacity, so that allocations within the
+/// sub-arena remain a single bump. When the sub-arena ends, its unused tail is refunded and only
+/// the memory actually used by it stays accounted. Budgets can be shared by many sub-arenas, for
+/// instance every arena handed out to a given subsystem. When the parent is cleared, `used` should
+/// be reset by the user.
+struct arena_budget {
+    usize limit;  ///< Maximum number of bytes that may be charged to the budget.
+    usize used;   ///< Number of bytes currently charged to the budget.
+};
+
+/// Boundaries of a block allocated by an arena, see `arena_tag`.
+struct arena_tag {
+    usize offset;   ///< Offset of the block from the start of the arena memory.
+    usize size;     ///< Size, in bytes, of the block.
+    usize padding;  ///< Alignment padding, in bytes, preceding the block.
+};
+
+/// Side table recording the blocks allocated by an arena, see `arena_tag`.
+///
+/// The table **does not own** its memory. Records are kept in the order of their offsets.
+struct arena_tags {
+    struct arena_tag* tags;      ///< Memory holding the records.
+    usize             capacity;  ///< Maximum number of records held by `tags`.
+    usize             count;     ///< Number of records, possibly including freed blocks.
+    usize             dropped;   ///< Number of blocks left unrecorded for lack of capacity.
+};
 
 /// Arena allocator
 ///
@@ -53,10 +87,22 @@ struct arena {
     u8*   buf;       ///< Buffer containing the memory managed by the allocator.
     usize capacity;  ///< Capacity, in bytes, of `buf`.
     usize offset;    ///< Offset to the free memory space, relative to `buf`.
+
+    usize reserved_offset;  ///< Start of the pending reservation, see `arena_reserve`.
+    usize reserved_size;    ///< Size of the pending reservation, zero if there is none.
+
+    /// Budget charged with the capacity of the arena, if it was carved from a parent allocator.
+    struct arena_budget* budget;
+
+    /// Policy applied when the arena runs out of memory, see `alloha/oom.h`. Null by default.
+    struct alloha_oom_policy const* oom;
+
+    /// Side table recording the blocks of the arena, see `arena_tag`. Null by default.
+    struct arena_tags* tags;
 };
 
 /// Create a new arena.
-struct arena arena_new(usize capacity, u8* buf);
+ALLOHA_API struct arena arena_new(usize capacity, u8* buf);
 
 /// Initialize an existing arena allocator.
 ///
@@ -65,7 +111,7 @@ struct arena arena_new(usize capacity, u8* buf);
 ///     * `capacity`: Size, in bytes, of the provided block of memory `buf`.
 ///     * `buf`: Pointer to the block of memory that will be managed, but not owned, by the
 ///              allocator.
-void arena_init(struct arena* restrict arena, usize capacity, u8* restrict buf);
+ALLOHA_API void arena_init(struct arena* restrict arena, usize capacity, u8* restrict buf);
 
 /// Allocate a block of memory satisfying a given alignment.
 ///
@@ -75,8 +121,8 @@ void arena_init(struct arena* restrict arena, usize capacity, u8* restrict buf);
 ///     * `alignment`: The alignment, in bytes, needed by the new block of memory.
 ///
 /// @return Pointer to the newly allocated block of memory. This can be null if the allocation
-///         failed.
-u8* arena_alloc_aligned(struct arena* arena, usize size, u32 alignment);
+///         failed, in which case the failure policy of the arena was applied.
+ALLOHA_API u8* arena_alloc_aligned(struct arena* arena, usize size, u32 alignment);
 
 /// Allocates a block of memory with a default alignment.
 ///
@@ -85,7 +131,7 @@ u8* arena_alloc_aligned(struct arena* arena, usize size, u32 alignment);
 /// Parameters:
 ///     * `arena`: The arena allocator responsible for the allocation.
 ///     * `size`: The size, in bytes, of the new block of memory.
-u8* arena_alloc(struct arena* arena, usize size);
+ALLOHA_API u8* arena_alloc(struct arena* arena, usize size);
 
 /// Reallocates a given block of memory.
 ///
@@ -97,15 +143,157 @@ u8* arena_alloc(struct arena* arena, usize size);
 ///     * `new_size`: Desired size, in bytes, for the resizing of `old_mem`.
 ///     * `alignment`: The alignment to be used if a new allocation is needed. Should always be a
 ///                    power of two.
-u8* arena_realloc(
+ALLOHA_API u8* arena_realloc(
     struct arena* restrict arena,
     u8* restrict old_mem,
     usize old_mem_size,
     usize new_size,
     u32   alignment);
 
+/// Reserve the free memory of the arena for a write of unknown size.
+///
+/// Returns the start of the free space without advancing the offset, so that data whose final
+/// size isn't known up front (such as the result of a `read` or of a decompression) can be written
+/// directly into the arena. The write is then finalized by `arena_commit`. No other allocation
+/// should be made from the arena while the reservation is pending.
+///
+/// Parameters:
+///     * `arena`: The arena allocator responsible for the reservation.
+///     * `max_size`: Maximum number of bytes that may be written to the reserved span.
+///     * `alignment`: The alignment, in bytes, needed by the reserved span.
+///
+/// Return: Pointer to the reserved span, valid for `arena->reserved_size` bytes, which is the
+///         whole free space of the arena and at least `max_size`. This can be null if there isn't
+///         enough memory, in which case the failure policy of the arena was applied.
+ALLOHA_API u8* arena_reserve(struct arena* arena, usize max_size, u32 alignment);
+
+/// Finalize the pending reservation of the arena.
+///
+/// Parameters:
+///     * `arena`: The arena allocator whose reservation should be committed.
+///     * `used`: Number of bytes of the reserved span actually written, at most `reserved_size`.
+///               Committing zero bytes discards the reservation.
+///
+/// Return: Pointer to the block of `used` bytes now allocated by the arena, or null if nothing was
+///         committed.
+ALLOHA_API u8* arena_commit(struct arena* arena, usize used);
+
 /// Reset the arena's offset
-void arena_clear(struct arena* arena);
+ALLOHA_API void arena_clear(struct arena* arena);
+
+/// Pre-fault the free memory of the arena.
+///
+/// Backs the pages of the free region of the arena with physical memory up front, so that the
+/// first allocations touching them don't pay for page faults. This is best done at startup, before
+/// the arena gets used in latency sensitive paths. The contents of the arena are preserved.
+///
+/// Parameters:
+///     * `arena`: The arena whose free memory should be pre-faulted.
+///     * `thread_count`: Maximum number of threads used to touch the pages of huge arenas, see
+///                       `vmem_prefault`.
+ALLOHA_API void arena_prefault(struct arena* arena, u32 thread_count);
+
+/// Record the boundaries of the blocks of the arena in a side table.
+///
+/// Arenas keep no metadata per block, so this is how their blocks can be listed by `arena_walk`
+/// and `arena_dump` when debugging. Only available when the library is compiled with
+/// `ALLOHA_ARENA_TAGGING`, so that arenas otherwise pay nothing for it. Blocks allocated before the
+/// call, or once the table is full, aren't recorded. Records of blocks freed by clearing or
+/// rewinding the arena are trimmed on its next allocation.
+///
+/// Parameters:
+///     * `arena`: The arena whose blocks should be recorded.
+///     * `tags`: The table to be filled, emptied by the call. Null stops the recording.
+///
+/// Return: Whether the blocks of the arena are now recorded.
+ALLOHA_API bool arena_tag(struct arena* arena, struct arena_tags* tags);
+
+/// Options of `vm_arena_create`.
+enum vm_arena_flags {
+    VM_ARENA_DEFAULT = 0,
+
+    /// Back every page of the arena with physical memory at creation time.
+    VM_ARENA_POPULATE = 1 << 0,
+
+    /// Lock the pages of the arena in physical memory, so that they are never paged out nor
+    /// reclaimed under memory pressure. Without `VM_ARENA_POPULATE`, pages are locked as they get
+    /// faulted in (`MLOCK_ONFAULT`), so that only the memory actually used counts against
+    /// `RLIMIT_MEMLOCK`.
+    VM_ARENA_LOCK = 1 << 1,
+};
+
+/// Arena allocator owning a block of virtual memory.
+///
+/// Meant for latency critical paths: the memory is obtained directly from the operating system and
+/// can be pre-faulted and locked, keeping page faults and reclaim stalls out of the allocations.
+/// If locking isn't allowed by the system, the arena is still created but left unlocked, which can
+/// be checked via `locked_bytes` (see `vmem_lock`).
+struct vm_arena {
+    struct arena arena;         ///< Allocator over the owned memory.
+    usize        locked_bytes;  ///< Bytes of the arena locked in physical memory.
+};
+
+/// Create an arena over a newly mapped block of virtual memory.
+///
+/// Parameters:
+///     * `vm_arena`: The arena to be created.
+///     * `capacity`: Capacity, in bytes, of the arena. Rounded up to a multiple of the page size.
+///     * `flags`: Combination of `enum vm_arena_flags`.
+///
+/// Return: Whether the memory of the arena could be mapped.
+ALLOHA_API bool vm_arena_create(struct vm_arena* vm_arena, usize capacity, u32 flags);
+
+/// Unlock and unmap the memory owned by the arena.
+ALLOHA_API void vm_arena_destroy(struct vm_arena* vm_arena);
+
+/// Carve a sub-arena from the free memory of a parent arena.
+///
+/// The sub-arena is an independent arena over a block allocated from the parent, so it can be
+/// cleared without affecting its siblings, while clearing the parent reclaims every sub-arena at
+/// once. Sub-arenas can themselves be used as parents, allocations in a deep hierarchy are still a
+/// single bump of the innermost arena. The failure policy of the parent isn't inherited.
+///
+/// Parameters:
+///     * `parent`: The arena from which the memory of the sub-arena is allocated.
+///     * `capacity`: Capacity, in bytes, of the sub-arena.
+///     * `alignment`: The alignment, in bytes, of the memory of the sub-arena.
+///     * `budget`: Optional budget charged with `capacity`.
+///
+/// Return: The new sub-arena. If either the parent or the budget can't afford it, the failure
+///         policy of the parent is applied and an arena with no capacity is returned.
+ALLOHA_API struct arena arena_sub(
+    struct arena* restrict        parent,
+    usize                         capacity,
+    u32                           alignment,
+    struct arena_budget* restrict budget);
+
+/// End a sub-arena carved by `arena_sub`.
+///
+/// The blocks allocated by the sub-arena remain valid for as long as the memory of the parent is.
+/// The unused tail of the sub-arena is refunded to its budget and, if the sub-arena is the last
+/// block of the parent, given back to the parent.
+///
+/// Parameters:
+///     * `parent`: The arena from which the sub-arena was carved.
+///     * `child`: The sub-arena to be ended, left with no capacity.
+///
+/// Return: Number of bytes given back to the parent.
+ALLOHA_API usize arena_sub_end(struct arena* restrict parent, struct arena* restrict child);
+
+/// Carve a sub-arena from a stack allocator, see `arena_sub`.
+ALLOHA_API struct arena arena_sub_stack(
+    struct stack* restrict        parent,
+    usize                         capacity,
+    u32                           alignment,
+    struct arena_budget* restrict budget);
+
+/// End a sub-arena carved by `arena_sub_stack`.
+///
+/// The memory of the sub-arena, and of every block allocated from the stack after it, is released
+/// and its whole capacity refunded to its budget.
+///
+/// Return: Whether the sub-arena could be released from the stack.
+ALLOHA_API bool arena_sub_stack_end(struct stack* restrict parent, struct arena* restrict child);
 
 /// Scratch arena allocator.
 ///
@@ -120,13 +308,15 @@ struct scratch_arena {
 };
 
 /// Create a new scratch arena allocator.
-struct scratch_arena scratch_arena_start(struct arena* arena);
+ALLOHA_API struct scratch_arena scratch_arena_start(struct arena* arena);
 
 /// Create a new scratch arena with the current state of the parent of `scratch`.
-struct scratch_arena scratch_arena_decouple(struct scratch_arena const* scratch);
+ALLOHA_API struct scratch_arena scratch_arena_decouple(struct scratch_arena const* scratch);
 
 /// Restore the state of the associated arena allocator.
 ///
 /// Restores the offset state of the arena allocator saved in `scratch` when `scratch_arena_start`
 /// was called.
-void scratch_arena_end(struct scratch_arena* scratch);
+ALLOHA_API void scratch_arena_end(struct scratch_arena* scratch);
+
+ALLOHA_EXTERN_C_END
@@ -0,0 +1,84 @@
+/// Thread-local implicit allocator context.
+///
+/// Library code may allocate from whichever allocator its caller installed for the current thread,
+/// instead of threading an allocator through every function:
+/// ```C
+/// struct arena arena = arena_new(capacity, buf);
+/// alloha_push_allocator(alloha_arena_allocator(&arena));
+/// {
+///     ... code calling `alloha_ctx_alloc` now allocates from `arena` ...
+/// }
+/// alloha_pop_allocator();
+/// ```
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#pragma once
+
+#include <alloha/core.h>
+
+ALLOHA_EXTERN_C_BEGIN
+
+struct arena;
+struct down_arena;
+struct recycle_arena;
+struct stack;
+
+/// Maximum number of allocators that can be pushed on top of each other in a single thread.
+#define ALLOHA_CONTEXT_MAX_DEPTH 32
+
+/// Allocation function of an allocator installed in the context.
+typedef u8* (*alloha_alloc_fn)(void* allocator, usize size, u32 alignment);
+
+/// Type-erased allocator.
+struct alloha_allocator {
+    alloha_alloc_fn alloc;      ///< Allocation function, called with `allocator`.
+    void*           allocator;  ///< State of the allocator, such as a `struct arena*`.
+};
+
+/// Allocator dispatching to `arena_alloc_aligned`.
+ALLOHA_API struct alloha_allocator alloha_arena_allocator(struct arena* arena);
+
+/// Allocator dispatching to `stack_alloc_aligned`.
+ALLOHA_API struct alloha_allocator alloha_stack_allocator(struct stack* stack);
+
+/// Allocator dispatching to `down_arena_alloc_aligned`.
+ALLOHA_API struct alloha_allocator alloha_down_arena_allocator(struct down_arena* arena);
+
+/// Allocator dispatching to `recycle_arena_alloc_aligned`.
+ALLOHA_API struct alloha_allocator alloha_recycle_arena_allocator(struct recycle_arena* arena);
+
+/// Install an allocator as the current one of the calling thread.
+///
+/// The previous allocator is restored by the matching `alloha_pop_allocator`.
+///
+/// Parameters:
+///     * `allocator`: The allocator to be used by `alloha_ctx_alloc` from now on.
+///
+/// Return: Whether the allocator was installed, which fails if `ALLOHA_CONTEXT_MAX_DEPTH`
+///         allocators are already installed.
+ALLOHA_API bool alloha_push_allocator(struct alloha_allocator allocator);
+
+/// Restore the allocator installed before the last call to `alloha_push_allocator`.
+ALLOHA_API void alloha_pop_allocator(void);
+
+/// Current allocator of the calling thread.
+///
+/// Return: The last allocator pushed, or an allocator that always fails if there is none.
+ALLOHA_API struct alloha_allocator alloha_current_allocator(void);
+
+/// Allocate a block of memory from the current allocator of the calling thread.
+///
+/// Parameters:
+///     * `size`: The size, in bytes, of the new block of memory.
+///     * `alignment`: The alignment, in bytes, needed by the new block of memory.
+///
+/// Return: Pointer to the new block of memory, or null if the allocation failed. Without any
+///         allocator installed, allocations fail with `ALLOHA_ERROR_OUT_OF_MEMORY`.
+ALLOHA_API u8* alloha_ctx_alloc_aligned(usize size, u32 alignment);
+
+/// Allocate a block of memory with an alignment of `ALLOHA_DEFAULT_ALIGNMENT` from the current
+/// allocator of the calling thread.
+ALLOHA_API u8* alloha_ctx_alloc(usize size);
+
+ALLOHA_EXTERN_C_END
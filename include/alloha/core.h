@@ -7,6 +7,58 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+/// Symbol visibility of the public API.
+///
+/// When building the shared library (`ALLOHA_BUILD_SHARED`) every public function is marked for
+/// export, everything else is hidden by `-fvisibility=hidden`. Consumers of the Windows DLL should
+/// define `ALLOHA_USE_SHARED` so that the symbols get imported.
+#if defined(ALLOHA_BUILD_SHARED)
+#    if defined(_WIN32)
+#        define ALLOHA_API __declspec(dllexport)
+#    else
+#        define ALLOHA_API __attribute__((visibility("default")))
+#    endif
+#elif defined(ALLOHA_USE_SHARED) && defined(_WIN32)
+#    define ALLOHA_API __declspec(dllimport)
+#else
+#    define ALLOHA_API
+#endif
+
+/// Thread-local storage accessed on hot paths.
+///
+/// Uses the initial-exec model: a single load relative to the thread pointer, instead of a call to
+/// `__tls_get_addr` when the library is built as position independent code. The cost is that the
+/// shared library takes a few bytes of static TLS, which matters only if it's loaded via `dlopen`
+/// late in the program.
+#if defined(__cplusplus)
+#    define ALLOHA_THREAD_LOCAL_KEYWORD thread_local
+#else
+#    define ALLOHA_THREAD_LOCAL_KEYWORD _Thread_local
+#endif
+#if defined(__GNUC__) && !defined(_WIN32)
+#    define ALLOHA_THREAD_LOCAL \
+        ALLOHA_THREAD_LOCAL_KEYWORD __attribute__((tls_model("initial-exec")))
+#else
+#    define ALLOHA_THREAD_LOCAL ALLOHA_THREAD_LOCAL_KEYWORD
+#endif
+
+/// Compatibility with C++ translation units.
+///
+/// The declarations of the library get C linkage, and `restrict`, which isn't a C++ keyword, maps
+/// to the `__restrict` extension supported by every major C++ compiler.
+#if defined(__cplusplus)
+#    define ALLOHA_EXTERN_C_BEGIN extern "C" {
+#    define ALLOHA_EXTERN_C_END   }
+#    if !defined(restrict)
+#        define restrict __restrict
+#    endif
+#else
+#    define ALLOHA_EXTERN_C_BEGIN
+#    define ALLOHA_EXTERN_C_END
+#endif
+
+ALLOHA_EXTERN_C_BEGIN
+
 /// Unsigned integer type.
 typedef uint8_t  u8;
 typedef uint16_t u16;
@@ -37,19 +89,39 @@ typedef double f64;
 
 #define alloha_discard(res) ((void)res)
 
-#define alloha_alignof(x) _Alignof(x)
+#if defined(__cplusplus)
+#    define alloha_alignof(x) alignof(x)
+#else
+#    define alloha_alignof(x) _Alignof(x)
+#endif
 
 /// Check if a given number is a power of two.
 #define alloha_is_power_of_two(x) (((x) > 0) && !((x) & ((x)-1)))
 
 /// Subtract two values of unsigned size type avoiding underflow.
-usize usize_wrap_sub(usize lhs, usize rhs);
+ALLOHA_API usize usize_wrap_sub(usize lhs, usize rhs);
 
 #define alloha_ptr_add(ptr, offset) ((ptr) ? ((ptr) + (offset)) : NULL)
 #define alloha_ptr_sub(ptr, offset) ((ptr) ? ((ptr) - (offset)) : NULL)
 
+/// Scheduling point used by the concurrency stress tests.
+///
+/// Concurrent code paths should be annotated with `ALLOHA_SCHED_POINT()` wherever a context
+/// switch is likely to expose a race (e.g. between loading and publishing a shared value). When
+/// compiled with `ALLOHA_STRESS_SCHEDULE`, every annotated point randomly yields or delays the
+/// calling thread; otherwise the annotation compiles to nothing.
+#if defined(ALLOHA_STRESS_SCHEDULE)
+#    define ALLOHA_SCHED_POINT() alloha_sched_point()
+#else
+#    define ALLOHA_SCHED_POINT() ((void)0)
+#endif
+
+/// Randomly yield or delay the calling thread. Does nothing unless the library was compiled with
+/// `ALLOHA_STRESS_SCHEDULE`.
+ALLOHA_API void alloha_sched_point(void);
+
 /// Safely copy memory from one region to the other.
-void memory_copy(u8* dest, u8 const* src, usize size);
+ALLOHA_API void memory_copy(u8* dest, u8 const* src, usize size);
 
 /// Computes the next address with the required alignment.
 ///
@@ -58,7 +130,7 @@ void memory_copy(u8* dest, u8 const* src, usize size);
 ///     * `alignment`: The alignment requirement that should be used to compute the next address.
 ///
 /// Return: Next address, with respect to `ptr` that satisfies the required alignment.
-uptr align_forward(uptr ptr, u32 alignment);
+ALLOHA_API uptr align_forward(uptr ptr, u32 alignment);
 
 /// Given an address, computes the padding needed to reach the next address that fits the header and
 /// satisfies the memory alignment requirements imposed by the header and memory.
@@ -71,4 +143,6 @@ uptr align_forward(uptr ptr, u32 alignment);
 ///
 /// Return: Memory padding such that when we offset `ptr` by the padding we obtain a space that fits
 ///         the header and satisfies all alignment requirements.
-u32 padding_with_header(uptr ptr, u32 alignment, u32 header_size, u32 header_alignment);
+ALLOHA_API u32 padding_with_header(uptr ptr, u32 alignment, u32 header_size, u32 header_alignment);
+
+ALLOHA_EXTERN_C_END
@@ -0,0 +1,196 @@
+/// C++20 coroutine frames allocated from Alloha allocators.
+///
+/// Every call of a coroutine allocates its frame, by default via the global `operator new`.
+/// Promise types inheriting from `alloha::frame_promise` get their frames from a per-thread
+/// `frame_allocator` instead:
+/// ```C++
+/// struct task {
+///     struct promise_type : alloha::frame_promise {
+///         ... the usual promise interface ...
+///     };
+/// };
+/// ```
+/// Frames of nested async calls are usually destroyed in the reverse order of their creation, so
+/// they are pushed to a `struct stack`, making both the allocation and the release a bump. A frame
+/// destroyed out of LIFO order is only marked as dead, and popped once every frame above it is
+/// gone. When the stack is full, frames fall back to a `struct recycle_arena`, acting as a pool of
+/// size classes, and then to the global `operator new`.
+///
+/// Note: Frames must be destroyed by the thread that created them, before that thread exits.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#pragma once
+
+#include <alloha/core.h>
+#include <alloha/oom.h>
+#include <alloha/recycle_arena.h>
+#include <alloha/stack.h>
+#include <alloha/vmem.h>
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+
+/// Capacity, in bytes, of the stack of frames of each thread.
+#if !defined(ALLOHA_CORO_STACK_CAPACITY)
+#    define ALLOHA_CORO_STACK_CAPACITY ((usize)1 << 20)
+#endif
+
+/// Capacity, in bytes, of the pool of frames of each thread, used once the stack is full.
+#if !defined(ALLOHA_CORO_POOL_CAPACITY)
+#    define ALLOHA_CORO_POOL_CAPACITY ((usize)1 << 20)
+#endif
+
+namespace alloha {
+
+/// Allocator from which a frame was obtained.
+enum class frame_origin : u32 {
+    stack,
+    pool,
+    heap,
+};
+
+/// Header preceding each frame, keeping the frame itself aligned as if allocated by `operator new`.
+struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) frame_header {
+    void const*  owner;   ///< Allocator of the thread that created the frame.
+    frame_origin origin;  ///< Allocator holding the frame.
+    bool         dead;    ///< Destroyed out of LIFO order, waiting to be popped.
+};
+
+/// Number of frames handled by each path of a `frame_allocator`.
+struct frame_stats {
+    u64 stack_frames;   ///< Frames pushed to the stack.
+    u64 pool_frames;    ///< Frames allocated from the pool, with the stack full.
+    u64 heap_frames;    ///< Frames allocated via `operator new`, with the pool full.
+    u64 deferred_pops;  ///< Stack frames destroyed out of LIFO order.
+};
+
+/// Coroutine frame allocator of a thread.
+class frame_allocator {
+public:
+    frame_allocator() = default;
+    frame_allocator(frame_allocator const&) = delete;
+    frame_allocator& operator=(frame_allocator const&) = delete;
+
+    ~frame_allocator() {
+        assert(stack_.offset == 0 && "frame_allocator destroyed with frames still alive");
+        vmem_free(stack_.buf, stack_.capacity);
+        vmem_free(pool_.arena.buf, pool_.arena.capacity);
+    }
+
+    /// Allocator of the calling thread, reserving its memory on first use.
+    static frame_allocator& current() {
+        static thread_local frame_allocator allocator;
+        return allocator;
+    }
+
+    /// Allocate a frame of `size` bytes, never returning null.
+    void* allocate(std::size_t size) {
+        if (!reserved_) {
+            reserve();
+        }
+
+        usize const total     = sizeof(frame_header) + size;
+        u32 const   alignment = alignof(frame_header);
+        u8*         block     = nullptr;
+        auto        origin    = frame_origin::stack;
+
+        // The stack is only tried if the frame is known to fit, sparing the failure policy.
+        usize const worst_case = total + sizeof(struct stack_header) + alignment;
+        if (worst_case <= stack_.capacity - stack_.offset) {
+            block = stack_alloc_aligned(&stack_, total, alignment);
+            ++stats_.stack_frames;
+        } else if ((block = recycle_arena_alloc_aligned(&pool_, total, alignment))) {
+            origin = frame_origin::pool;
+            ++stats_.pool_frames;
+        } else {
+            block  = static_cast<u8*>(::operator new(total));
+            origin = frame_origin::heap;
+            ++stats_.heap_frames;
+        }
+
+        auto* header = new (block) frame_header{this, origin, false};
+        return header + 1;
+    }
+
+    /// Release a frame of `size` bytes obtained via `allocate`.
+    void deallocate(void* frame, std::size_t size) noexcept {
+        auto* header = static_cast<frame_header*>(frame) - 1;
+        assert(header->owner == this && "coroutine frame destroyed by another thread");
+
+        usize const total = sizeof(frame_header) + size;
+        switch (header->origin) {
+            case frame_origin::stack: {
+                if (reinterpret_cast<u8*>(header) != top()) {
+                    header->dead = true;
+                    ++stats_.deferred_pops;
+                    return;
+                }
+
+                // Pop the frame, along with the dead frames right below it.
+                do {
+                    stack_pop(&stack_);
+                } while (top() && reinterpret_cast<frame_header*>(top())->dead);
+                break;
+            }
+            case frame_origin::pool: {
+                recycle_arena_free(&pool_, reinterpret_cast<u8*>(header), total);
+                break;
+            }
+            case frame_origin::heap: {
+                ::operator delete(header);
+                break;
+            }
+        }
+    }
+
+    /// Amount of bytes, including headers and padding, used by the frames on the stack.
+    usize stack_used() const {
+        return stack_.offset;
+    }
+
+    frame_stats stats() const {
+        return stats_;
+    }
+
+private:
+    /// Start of the last frame pushed to the stack, if any.
+    u8* top() const {
+        return stack_.offset != 0 ? stack_.buf + stack_.previous_offset : nullptr;
+    }
+
+    void reserve() {
+        usize const stack_capacity = ALLOHA_CORO_STACK_CAPACITY;
+        usize const pool_capacity  = ALLOHA_CORO_POOL_CAPACITY;
+        u8*         stack_buf      = vmem_alloc(stack_capacity, VMEM_DEFAULT);
+        u8*         pool_buf       = vmem_alloc(pool_capacity, VMEM_DEFAULT);
+        stack_init(&stack_, stack_buf ? stack_capacity : 0, stack_buf);
+        recycle_arena_init(&pool_, pool_buf ? pool_capacity : 0, pool_buf);
+        reserved_ = true;
+
+        // Running out of pool memory falls back to the heap, so it isn't reported.
+        pool_.arena.oom = &quiet_;
+    }
+
+    static constexpr alloha_oom_policy quiet_ = {ALLOHA_OOM_RETURN_NULL, nullptr, nullptr, true};
+
+    struct stack         stack_    = {};
+    struct recycle_arena pool_     = {};
+    frame_stats          stats_    = {};
+    bool                 reserved_ = false;
+};
+
+/// Mixin routing the frames of the coroutines of a promise type to the `frame_allocator` of the
+/// calling thread.
+struct frame_promise {
+    static void* operator new(std::size_t size) {
+        return frame_allocator::current().allocate(size);
+    }
+
+    static void operator delete(void* frame, std::size_t size) noexcept {
+        frame_allocator::current().deallocate(frame, size);
+    }
+};
+
+}  // namespace alloha
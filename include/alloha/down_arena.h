@@ -0,0 +1,103 @@
+/// Bump-down arena allocator.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#pragma once
+
+#include <alloha/core.h>
+#include <alloha/oom.h>
+
+ALLOHA_EXTERN_C_BEGIN
+
+/// Arena allocator bumping downwards.
+///
+/// Same as `struct arena`, but allocations are carved from the end of the buffer towards its
+/// start. Bumping down makes the allocation cheaper: the start of the new block is obtained by
+/// subtracting the size from the current top and aligning it down, which is a single mask, and
+/// the bounds check against the start of the buffer never needs to account for padding.
+///
+/// Memory layout:
+///    |   free space   |memory|padding|memory|
+///    ^                ^                     ^
+///    |                |                     |
+///  start             top                   end
+///    |                                      |
+///    |------------- capacity ---------------|
+///
+/// Note: The arena **does not own** its memory, see `struct arena`.
+struct down_arena {
+    u8*   buf;       ///< Buffer containing the memory managed by the allocator.
+    usize capacity;  ///< Capacity, in bytes, of `buf`.
+    u8*   top;       ///< Start of the last allocated block, everything below it is free.
+
+    /// Policy applied when the arena runs out of memory, see `alloha/oom.h`. Null by default.
+    struct alloha_oom_policy const* oom;
+};
+
+/// Create a new bump-down arena.
+ALLOHA_API struct down_arena down_arena_new(usize capacity, u8* buf);
+
+/// Initialize an existing bump-down arena.
+///
+/// Parameters:
+///     * `arena`: A pointer to the arena allocator to be initialized.
+///     * `capacity`: Size, in bytes, of the provided block of memory `buf`.
+///     * `buf`: Pointer to the block of memory that will be managed, but not owned, by the
+///              allocator.
+ALLOHA_API void down_arena_init(
+    struct down_arena* restrict arena,
+    usize capacity,
+    u8* restrict buf);
+
+/// Allocate a block of memory satisfying a given alignment.
+///
+/// Parameters:
+///     * `arena`: The arena allocator responsible for the allocation.
+///     * `size`: The size, in bytes, of the new block of memory.
+///     * `alignment`: The alignment, in bytes, needed by the new block of memory. Should always be
+///                    a power of two.
+///
+/// Return: Pointer to the newly allocated block of memory, or null if the allocation failed, in
+///         which case the failure policy of the arena was applied.
+ALLOHA_API u8* down_arena_alloc_aligned(struct down_arena* arena, usize size, u32 alignment);
+
+/// Allocates a block of memory with an alignment of `ALLOHA_DEFAULT_ALIGNMENT`.
+ALLOHA_API u8* down_arena_alloc(struct down_arena* arena, usize size);
+
+/// Reallocates a given block of memory.
+///
+/// Shrinking keeps the block as is. Growing the last allocated block moves its contents down in
+/// place, otherwise a new block is allocated and the contents are copied.
+///
+/// Parameters:
+///     * `arena`: The arena allocator whose memory contains the block pointed by `block`.
+///     * `block`: Pointer to the start of the memory block to be resized.
+///     * `current_capacity`: Size, in bytes, of `block`.
+///     * `new_capacity`: Desired size, in bytes, for the resizing of `block`.
+///     * `alignment`: The alignment of the resized block. Should always be a power of two.
+ALLOHA_API u8* down_arena_realloc(
+    struct down_arena* restrict arena,
+    u8* restrict block,
+    usize current_capacity,
+    usize new_capacity,
+    u32   alignment);
+
+/// Release every allocation of the arena.
+ALLOHA_API void down_arena_clear(struct down_arena* arena);
+
+/// Amount of bytes, including padding, currently allocated.
+ALLOHA_API usize down_arena_used(struct down_arena const* arena);
+
+/// Scratch bump-down arena allocator, see `struct scratch_arena`.
+struct scratch_down_arena {
+    struct down_arena* parent;
+    u8*                saved_top;
+};
+
+/// Save the state of the arena, to be restored by `scratch_down_arena_end`.
+ALLOHA_API struct scratch_down_arena scratch_down_arena_start(struct down_arena* arena);
+
+/// Restore the state of the arena saved in `scratch` when `scratch_down_arena_start` was called.
+ALLOHA_API void scratch_down_arena_end(struct scratch_down_arena* scratch);
+
+ALLOHA_EXTERN_C_END
@@ -0,0 +1,120 @@
+/// Fiber stack allocator.
+///
+/// Hands out the stacks of fibers or coroutines from slots of a single range of virtual memory,
+/// reserved up front, where each stack is preceded by guard pages that are never made accessible:
+///
+/// ```md
+///  |guard|  stack 0  |guard|  stack 1  |guard| ... |guard|  stack n  |
+///  ^     ^           ^
+///  |     |           |
+/// base  stack 0   slot 1
+///        base
+/// ```
+///
+/// Stacks grow down, towards their guard, so that an overflow faults rather than corrupting the
+/// neighbouring stack. Creating a stack with `mmap` and `mprotect` costs a couple of system calls
+/// each time; here, a slot is only made accessible the first time it's handed out, after which
+/// released stacks are recycled without any system call: either via the free list of the pool, or
+/// via a `struct fiber_stack_cache` owned by each scheduling thread, avoiding the lock of the pool.
+/// Stacks going back to the pool are idle, so their physical memory is released via
+/// `vmem_decommit`.
+///
+/// Note: On Linux, each slot handed out splits the mapping of the pool, and the number of mappings
+///       of a process is bounded by `vm.max_map_count` (65530 by default). Pools of more than about
+///       30000 stacks need that limit to be raised.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#pragma once
+
+#include <alloha/core.h>
+#include <alloha/oom.h>
+#include <alloha/thread.h>
+
+ALLOHA_EXTERN_C_BEGIN
+
+/// Maximum number of stacks held by a `struct fiber_stack_cache`.
+#define FIBER_STACK_CACHE_SIZE 16
+
+/// Fiber stack pool configuration.
+struct fiber_stack_config {
+    usize stack_size;  ///< Usable size, in bytes, of each stack. Rounded up to whole pages.
+    usize guard_size;  ///< Size, in bytes, of the guard below each stack. At least one page.
+    u32   max_stacks;  ///< Number of slots reserved by the pool.
+    bool  lazy;        ///< Release the memory of idle stacks lazily, see `vmem_decommit`.
+};
+
+/// Stack handed out by a pool, growing down from `base + size`.
+struct fiber_stack {
+    u8*   base;  ///< Lowest address of the stack, right above its guard.
+    usize size;  ///< Usable size, in bytes, of the stack.
+};
+
+struct fiber_stack_pool {
+    struct fiber_stack_config config;
+    u8*                       base;       ///< Start of the reserved range.
+    usize                     slot_size;  ///< Size, in bytes, of a guard and its stack.
+
+    struct alloha_mutex mutex;       ///< Guards the free list and `next_slot`.
+    u32*                free_slots;  ///< Indices of the released slots.
+    u32                 free_count;  ///< Number of slots in `free_slots`.
+    u32                 next_slot;   ///< First slot never handed out.
+
+    /// Policy applied when the pool runs out of slots, see `alloha/oom.h`. Null by default.
+    struct alloha_oom_policy const* oom;
+};
+
+/// Reserve the virtual memory of a pool.
+///
+/// Parameters:
+///     * `pool`: The pool to be created.
+///     * `config`: Configuration of the pool.
+///
+/// Return: Whether the memory of the pool could be reserved.
+ALLOHA_API bool fiber_stack_pool_create(
+    struct fiber_stack_pool* pool,
+    struct fiber_stack_config config);
+
+/// Unmap the memory of the pool. Every stack should have been released beforehand.
+ALLOHA_API void fiber_stack_pool_destroy(struct fiber_stack_pool* pool);
+
+/// Number of stacks that can still be acquired from the pool, not counting those held by caches.
+ALLOHA_API u32 fiber_stack_pool_available(struct fiber_stack_pool* pool);
+
+/// Acquire a stack from the pool. Thread-safe.
+///
+/// Return: The stack, or a null stack if every slot is in use, in which case the failure policy
+///         of the pool was applied.
+ALLOHA_API struct fiber_stack fiber_stack_acquire(struct fiber_stack_pool* pool);
+
+/// Release a stack back to the pool, releasing its physical memory. Thread-safe.
+ALLOHA_API void fiber_stack_release(struct fiber_stack_pool* pool, struct fiber_stack stack);
+
+/// Cache of released stacks, owned by a single thread.
+///
+/// Stacks are moved between the cache and its pool in batches, so that most acquisitions and
+/// releases touch neither the lock of the pool nor the operating system. Cached stacks keep their
+/// physical memory, since they are likely to be reused soon.
+struct fiber_stack_cache {
+    struct fiber_stack_pool* pool;
+    u32                      count;
+    u32                      slots[FIBER_STACK_CACHE_SIZE];
+};
+
+/// Initialize an empty cache of stacks of `pool`.
+ALLOHA_API void fiber_stack_cache_init(
+    struct fiber_stack_cache* restrict cache,
+    struct fiber_stack_pool* restrict  pool);
+
+/// Acquire a stack, refilling the cache from its pool if empty.
+ALLOHA_API struct fiber_stack fiber_stack_cache_acquire(struct fiber_stack_cache* cache);
+
+/// Release a stack to the cache, moving half of the cached stacks to the pool if full.
+ALLOHA_API void fiber_stack_cache_release(
+    struct fiber_stack_cache* cache,
+    struct fiber_stack        stack);
+
+/// Move every cached stack back to the pool, should be called before the owning thread exits.
+ALLOHA_API void fiber_stack_cache_flush(struct fiber_stack_cache* cache);
+
+ALLOHA_EXTERN_C_END
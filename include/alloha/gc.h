@@ -0,0 +1,127 @@
+/// Semi-space copying garbage collector.
+///
+/// Objects are bump-allocated from one of two arenas of the same capacity, the to-space. Once it
+/// fills up, a collection copies every object reachable from the registered roots into the other
+/// arena, in the breadth-first order of Cheney's algorithm, and clears the old one. Allocation is
+/// thus as cheap as an arena bump, while the memory of dead objects is reclaimed and the live ones
+/// end up compacted, at a cost proportional to the live data only.
+///
+/// The collector knows where the pointers of each object lie via its type, which lists the offsets
+/// of its pointer fields:
+/// ```C
+/// struct node {
+///     struct node* left;
+///     struct node* right;
+///     u64          value;
+/// };
+///
+/// static usize const node_ptrs[] = {offsetof(struct node, left), offsetof(struct node, right)};
+/// static struct gc_type const node_type = {
+///     .size            = sizeof(struct node),
+///     .pointer_count   = 2,
+///     .pointer_offsets = node_ptrs,
+/// };
+///
+/// struct node* root = (struct node*)gc_alloc(&heap, &node_type);
+/// gc_add_root(&heap, &root);
+/// ```
+/// Objects move on each collection, so any pointer to an object held outside of the heap has to be
+/// registered as a root, and is updated by the collector. Pointer fields may only point to the
+/// start of objects of the heap, or be null.
+///
+/// Memory layout of each space:
+///    |header|object|header|object| ... |   free space   |
+///    ^                                 ^                ^
+///    |                                 |                |
+///  start                            offset             end
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#pragma once
+
+#include <alloha/arena.h>
+#include <alloha/core.h>
+#include <alloha/oom.h>
+
+ALLOHA_EXTERN_C_BEGIN
+
+/// Alignment of every object of the heap.
+#define GC_ALIGNMENT ALLOHA_DEFAULT_ALIGNMENT
+
+/// Layout of a kind of object.
+struct gc_type {
+    usize        size;             ///< Size, in bytes, of the object.
+    u32          pointer_count;    ///< Amount of pointer fields of the object.
+    usize const* pointer_offsets;  ///< Offsets, in bytes, of the pointer fields of the object.
+};
+
+/// Header preceding each object.
+struct gc_header {
+    struct gc_type const* type;
+    u8*                   forward;  ///< Copy of the object during a collection, if already copied.
+};
+
+/// Heap configuration.
+struct gc_config {
+    usize space_capacity;  ///< Capacity, in bytes, of each of the two spaces.
+    u32   max_roots;       ///< Maximum amount of roots registered at once.
+};
+
+struct gc_heap {
+    struct arena spaces[2];
+    u32          to_space;  ///< Index of the space objects are allocated from.
+    void**       roots;     ///< Addresses of the registered pointers to objects.
+    u32          root_count;
+    u32          max_roots;
+    u64          collections;
+    u64          copied_bytes;  ///< Total of bytes copied by the collections.
+
+    /// Policy applied when the live objects leave no room for an allocation, see `alloha/oom.h`.
+    /// Null by default.
+    struct alloha_oom_policy const* oom;
+};
+
+/// Create a heap, mapping the memory of both spaces and of the roots.
+///
+/// Return: Whether the memory of the heap could be mapped.
+ALLOHA_API bool gc_heap_create(struct gc_heap* heap, struct gc_config config);
+
+/// Unmap the memory of the heap. Every object of the heap is released.
+ALLOHA_API void gc_heap_destroy(struct gc_heap* heap);
+
+/// Allocate a zeroed object, collecting the heap first if the to-space is full.
+///
+/// Parameters:
+///     * `heap`: The heap responsible for the allocation.
+///     * `type`: Layout of the object. Should outlive the object.
+///
+/// Return: Pointer to the new object, aligned to `GC_ALIGNMENT`, or null if the object doesn't fit
+///         even after a collection, in which case the failure policy of the heap was applied. Each
+///         retry of the policy collects the heap again.
+ALLOHA_API u8* gc_alloc(struct gc_heap* heap, struct gc_type const* type);
+
+/// Copy every object reachable from the roots to the other space, and release everything else.
+///
+/// Every pointer to an object of the heap, other than the roots and the pointer fields of the
+/// objects, is invalidated.
+ALLOHA_API void gc_collect(struct gc_heap* heap);
+
+/// Register a pointer to an object, or a null pointer, as a root of the heap.
+///
+/// Parameters:
+///     * `heap`: The heap holding the object.
+///     * `slot`: Address of the pointer, which gets updated whenever the object moves.
+///
+/// Return: Whether the root could be registered, false if `max_roots` are already registered.
+ALLOHA_API bool gc_add_root(struct gc_heap* heap, void* slot);
+
+/// Unregister a root of the heap, previously registered via `gc_add_root`.
+ALLOHA_API void gc_remove_root(struct gc_heap* heap, void* slot);
+
+/// Layout of an object of the heap.
+ALLOHA_API struct gc_type const* gc_type_of(u8 const* object);
+
+/// Amount of bytes, including headers, used by the objects of the to-space.
+ALLOHA_API usize gc_used(struct gc_heap const* heap);
+
+ALLOHA_EXTERN_C_END
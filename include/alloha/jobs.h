@@ -0,0 +1,137 @@
+/// Work-stealing job system with a scratch arena per worker.
+///
+/// Arenas aren't thread-safe, so parallel jobs can't share one for their temporaries. Here each
+/// worker thread owns a `struct vm_arena` scratch, handed to every job it runs and rolled back,
+/// via `scratch_arena_start` and `scratch_arena_end`, once the job returns. Temporary allocations
+/// made by a job are thus plain arena bumps, free of any synchronization:
+/// ```C
+/// static void job_sum(void* arg, struct arena* scratch) {
+///     struct batch* batch = (struct batch*)arg;
+///     u64* values = (u64*)arena_alloc(scratch, batch->count * sizeof(u64));
+///     ... compute into `values`, write the result to `batch` ...
+/// }
+///
+/// struct job_counter counter;
+/// job_counter_init(&counter);
+/// for (u32 i = 0; i < batch_count; ++i) {
+///     jobs[i] = (struct job){.fn = job_sum, .arg = &batches[i], .counter = &counter};
+///     job_submit(&system, &jobs[i]);
+/// }
+/// job_wait(&system, &counter);
+/// ```
+/// Each worker has a Chase-Lev deque of jobs: the worker pushes and pops at the bottom of its own
+/// deque, while idle workers steal from the top of the others. Jobs submitted by threads outside
+/// of the system go to a shared queue guarded by a mutex, from which the workers take them.
+///
+/// The scratch memory is reserved once per worker and only touched pages become resident, so the
+/// scratch capacity can be generous.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#pragma once
+
+#include <alloha/arena.h>
+#include <alloha/core.h>
+#include <alloha/thread.h>
+
+#include <stdatomic.h>
+
+ALLOHA_EXTERN_C_BEGIN
+
+/// Default capacity of the deque of each worker.
+#define JOB_DEQUE_DEFAULT_CAPACITY 1024
+
+/// Default capacity, in bytes, of the scratch arena of each worker.
+#define JOB_SCRATCH_DEFAULT_CAPACITY ((usize)16 << 20)
+
+/// Entry point of a job.
+///
+/// Parameters:
+///     * `arg`: The argument of the job.
+///     * `scratch`: Scratch arena of the worker running the job. Everything allocated from it is
+///                  released once the job returns.
+typedef void (*job_fn)(void* arg, struct arena* scratch);
+
+/// Number of pending jobs, waited upon by `job_wait`.
+struct job_counter {
+    atomic_size_t pending;
+};
+
+/// Job to be run by a worker.
+///
+/// The job is owned by the caller and should outlive its execution.
+struct job {
+    job_fn              fn;
+    void*               arg;
+    struct job_counter* counter;  ///< Decremented once the job is done, may be null.
+    struct job*         next;     ///< Link of the shared queue, used by the job system.
+};
+
+/// Chase-Lev work-stealing deque of jobs, of fixed capacity.
+struct job_deque {
+    atomic_int_least64_t top;     ///< Next job to be stolen.
+    atomic_int_least64_t bottom;  ///< Next free slot, only written by the owner.
+    atomic_uintptr_t*    slots;
+    u32                  mask;    ///< Capacity minus one.
+};
+
+struct job_worker {
+    struct job_system*   system;
+    struct job_deque     deque;
+    struct vm_arena      scratch;
+    struct alloha_thread thread;
+    u32                  index;
+    u64                  rng;      ///< State of the choice of the victims of steals.
+    u64                  stolen;   ///< Amount of jobs taken from other workers.
+    u64                  executed;
+};
+
+/// Job system configuration.
+struct job_config {
+    u32   worker_count;
+    u32   deque_capacity;    ///< Jobs per worker deque, rounded up to a power of two.
+    usize scratch_capacity;  ///< Capacity, in bytes, of the scratch arena of each worker.
+};
+
+struct job_system {
+    struct job_config   config;
+    struct job_worker*  workers;
+    struct alloha_mutex mutex;  ///< Guards the shared queue.
+    struct job*         queue_head;
+    struct job*         queue_tail;
+    atomic_size_t       queued;  ///< Amount of jobs in the shared queue.
+    atomic_bool         running;
+};
+
+/// Initialize a counter with no pending jobs.
+ALLOHA_API void job_counter_init(struct job_counter* counter);
+
+/// Create a job system and start its worker threads.
+///
+/// Zero fields of the configuration take their default values, where `worker_count` defaults to
+/// one.
+///
+/// Return: Whether the memory and the threads of the workers could be obtained.
+ALLOHA_API bool job_system_create(struct job_system* system, struct job_config config);
+
+/// Stop the workers and release the memory of the system.
+///
+/// Every submitted job should be waited upon beforehand.
+ALLOHA_API void job_system_destroy(struct job_system* system);
+
+/// Submit a job to be run by one of the workers.
+///
+/// From a worker, the job is pushed to its own deque, or run right away if the deque is full. From
+/// any other thread, the job goes to the shared queue.
+ALLOHA_API void job_submit(struct job_system* restrict system, struct job* restrict job);
+
+/// Wait for every job counted by `counter` to be done.
+///
+/// From a worker, pending jobs are run while waiting, so that jobs can wait upon the jobs they
+/// submit.
+ALLOHA_API void job_wait(struct job_system* restrict system, struct job_counter* restrict counter);
+
+/// Worker running the calling thread, or null if the thread isn't a worker of any job system.
+ALLOHA_API struct job_worker* job_current_worker(void);
+
+ALLOHA_EXTERN_C_END
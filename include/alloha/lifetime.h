@@ -0,0 +1,159 @@
+/// Object lifetime profiler.
+///
+/// Moving code off `malloc` starts with knowing how the objects of each allocation site live and
+/// die. The profiler records, for each site, the sizes of its objects and their lifetimes, both in
+/// allocations elapsed between their allocation and release and in time, together with the order
+/// in which they're released. Out of that, each site is classified by its lifetime pattern, and
+/// matched with the allocator of the library that fits it best:
+///
+/// | Pattern      | Objects are released...                                | Allocator       |
+/// |--------------|--------------------------------------------------------|-----------------|
+/// | LIFO         | most recent first                                      | `stack`         |
+/// | Batch        | all together, at the end of a phase                    | `arena`         |
+/// | FIFO         | oldest first                                           | `recycle_arena` |
+/// | Random       | in no particular order                                 | `recycle_arena` |
+/// | Long-lived   | never, while profiled                                  | `arena`         |
+///
+/// FIFO and random sites are left to the free lists of a recycling arena, which recycle blocks
+/// released in any order, as long as they fit in its largest bucket. Sites of larger blocks are
+/// better left on `malloc`.
+///
+/// Allocation sites are instrumented with the hooks of this module:
+/// ```C
+/// alloha_lifetime_start((struct alloha_lifetime_config){0});
+///
+/// struct node* node = (struct node*)alloha_lifetime_malloc(ALLOHA_LIFETIME_SITE, sizeof(*node));
+/// ...
+/// alloha_lifetime_free(node);
+///
+/// alloha_lifetime_report(stdout);
+/// alloha_lifetime_stop();
+/// ```
+/// or, for custom allocation functions, via `alloha_lifetime_on_alloc` and
+/// `alloha_lifetime_on_free`. While the profiler is stopped, the hooks cost a single atomic load.
+///
+/// Note: Sites are identified by the contents of their name. The name first seen for a site is the
+///       one kept in its statistics, and should thus outlive the profile, as is the case for string
+///       literals and `ALLOHA_LIFETIME_SITE`.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#pragma once
+
+#include <alloha/core.h>
+
+#include <stdio.h>
+
+ALLOHA_EXTERN_C_BEGIN
+
+#define ALLOHA_LIFETIME_STRINGIFY_(x) #x
+#define ALLOHA_LIFETIME_STRINGIFY(x)  ALLOHA_LIFETIME_STRINGIFY_(x)
+
+/// Name of the allocation site where the macro is expanded, as `file:line`.
+#define ALLOHA_LIFETIME_SITE (__FILE__ ":" ALLOHA_LIFETIME_STRINGIFY(__LINE__))
+
+/// Default maximum amount of objects alive at once tracked by the profiler.
+#define ALLOHA_LIFETIME_DEFAULT_MAX_LIVE ((u32)1 << 16)
+
+/// Default maximum amount of allocation sites tracked by the profiler.
+#define ALLOHA_LIFETIME_DEFAULT_MAX_SITES 256
+
+/// Fraction, in percent, of the releases of a site that should follow a pattern for the site to be
+/// classified by it.
+#define ALLOHA_LIFETIME_PATTERN_THRESHOLD 90
+
+struct alloha_lifetime_config {
+    u32 max_live;   ///< Maximum amount of objects alive at once. Zero for the default.
+    u32 max_sites;  ///< Maximum amount of allocation sites. Zero for the default.
+};
+
+enum alloha_lifetime_pattern {
+    ALLOHA_LIFETIME_LIFO,
+    ALLOHA_LIFETIME_BATCH,
+    ALLOHA_LIFETIME_FIFO,
+    ALLOHA_LIFETIME_RANDOM,
+    ALLOHA_LIFETIME_LONG_LIVED,
+};
+
+/// Statistics of an allocation site.
+struct alloha_lifetime_site {
+    char const* name;
+    u64         allocs;
+    u64         frees;
+    u64         live;  ///< Objects allocated and not yet released.
+    usize       min_size;
+    usize       max_size;
+    u64         total_size;  ///< Sum of the sizes of every object allocated.
+
+    /// Sums of the lifetimes of the released objects, in allocations elapsed (from any site) and in
+    /// nanoseconds.
+    u64 lifetime_allocs;
+    u64 lifetime_ns;
+
+    /// Releases of the most recently allocated live object of the site.
+    u64 lifo_frees;
+
+    /// Releases of the least recently allocated live object of the site.
+    u64 fifo_frees;
+
+    /// Releases emptying the site, in runs of at least two releases with no allocation of the site
+    /// in between.
+    u64 batch_frees;
+
+    u64 free_run;  ///< Releases of the site since its last allocation.
+};
+
+struct alloha_lifetime_stats {
+    u32 sites;
+    u64 live;             ///< Objects tracked alive.
+    u64 dropped_allocs;   ///< Allocations left untracked, beyond `max_live` or `max_sites`.
+    u64 untracked_frees;  ///< Releases of objects that weren't tracked.
+};
+
+/// Start profiling, discarding the previous profile.
+///
+/// Return: Whether the profiler could be started, false if it's already running or if the memory
+///         for its profile couldn't be mapped.
+ALLOHA_API bool alloha_lifetime_start(struct alloha_lifetime_config config);
+
+/// Stop profiling, and release the profile.
+ALLOHA_API void alloha_lifetime_stop(void);
+
+/// Record the allocation of a block by a site.
+///
+/// Parameters:
+///     * `site`: Name of the allocation site, see `ALLOHA_LIFETIME_SITE`.
+///     * `block`: The new block, ignored if null.
+///     * `size`: Size, in bytes, of the block.
+ALLOHA_API void alloha_lifetime_on_alloc(char const* site, void* block, usize size);
+
+/// Record the release of a block, previously recorded via `alloha_lifetime_on_alloc`.
+ALLOHA_API void alloha_lifetime_on_free(void const* block);
+
+/// Allocate a block via `malloc`, recording its allocation by `site`.
+ALLOHA_API void* alloha_lifetime_malloc(char const* site, usize size);
+
+/// Release a block via `free`, recording its release.
+ALLOHA_API void alloha_lifetime_free(void* block);
+
+/// Copy the statistics of the allocation sites, in the order of their first allocation.
+///
+/// Return: The amount of sites of the profile, which may be larger than `max_sites`.
+ALLOHA_API u32 alloha_lifetime_sites(struct alloha_lifetime_site* sites, u32 max_sites);
+
+/// Statistics of the profile, zeroed if the profiler isn't running.
+ALLOHA_API struct alloha_lifetime_stats alloha_lifetime_stats(void);
+
+/// Lifetime pattern followed by the objects of a site.
+ALLOHA_API enum alloha_lifetime_pattern alloha_lifetime_pattern_of(
+    struct alloha_lifetime_site const* site);
+
+/// Name of the allocator of the library recommended for a site, or "malloc" for none.
+ALLOHA_API char const* alloha_lifetime_recommend(struct alloha_lifetime_site const* site);
+
+/// Write a table with the statistics, pattern and recommended allocator of each site.
+///
+/// Return: Whether the profiler is running and the whole report could be written to `out`.
+ALLOHA_API bool alloha_lifetime_report(FILE* out);
+
+ALLOHA_EXTERN_C_END
@@ -0,0 +1,104 @@
+/// Allocation failure handling.
+///
+/// Each allocator may point to a `struct alloha_oom_policy` deciding what happens when it runs out
+/// of memory: return null, give a handler the chance to grow the backing store and retry, or abort.
+/// Whichever the action, the failure is recorded in a thread-local error code (see
+/// `alloha_last_error`) and counted process-wide.
+///
+/// Diagnostics are rate-limited: a failure is only reported to `stderr` when the failure count
+/// reaches a power of two, so that an overloaded process failing thousands of allocations per
+/// second doesn't serialize on the lock of `stderr`. The whole handling lives out of the
+/// allocation fast paths.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#pragma once
+
+#include <alloha/core.h>
+
+ALLOHA_EXTERN_C_BEGIN
+
+/// Maximum number of times an allocation is retried under `ALLOHA_OOM_RETRY`.
+#define ALLOHA_OOM_MAX_RETRIES 4
+
+/// Error codes of the allocators.
+enum alloha_error {
+    ALLOHA_OK = 0,
+
+    /// The allocator didn't have enough free memory.
+    ALLOHA_ERROR_OUT_OF_MEMORY,
+
+    /// The block passed to the allocator isn't one of its live blocks.
+    ALLOHA_ERROR_INVALID_BLOCK,
+};
+
+/// Action taken when an allocator runs out of memory.
+enum alloha_oom_action {
+    /// Fail the allocation, returning null.
+    ALLOHA_OOM_RETURN_NULL = 0,
+
+    /// Call the handler of the policy, and retry the allocation if it returns true. The allocation
+    /// fails if the handler returns false or after `ALLOHA_OOM_MAX_RETRIES` attempts.
+    ALLOHA_OOM_RETRY,
+
+    /// Report the failure and abort the program.
+    ALLOHA_OOM_ABORT,
+};
+
+/// Description of a failed allocation.
+struct alloha_oom_info {
+    enum alloha_error error;
+    char const*       function;   ///< Name of the failed allocator function.
+    void*             allocator;  ///< Allocator that failed, such as a `struct arena*`.
+    usize             size;       ///< Size, in bytes, requested.
+    u32               alignment;  ///< Alignment, in bytes, requested.
+    usize             available;  ///< Free memory, in bytes, of the allocator.
+};
+
+/// Handler of `ALLOHA_OOM_RETRY`, should return whether the allocation should be retried.
+///
+/// The handler may grow the backing store of the allocator, for instance by raising the capacity
+/// of an arena whose buffer has room to spare.
+typedef bool (*alloha_oom_handler)(struct alloha_oom_info const* info, void* user);
+
+/// Failure policy of an allocator.
+///
+/// Allocators without a policy fail their allocations returning null, with diagnostics.
+struct alloha_oom_policy {
+    enum alloha_oom_action action;
+    alloha_oom_handler     handler;  ///< Called under `ALLOHA_OOM_RETRY`.
+    void*                  user;     ///< Argument forwarded to `handler`.
+    bool                   quiet;    ///< Don't report failures to `stderr`.
+};
+
+/// Decide what to do about a failed allocation, according to a policy.
+///
+/// Meant for the allocator implementations. Records the error and, once the allocation is given
+/// up, counts and reports it.
+///
+/// Parameters:
+///     * `policy`: Policy of the allocator, may be null.
+///     * `info`: Description of the failure.
+///     * `attempt`: Number of times the allocation was already retried.
+///
+/// Return: Whether the allocation should be retried.
+ALLOHA_API bool alloha_oom_retry(
+    struct alloha_oom_policy const* restrict policy,
+    struct alloha_oom_info const* restrict   info,
+    u32                                      attempt);
+
+/// Record a misuse of an allocator, such as freeing a block it doesn't own.
+ALLOHA_API void alloha_report_error(enum alloha_error error, char const* function);
+
+/// Last error recorded by the allocators in the calling thread.
+///
+/// Successful operations don't reset the error, use `alloha_clear_error` for that.
+ALLOHA_API enum alloha_error alloha_last_error(void);
+
+/// Reset the error of the calling thread to `ALLOHA_OK`.
+ALLOHA_API void alloha_clear_error(void);
+
+/// Number of allocator failures recorded so far by the whole process.
+ALLOHA_API u64 alloha_failure_count(void);
+
+ALLOHA_EXTERN_C_END
@@ -0,0 +1,131 @@
+/// Memory pressure watcher.
+///
+/// Watches the memory pressure of the cgroup of the process and makes a scavenger (see
+/// `alloha/scavenger.h`) progressively more aggressive while the pressure lasts, so that the
+/// memory retained by the allocators is given back before the kernel resorts to the OOM killer.
+///
+/// Pressure is signaled by either of:
+///     * A PSI trigger (`memory.pressure`), firing when tasks of the cgroup stall on memory for
+///       longer than a threshold in a time window.
+///     * The usage of the cgroup (`memory.current`) getting close to its `memory.high` limit, past
+///       which the kernel throttles the cgroup and reclaims memory from it.
+/// Each signal raises the pressure level by one, up to `PRESSURE_HIGH`, while each `calm_ms` period
+/// without signals lowers it by one. Each level change is forwarded to the scavenger, triggering an
+/// immediate scan when the level goes up, and to an optional callback, where caches can release
+/// their memory.
+///
+/// Only supported on Linux, with cgroup v2.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#pragma once
+
+#include <alloha/core.h>
+#include <alloha/scavenger.h>
+#include <alloha/thread.h>
+
+#include <stdatomic.h>
+
+ALLOHA_EXTERN_C_BEGIN
+
+/// Interval, in milliseconds, between checks of `memory.high` by the watcher thread.
+#define PRESSURE_POLL_INTERVAL_MS 100
+
+/// Function called on each pressure signal and level change.
+typedef void (*pressure_callback)(enum pressure_level level, void* user);
+
+/// Watcher configuration.
+struct pressure_config {
+    /// Directory of the cgroup, defaults to `/sys/fs/cgroup` if null.
+    char const* cgroup_dir;
+
+    /// PSI trigger written to `memory.pressure`, defaults to `some 150000 1000000` (150 ms of
+    /// stall in a 1 s window) if null.
+    char const* psi_trigger;
+
+    /// Usage, in percent of `memory.high`, signaling pressure. Zero disables the check.
+    u32 high_percent;
+
+    /// Period, in milliseconds, without pressure signals after which the level is lowered.
+    u32 calm_ms;
+};
+
+struct pressure_watcher {
+    int   trigger_fd;   ///< Pollable source of pressure signals, or -1.
+    short events;       ///< Poll events of `trigger_fd` signaling pressure.
+    int   current_fd;   ///< `memory.current` of the cgroup, or -1.
+    int   high_fd;      ///< `memory.high` of the cgroup, or -1.
+    u32   high_percent;
+    u32   calm_ms;
+    u64   last_change;  ///< Time, in milliseconds, of the last signal or level change.
+
+    struct scavenger* scavenger;
+    pressure_callback callback;
+    void*             user;
+
+    atomic_uint          level;  ///< Current `enum pressure_level`.
+    atomic_bool          running;
+    struct alloha_thread thread;
+};
+
+/// Watch the pressure of a cgroup.
+///
+/// Parameters:
+///     * `watcher`: The watcher to be initialized.
+///     * `config`: Configuration of the watcher.
+///     * `scavenger`: Scavenger made more aggressive under pressure, may be null.
+///     * `callback`: Function called on each pressure signal and level change, may be null.
+///     * `user`: Argument forwarded to `callback`.
+///
+/// Return: Whether either of the PSI trigger or `memory.high` could be watched.
+ALLOHA_API bool pressure_watcher_open(
+    struct pressure_watcher* restrict      watcher,
+    struct pressure_config const* restrict config,
+    struct scavenger*                      scavenger,
+    pressure_callback                      callback,
+    void*                                  user);
+
+/// Watch a custom source of pressure signals.
+///
+/// Each time `fd` becomes readable, the available data is drained and counted as a single pressure
+/// signal. This allows driving the watcher from other monitoring sources, such as a pipe fed by a
+/// supervisor process.
+///
+/// Parameters:
+///     * `watcher`: The watcher to be initialized.
+///     * `fd`: Readable file descriptor, owned by the watcher from now on.
+///     * `calm_ms`: Period, in milliseconds, without signals after which the level is lowered.
+///     * `scavenger`: Scavenger made more aggressive under pressure, may be null.
+///     * `callback`: Function called on each pressure signal and level change, may be null.
+///     * `user`: Argument forwarded to `callback`.
+ALLOHA_API void pressure_watcher_attach(
+    struct pressure_watcher* watcher,
+    int                      fd,
+    u32                      calm_ms,
+    struct scavenger*        scavenger,
+    pressure_callback        callback,
+    void*                    user);
+
+/// Stop the watcher thread, if running, and close the watched files.
+ALLOHA_API void pressure_watcher_close(struct pressure_watcher* watcher);
+
+/// Wait for a pressure signal and update the pressure level accordingly.
+///
+/// Parameters:
+///     * `watcher`: The watcher.
+///     * `timeout_ms`: Maximum time, in milliseconds, to wait for a signal.
+///
+/// Return: The pressure level after the update.
+ALLOHA_API enum pressure_level pressure_watcher_poll(
+    struct pressure_watcher* watcher,
+    u32                      timeout_ms);
+
+/// Start a thread polling the watcher.
+///
+/// Return: Whether the thread could be started.
+ALLOHA_API bool pressure_watcher_start(struct pressure_watcher* watcher);
+
+/// Current pressure level.
+ALLOHA_API enum pressure_level pressure_watcher_level(struct pressure_watcher const* watcher);
+
+ALLOHA_EXTERN_C_END
@@ -0,0 +1,55 @@
+/// Static tracepoints.
+///
+/// The hot paths of the arena and stack allocators are annotated with USDT probes of the `alloha`
+/// provider, so that a running program can be traced with tools such as `bpftrace` or `perf`
+/// without being rebuilt:
+/// ```sh
+/// # Histogram of the sizes allocated from arenas.
+/// bpftrace -e 'usdt:./app:alloha:arena_alloc { @sizes = hist(arg1); }'
+/// # Allocation failures, with their allocator and size.
+/// bpftrace -e 'usdt:./app:alloha:*_alloc_failed { printf("%p %d\n", arg0, arg1); }'
+/// ```
+/// Each probe compiles to a single `nop` instruction, which is only patched into a trap while a
+/// tracer is attached, and to a note in the `.note.stapsdt` section of the binary, describing the
+/// location of the probe and its arguments.
+///
+/// Probes are available on Linux when `<sys/sdt.h>` is found at compile time, from the SystemTap
+/// development headers (e.g. `systemtap-sdt-dev` or `systemtap-sdt-devel`), in which case
+/// `ALLOHA_USDT_ENABLED` gets defined. Compile with `ALLOHA_NO_USDT` to leave them out. Otherwise,
+/// probes compile to nothing.
+///
+/// Probes and their arguments:
+///     * `arena_alloc(arena, size, alignment, block)`
+///     * `arena_realloc(arena, block, current_capacity, new_capacity, new_block)`
+///     * `arena_alloc_failed(arena, size, alignment, available)`
+///     * `arena_clear(arena, offset)`: Offset before the arena is cleared.
+///     * `arena_scratch_start(arena, offset)`
+///     * `arena_scratch_end(arena, offset, saved_offset)`: Offset before it's restored.
+///     * `stack_alloc(stack, size, alignment, block)`
+///     * `stack_alloc_failed(stack, size, alignment, available)`
+///     * `stack_pop(stack, block)`
+///     * `stack_clear_at(stack, block)`
+///     * `stack_clear(stack, offset)`: Offset before the stack is cleared.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#pragma once
+
+#if defined(__linux__) && !defined(ALLOHA_NO_USDT) && defined(__has_include)
+#    if __has_include(<sys/sdt.h>)
+#        include <sys/sdt.h>
+#        define ALLOHA_USDT_ENABLED 1
+#    endif
+#endif
+
+#if defined(ALLOHA_USDT_ENABLED)
+#    define ALLOHA_PROBE2(name, a, b)          DTRACE_PROBE2(alloha, name, a, b)
+#    define ALLOHA_PROBE3(name, a, b, c)       DTRACE_PROBE3(alloha, name, a, b, c)
+#    define ALLOHA_PROBE4(name, a, b, c, d)    DTRACE_PROBE4(alloha, name, a, b, c, d)
+#    define ALLOHA_PROBE5(name, a, b, c, d, e) DTRACE_PROBE5(alloha, name, a, b, c, d, e)
+#else
+#    define ALLOHA_PROBE2(name, a, b)          ((void)0)
+#    define ALLOHA_PROBE3(name, a, b, c)       ((void)0)
+#    define ALLOHA_PROBE4(name, a, b, c, d)    ((void)0)
+#    define ALLOHA_PROBE5(name, a, b, c, d, e) ((void)0)
+#endif
@@ -0,0 +1,83 @@
+/// Arena allocator recycling freed blocks.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#pragma once
+
+#include <alloha/arena.h>
+#include <alloha/core.h>
+
+ALLOHA_EXTERN_C_BEGIN
+
+/// Size, in bytes, of the blocks of the smallest bucket of a recycling arena.
+#define RECYCLE_ARENA_MIN_SIZE 16
+
+/// Number of buckets of a recycling arena, the largest one holding blocks of 2 KiB.
+#define RECYCLE_ARENA_BUCKET_COUNT 8
+
+/// Arena allocator keeping segregated free lists of freed blocks.
+///
+/// Meant for arenas living long enough to accumulate dead objects of a handful of sizes: freed
+/// blocks are pushed into the free list of their power of two bucket, and reused by later
+/// allocations of the same bucket before the arena is bumped. Memory usage is thus bounded for
+/// workloads churning through objects, while a miss in the free list is still a single bump.
+///
+/// Blocks up to `RECYCLE_ARENA_MIN_SIZE << (RECYCLE_ARENA_BUCKET_COUNT - 1)` bytes are rounded up
+/// to the size of their bucket. Larger blocks are never recycled, unless they are the last block of
+/// the arena, in which case freeing them rolls the offset back.
+///
+/// Note: The arena **does not own** its memory, see `struct arena`.
+struct recycle_arena {
+    struct arena arena;  ///< Underlying arena, from which new blocks are bumped.
+
+    /// Singly linked lists of free blocks, each storing the next free block in its first bytes.
+    u8* free_lists[RECYCLE_ARENA_BUCKET_COUNT];
+};
+
+/// Create a new recycling arena.
+ALLOHA_API struct recycle_arena recycle_arena_new(usize capacity, u8* buf);
+
+/// Initialize an existing recycling arena.
+///
+/// Parameters:
+///     * `arena`: A pointer to the arena allocator to be initialized.
+///     * `capacity`: Size, in bytes, of the provided block of memory `buf`.
+///     * `buf`: Pointer to the block of memory that will be managed, but not owned, by the
+///              allocator.
+ALLOHA_API void recycle_arena_init(
+    struct recycle_arena* restrict arena,
+    usize capacity,
+    u8* restrict buf);
+
+/// Allocate a block of memory satisfying a given alignment.
+///
+/// The head of the free list of the bucket of `size` is reused if it satisfies the alignment,
+/// otherwise a new block is bumped from the arena.
+///
+/// Parameters:
+///     * `arena`: The arena allocator responsible for the allocation.
+///     * `size`: The size, in bytes, of the new block of memory.
+///     * `alignment`: The alignment, in bytes, needed by the new block of memory.
+///
+/// Return: Pointer to the block of memory, or null if the allocation failed, in which case the
+///         failure policy of the underlying arena was applied.
+ALLOHA_API u8* recycle_arena_alloc_aligned(struct recycle_arena* arena, usize size, u32 alignment);
+
+/// Allocates a block of memory with an alignment of `ALLOHA_DEFAULT_ALIGNMENT`.
+ALLOHA_API u8* recycle_arena_alloc(struct recycle_arena* arena, usize size);
+
+/// Recycle a block of memory.
+///
+/// Parameters:
+///     * `arena`: The arena allocator whose memory contains `block`.
+///     * `block`: Pointer to a block allocated by `arena`.
+///     * `size`: Size, in bytes, requested when `block` was allocated.
+ALLOHA_API void recycle_arena_free(
+    struct recycle_arena* restrict arena,
+    u8* restrict block,
+    usize size);
+
+/// Release every allocation of the arena, emptying its free lists.
+ALLOHA_API void recycle_arena_clear(struct recycle_arena* arena);
+
+ALLOHA_EXTERN_C_END
@@ -0,0 +1,92 @@
+/// Reference-counted regions.
+///
+/// A region is a growable arena whose lifetime is shared: it's released as a whole, in one go,
+/// once the last reference to it is dropped. Data built once and then read by many threads, such
+/// as a parsed configuration used by many requests, can thus be allocated in a region rather than
+/// freed object by object:
+/// ```C
+/// struct region* region = region_create(0);
+/// struct config* config = (struct config*)region_alloc(region, sizeof(struct config));
+/// config->region        = region;
+/// ... parse the rest of the configuration into the region ...
+///
+/// // Each request sharing the configuration holds a reference.
+/// request->config = config;
+/// region_retain(config->region);
+/// ...
+/// region_release(request->config->region);
+/// ```
+/// The memory of a region is a list of chunks mapped via `vmem_alloc`. Allocations bump the arena
+/// over the most recent chunk, and a new chunk is mapped whenever a block doesn't fit. The region
+/// itself lives in its first chunk.
+///
+/// Note: The reference count is atomic, so that references can be retained and released by any
+///       thread. Allocations, however, aren't synchronized, and are usually done by a single thread
+///       while the data is built.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#pragma once
+
+#include <alloha/arena.h>
+#include <alloha/core.h>
+#include <alloha/oom.h>
+
+#include <stdatomic.h>
+
+ALLOHA_EXTERN_C_BEGIN
+
+/// Default size, in bytes, of the chunks of a region.
+#define REGION_DEFAULT_CHUNK_SIZE ((usize)64 << 10)
+
+/// Header at the start of each chunk of a region.
+struct region_chunk {
+    struct region_chunk* next;  ///< Previously mapped chunk.
+    usize                size;  ///< Size, in bytes, of the chunk, including this header.
+};
+
+struct region {
+    struct arena         arena;   ///< Arena over the free memory of the most recent chunk.
+    struct region_chunk* chunks;  ///< Most recent chunk, the last one holds the region itself.
+    usize                chunk_size;
+    usize                mapped_bytes;  ///< Total size, in bytes, of the chunks.
+    atomic_size_t        refs;
+
+    /// Policy applied when a chunk can't be mapped, see `alloha/oom.h`. Null by default.
+    struct alloha_oom_policy const* oom;
+};
+
+/// Create a region holding a single reference, owned by the caller.
+///
+/// Parameters:
+///     * `chunk_size`: Size, in bytes, of each chunk of the region, rounded up to a multiple of the
+///                     page size. Zero for `REGION_DEFAULT_CHUNK_SIZE`.
+///
+/// Return: The new region, or null if its first chunk couldn't be mapped.
+ALLOHA_API struct region* region_create(usize chunk_size);
+
+/// Allocate a block of memory satisfying a given alignment, mapping a new chunk if needed.
+///
+/// Blocks larger than the chunk size get a chunk of their own.
+///
+/// Return: Pointer to the new block of memory, or null if the allocation failed, in which case the
+///         failure policy of the region was applied.
+ALLOHA_API u8* region_alloc_aligned(struct region* region, usize size, u32 alignment);
+
+/// Allocates a block of memory with an alignment of `ALLOHA_DEFAULT_ALIGNMENT`.
+ALLOHA_API u8* region_alloc(struct region* region, usize size);
+
+/// Add a reference to the region.
+///
+/// Return: The region itself.
+ALLOHA_API struct region* region_retain(struct region* region);
+
+/// Drop a reference to the region, releasing the whole region if it was the last one.
+///
+/// Return: Whether the region was released, in which case it shouldn't be accessed anymore.
+ALLOHA_API bool region_release(struct region* region);
+
+/// Current amount of references to the region.
+ALLOHA_API usize region_ref_count(struct region const* region);
+
+ALLOHA_EXTERN_C_END
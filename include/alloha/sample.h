@@ -0,0 +1,107 @@
+/// Sampling heap profiler.
+///
+/// Tracing every allocation is too expensive to be left on, so the profiler samples them instead:
+/// each thread counts down the bytes allocated through the allocators of the library, and the
+/// allocation bringing the counter below zero captures a backtrace. The distances between samples
+/// are drawn from an exponential distribution whose mean is the sampling period, so that every
+/// byte has the same chance of being sampled, regardless of the sizes of the allocations. Samples
+/// are aggregated by backtrace, and the profile can be written at any time:
+/// ```C
+/// alloha_sample_start((struct alloha_sample_config){.period = 256 << 10});
+/// ... run the workload ...
+/// FILE* out = fopen("heap.prof", "w");
+/// alloha_sample_write(out, ALLOHA_SAMPLE_PPROF);
+/// alloha_sample_stop();
+/// ```
+/// Profiles can be written in the legacy heap profile format understood by `pprof`
+/// (`pprof -http=: ./app heap.prof`), which estimates the allocated bytes from the samples and
+/// symbolizes the addresses itself, or as folded stacks for flame graphs, with the addresses of
+/// each backtrace from the outermost frame and weighted by the estimated allocated bytes.
+///
+/// The cost on allocations that aren't sampled is a decrement of the thread counter and a branch.
+/// While the profiler is stopped, threads check whether it was started every
+/// `ALLOHA_SAMPLE_IDLE_BYTES` allocated bytes. Compile with `ALLOHA_NO_SAMPLE` to remove the
+/// counter from the allocators altogether.
+///
+/// Note: Thread-local variables can't be imported from a Windows DLL, so this header is only
+///       available to programs linking the library statically on Windows, as `alloha/temp.h`.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#pragma once
+
+#include <alloha/core.h>
+
+#include <stdio.h>
+
+ALLOHA_EXTERN_C_BEGIN
+
+/// Default mean distance, in bytes, between two samples.
+#define ALLOHA_SAMPLE_DEFAULT_PERIOD ((usize)512 << 10)
+
+/// Default maximum amount of distinct backtraces held by a profile.
+#define ALLOHA_SAMPLE_DEFAULT_MAX_STACKS 4096
+
+/// Maximum amount of frames of a sampled backtrace.
+#define ALLOHA_SAMPLE_MAX_DEPTH 32
+
+/// Distance, in bytes, between two checks of a stopped profiler by each thread.
+#define ALLOHA_SAMPLE_IDLE_BYTES ((i64)1 << 20)
+
+struct alloha_sample_config {
+    usize period;      ///< Mean distance, in bytes, between samples. Zero for the default.
+    u32   max_stacks;  ///< Maximum amount of distinct backtraces. Zero for the default.
+};
+
+struct alloha_sample_stats {
+    u64 samples;  ///< Samples recorded since the profiler was started.
+    u64 dropped;  ///< Samples lost since every slot for backtraces was taken.
+    u32 stacks;   ///< Distinct backtraces recorded.
+};
+
+enum alloha_sample_format {
+    ALLOHA_SAMPLE_PPROF,   ///< Legacy heap profile of `pprof`, version 2.
+    ALLOHA_SAMPLE_FOLDED,  ///< One line per backtrace, with its frames separated by semicolons.
+};
+
+/// Bytes the calling thread may still allocate before its next sample.
+///
+/// Only meant to be accessed via `alloha_sample_alloc`.
+ALLOHA_API extern ALLOHA_THREAD_LOCAL i64 alloha_sample_countdown;
+
+/// Slow path of `alloha_sample_alloc`, sampling the allocation if the profiler is running and
+/// drawing the distance to the next sample.
+ALLOHA_API void alloha_sample_slow(usize size);
+
+/// Count an allocation towards the next sample of the calling thread.
+///
+/// Called by the allocation paths of the allocators.
+static inline void alloha_sample_alloc(usize size) {
+#if !defined(ALLOHA_NO_SAMPLE)
+    alloha_sample_countdown -= (i64)size;
+    if (alloha_sample_countdown < 0) {
+        alloha_sample_slow(size);
+    }
+#else
+    alloha_discard(size);
+#endif
+}
+
+/// Start sampling allocations, discarding the previous profile.
+///
+/// Return: Whether the profiler could be started, false if it's already running or if the memory
+///         for its profile couldn't be mapped.
+ALLOHA_API bool alloha_sample_start(struct alloha_sample_config config);
+
+/// Stop sampling allocations, and release the profile.
+ALLOHA_API void alloha_sample_stop(void);
+
+/// Write the current profile.
+///
+/// Return: Whether the profiler is running and the whole profile could be written to `out`.
+ALLOHA_API bool alloha_sample_write(FILE* out, enum alloha_sample_format format);
+
+/// Statistics of the current profile, zeroed if the profiler isn't running.
+ALLOHA_API struct alloha_sample_stats alloha_sample_stats(void);
+
+ALLOHA_EXTERN_C_END
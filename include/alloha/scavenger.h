@@ -0,0 +1,161 @@
+/// Background scavenger returning idle allocator memory to the operating system.
+///
+/// Clearing an arena or a stack only resets its offset, so a long-lived allocator keeps the
+/// physical memory of its peak usage forever. The scavenger periodically releases, via
+/// `vmem_decommit`, the pages of each registered allocator lying above its recent high-water mark:
+/// the peak usage reported by the allocator over the last decay period. The memory used in the
+/// last active period of the allocator is never released, since it may still hold live data.
+///
+/// The work is done by a background thread, off the allocating threads. Each allocator is described
+/// by a `struct scavenger_entry` and alternates between active periods, where its owner allocates
+/// and touches its memory, and idle periods, where the scavenger may release its unused pages. The
+/// owner switches periods by bumping an atomic epoch, which is odd while active:
+/// ```C
+/// scavenger_register(&scavenger, &entry, arena.buf, arena.capacity);
+/// for (;;) {
+///     ... allocate from the arena ...
+///     usize const used = arena.offset;
+///     arena_clear(&arena);
+///     scavenger_idle(&entry, used);
+///
+///     ... wait for the next batch of work ...
+///
+///     scavenger_resume(&entry);
+/// }
+/// ```
+/// The allocation functions themselves are left untouched and never wait on the scavenger. Pages
+/// are released in chunks of `SCAVENGER_CHUNK_SIZE` bytes, so that `scavenger_resume` only ever
+/// waits for a single chunk in flight.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#pragma once
+
+#include <alloha/core.h>
+#include <alloha/thread.h>
+
+#include <stdatomic.h>
+
+ALLOHA_EXTERN_C_BEGIN
+
+/// Maximum amount of bytes released by the scavenger in one go.
+#define SCAVENGER_CHUNK_SIZE (256u << 10)
+
+/// Memory pressure levels, see `scavenger_set_pressure`.
+enum pressure_level {
+    PRESSURE_NONE = 0,
+
+    /// High-water marks are dropped right away, rather than after a decay period, so that all the
+    /// memory above the last usage of each idle allocator gets released.
+    PRESSURE_LOW = 1,
+
+    /// Pages are released eagerly, even if the scavenger is configured to release them lazily.
+    PRESSURE_MEDIUM = 2,
+
+    /// Caches should release everything they hold.
+    PRESSURE_HIGH = 3,
+};
+
+/// Allocator memory registered to a scavenger.
+///
+/// The fields should only be accessed via the scavenger functions.
+struct scavenger_entry {
+    u8*   buf;       ///< Memory managed by the allocator.
+    usize capacity;  ///< Size, in bytes, of `buf`.
+
+    // Shared between the owner and the scavenger.
+    atomic_uint_least64_t epoch;      ///< Odd while the owner is active.
+    atomic_size_t         last_used;  ///< Usage reported by the owner when last going idle.
+    atomic_size_t         peak_used;  ///< Peak usage reported by the owner since the last scan.
+    atomic_bool           trimming;   ///< Whether a chunk of memory is being released.
+
+    // Owned by the scavenger.
+    usize                   high_water;    ///< Recent high-water mark, in bytes.
+    usize                   window_peak;   ///< Peak usage in the current decay period.
+    u64                     window_start;  ///< Start, in milliseconds, of the decay period.
+    usize                   resident_end;  ///< End of the memory that may still be resident.
+    struct scavenger_entry* next;
+};
+
+/// Scavenger configuration.
+struct scavenger_config {
+    u32  period_ms;  ///< Interval, in milliseconds, between scans of the registered allocators.
+    u32  decay_ms;   ///< How long, in milliseconds, a high-water mark is kept after being reached.
+    bool lazy;       ///< Release the pages lazily, see `vmem_decommit`.
+};
+
+struct scavenger {
+    struct scavenger_config config;
+    struct alloha_mutex     mutex;  ///< Guards the list of entries and the scans.
+    struct scavenger_entry* entries;
+    struct alloha_thread    thread;
+    atomic_bool             running;
+    atomic_uint             pressure;        ///< Current `enum pressure_level`.
+    atomic_size_t           released_bytes;  ///< Total of bytes released so far.
+};
+
+/// Initialize a scavenger, without starting its thread.
+ALLOHA_API void scavenger_init(struct scavenger* scavenger, struct scavenger_config config);
+
+/// Stop the scavenger, if running, and release its resources.
+///
+/// Every entry should have been unregistered beforehand.
+ALLOHA_API void scavenger_destroy(struct scavenger* scavenger);
+
+/// Start the background thread scanning the registered allocators every `period_ms`.
+///
+/// Return: Whether the thread could be started.
+ALLOHA_API bool scavenger_start(struct scavenger* scavenger);
+
+/// Stop the background thread, waiting for up to one period for it to finish.
+ALLOHA_API void scavenger_stop(struct scavenger* scavenger);
+
+/// Register the memory of an allocator to the scavenger.
+///
+/// The entry starts in the active state, and its high-water mark is the whole capacity, so that
+/// nothing gets released before the owner reports its usage and a decay period goes by.
+///
+/// Parameters:
+///     * `scavenger`: The scavenger responsible for the memory.
+///     * `entry`: Entry describing the memory, it should outlive its registration.
+///     * `buf`: Memory managed by the allocator, should be obtained via `vmem_alloc`.
+///     * `capacity`: Size, in bytes, of `buf`.
+ALLOHA_API void scavenger_register(
+    struct scavenger* restrict       scavenger,
+    struct scavenger_entry* restrict entry,
+    u8*                              buf,
+    usize                            capacity);
+
+/// Unregister an entry. Once this returns, the scavenger doesn't touch the memory anymore.
+ALLOHA_API void scavenger_unregister(
+    struct scavenger* restrict       scavenger,
+    struct scavenger_entry* restrict entry);
+
+/// Mark the allocator as idle, allowing the scavenger to release its unused memory.
+///
+/// Should only be called by the owner of the allocator, while active.
+///
+/// Parameters:
+///     * `entry`: Entry of the allocator.
+///     * `used`: Amount of bytes, from the start of the buffer, touched during the active period.
+///               This should include any data that stays live while idle.
+ALLOHA_API void scavenger_idle(struct scavenger_entry* entry, usize used);
+
+/// Mark the allocator as active, preventing the scavenger from releasing its memory.
+///
+/// Should only be called by the owner of the allocator, while idle. Waits for the chunk of memory
+/// being released, if any, to be done.
+ALLOHA_API void scavenger_resume(struct scavenger_entry* entry);
+
+/// Set the memory pressure level, making the following scans more aggressive.
+///
+/// Usually driven by a `struct pressure_watcher` (see `alloha/pressure.h`).
+ALLOHA_API void scavenger_set_pressure(struct scavenger* scavenger, enum pressure_level level);
+
+/// Scan each registered allocator, releasing the pages of the idle ones above their high-water
+/// mark. This is what the background thread runs every period.
+///
+/// Return: Amount of bytes released.
+ALLOHA_API usize scavenger_scan(struct scavenger* scavenger);
+
+ALLOHA_EXTERN_C_END
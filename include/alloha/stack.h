@@ -5,6 +5,9 @@
 #pragma once
 
 #include <alloha/core.h>
+#include <alloha/oom.h>
+
+ALLOHA_EXTERN_C_BEGIN
 
 /// Header associated with each memory block in the stack allocator.
 ///
@@ -85,6 +88,9 @@ struct stack {
     /// Pointer offset relative to the start of the memory address of the last allocated block
     /// (after its header).
     usize previous_offset;
+
+    /// Policy applied when the stack runs out of memory, see `alloha/oom.h`. Null by default.
+    struct alloha_oom_policy const* oom;
 };
 
 /// Create a new stack allocator.
@@ -92,7 +98,7 @@ struct stack {
 /// Parameters:
 ///     * `capacity`: Size of `buf` in bytes, which will become the capacity of `stack`.
 ///     * `buf`: Buffer that the stack will manage for allocations.
-struct stack stack_new(usize capacity, u8* buf);
+ALLOHA_API struct stack stack_new(usize capacity, u8* buf);
 
 /// Initialize an existing stack allocator.
 ///
@@ -103,7 +109,7 @@ struct stack stack_new(usize capacity, u8* buf);
 ///     * `stack`: Stack allocator to be initialized.
 ///     * `capacity`: Size of `buf` in bytes, which will become the capacity of `stack`.
 ///     * `buf`: Buffer that the stack will manage for allocations.
-void stack_init(struct stack* restrict stack, usize capacity, u8* restrict buf);
+ALLOHA_API void stack_init(struct stack* restrict stack, usize capacity, u8* restrict buf);
 
 /// Allocate a block of memory satisfying a given alignment.
 ///
@@ -113,7 +119,10 @@ void stack_init(struct stack* restrict stack, usize capacity, u8* restrict buf);
 ///     * `size`: Size, in bytes, of the new memory block.
 ///     * `alignment`: The needed alignment of the new memory block. This number should always be a
 ///                    power of two, otherwise the program will panic.
-u8* stack_alloc_aligned(struct stack* stack, usize size, u32 alignment);
+///
+/// Return: Pointer to the new memory block, or null if the allocation failed, in which case the
+///         failure policy of the stack was applied.
+ALLOHA_API u8* stack_alloc_aligned(struct stack* stack, usize size, u32 alignment);
 
 /// Allocate a block of memory satisfying a default alignment.
 ///
@@ -123,7 +132,7 @@ u8* stack_alloc_aligned(struct stack* stack, usize size, u32 alignment);
 ///     * `stack`: Stack allocator that will contain and manage the new block of memory. Make sure
 ///                the pointer to the stack is valid, otherwise you'll get a panic.
 ///     * `size`: Size, in bytes, of the new memory block.
-u8* stack_alloc(struct stack* stack, usize size);
+ALLOHA_API u8* stack_alloc(struct stack* stack, usize size);
 
 /// Clear the last memory block allocated by the given stack.
 ///
@@ -134,7 +143,7 @@ u8* stack_alloc(struct stack* stack, usize size);
 ///                null, the program will panic.
 ///
 /// Return: state of the operation.
-bool stack_pop(struct stack* stack);
+ALLOHA_API bool stack_pop(struct stack* stack);
 
 /// Clear all memory blocks up until the specified memory block.
 ///
@@ -149,7 +158,7 @@ bool stack_pop(struct stack* stack);
 ///                or already free, the program return false and won't panic.
 ///
 /// Return: status of the operation.
-bool stack_clear_at(struct stack* restrict stack, u8* restrict block);
+ALLOHA_API bool stack_clear_at(struct stack* restrict stack, u8* restrict block);
 
 /// Clear all allocated memory blocks of the stack.
 ///
@@ -159,4 +168,18 @@ bool stack_clear_at(struct stack* restrict stack, u8* restrict block);
 /// Parameters:
 ///     * `stack`: Pointer to the stack that should have all of its memory freed. If this pointer is
 ///               null, the program will panic.
-void stack_clear(struct stack* stack);
+ALLOHA_API void stack_clear(struct stack* stack);
+
+/// Pre-fault the free memory of the stack.
+///
+/// Backs the pages of the free region of the stack with physical memory up front, so that the
+/// first allocations touching them don't pay for page faults. The contents of the stack are
+/// preserved.
+///
+/// Parameters:
+///     * `stack`: The stack whose free memory should be pre-faulted.
+///     * `thread_count`: Maximum number of threads used to touch the pages of huge stacks, see
+///                       `vmem_prefault`.
+ALLOHA_API void stack_prefault(struct stack* stack, u32 thread_count);
+
+ALLOHA_EXTERN_C_END
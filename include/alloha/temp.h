@@ -0,0 +1,77 @@
+/// Thread-local temporary stack.
+///
+/// Replacement for VLAs and `alloca` in hot functions: temporaries are bumped from a per-thread
+/// arena over a large range of virtual memory, so the pushes cost about the same as `alloca` while
+/// the capacity is that of the heap and there is no risk of overflowing the system stack:
+/// ```C
+/// usize const mark = alloha_temp_mark();
+/// f32*        tmp  = (f32*)alloha_temp_push(count * sizeof(f32), alloha_alignof(f32));
+/// ... use tmp ...
+/// alloha_temp_pop_to(mark);
+/// ```
+/// The range is reserved on the first push of each thread, and its pages only get physically backed
+/// as they are touched. Threads should call `alloha_temp_release` before exiting.
+///
+/// Note: Thread-local variables can't be imported from a Windows DLL, so this module is only
+///       available to programs linking the library statically on Windows.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#pragma once
+
+#include <alloha/arena.h>
+#include <alloha/core.h>
+#include <alloha/sample.h>
+#include <assert.h>
+
+ALLOHA_EXTERN_C_BEGIN
+
+/// Size, in bytes, of the virtual memory range reserved for the temporary stack of each thread.
+#if !defined(ALLOHA_TEMP_CAPACITY)
+#    define ALLOHA_TEMP_CAPACITY ((usize)64 << 20)
+#endif
+
+/// Temporary stack of the calling thread, with no capacity until its first push.
+///
+/// Only meant to be accessed via the functions of this module, and to have its failure policy set.
+ALLOHA_API extern ALLOHA_THREAD_LOCAL struct arena alloha_temp_arena;
+
+/// Slow path of `alloha_temp_push`, reserving the temporary stack on the first push of the thread
+/// and applying its failure policy when full.
+ALLOHA_API u8* alloha_temp_push_slow(usize size, u32 alignment);
+
+/// Unmap the temporary stack of the calling thread, which is reserved again on the next push.
+ALLOHA_API void alloha_temp_release(void);
+
+/// Push a temporary block of memory.
+///
+/// Parameters:
+///     * `size`: The size, in bytes, of the block.
+///     * `alignment`: The alignment, in bytes, needed by the block. Should be a power of two.
+///
+/// Return: Pointer to the block, or null if the temporary stack is full.
+static inline u8* alloha_temp_push(usize size, u32 alignment) {
+    struct arena* temp   = &alloha_temp_arena;
+    uptr const    buf    = (uptr)temp->buf;
+    uptr const    mask   = (uptr)alignment - 1;
+    usize const   offset = (usize)(((buf + temp->offset + mask) & ~mask) - buf);
+    if (size != 0 && offset <= temp->capacity && size <= temp->capacity - offset) {
+        temp->offset = offset + size;
+        alloha_sample_alloc(size);
+        return temp->buf + offset;
+    }
+    return alloha_temp_push_slow(size, alignment);
+}
+
+/// Current position of the temporary stack, to be restored by `alloha_temp_pop_to`.
+static inline usize alloha_temp_mark(void) {
+    return alloha_temp_arena.offset;
+}
+
+/// Pop every block pushed since `mark` was taken.
+static inline void alloha_temp_pop_to(usize mark) {
+    assert(mark <= alloha_temp_arena.offset && "alloha_temp_pop_to called with a stale mark");
+    alloha_temp_arena.offset = mark;
+}
+
+ALLOHA_EXTERN_C_END
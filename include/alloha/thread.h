@@ -0,0 +1,66 @@
+/// Minimal threading primitives used by the concurrent parts of the library.
+///
+/// Thin wrappers over pthreads (POSIX) and the Win32 API. The C11 `<threads.h>` interface is
+/// deliberately not used: sanitizers such as ThreadSanitizer don't intercept it on many toolchains,
+/// which makes the synchronization invisible to them.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#pragma once
+
+#include <alloha/core.h>
+
+#if !defined(_WIN32)
+#    include <pthread.h>
+#endif
+
+ALLOHA_EXTERN_C_BEGIN
+
+/// Entry point of a thread.
+typedef int (*alloha_thread_fn)(void* arg);
+
+/// Handle to a thread.
+///
+/// The handle is used to carry the entry point to the new thread, hence it should outlive the
+/// thread, until it's joined.
+struct alloha_thread {
+#if defined(_WIN32)
+    void* handle;
+#else
+    pthread_t handle;
+#endif
+    alloha_thread_fn fn;
+    void*            arg;
+};
+
+/// Mutual exclusion lock.
+struct alloha_mutex {
+#if defined(_WIN32)
+    void* srw_lock;
+#else
+    pthread_mutex_t handle;
+#endif
+};
+
+/// Start a new thread running `fn(arg)`.
+///
+/// Return: Whether the thread could be created.
+ALLOHA_API bool alloha_thread_create(struct alloha_thread* thread, alloha_thread_fn fn, void* arg);
+
+/// Wait for the thread to finish.
+///
+/// Return: The value returned by the thread entry point.
+ALLOHA_API int alloha_thread_join(struct alloha_thread* thread);
+
+/// Give up the rest of the time slice of the calling thread.
+ALLOHA_API void alloha_thread_yield(void);
+
+/// Suspend the calling thread for at least the given amount of milliseconds.
+ALLOHA_API void alloha_thread_sleep(u32 milliseconds);
+
+ALLOHA_API void alloha_mutex_init(struct alloha_mutex* mutex);
+ALLOHA_API void alloha_mutex_destroy(struct alloha_mutex* mutex);
+ALLOHA_API void alloha_mutex_lock(struct alloha_mutex* mutex);
+ALLOHA_API void alloha_mutex_unlock(struct alloha_mutex* mutex);
+
+ALLOHA_EXTERN_C_END
@@ -0,0 +1,120 @@
+/// Virtual memory utilities.
+///
+/// Thin layer over the virtual memory facilities of the operating system (`mmap`/`madvise` on
+/// POSIX and `VirtualAlloc` on Windows), used to obtain page-backed buffers for the allocators and
+/// to control when the pages get physically backed.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#pragma once
+
+#include <alloha/core.h>
+
+ALLOHA_EXTERN_C_BEGIN
+
+/// Options of `vmem_alloc`.
+enum vmem_flags {
+    VMEM_DEFAULT = 0,
+
+    /// Back every page of the mapping with physical memory before returning (`MAP_POPULATE`), so
+    /// that the first accesses to the memory don't page fault.
+    VMEM_POPULATE = 1 << 0,
+
+    /// Only reserve the address range: the pages are inaccessible, and aren't charged against the
+    /// commit limit of the system, until made accessible via `vmem_commit`. Pages never committed
+    /// act as guard pages.
+    VMEM_RESERVE = 1 << 1,
+};
+
+/// Process-wide accounting of the memory managed via this module.
+struct vmem_stats {
+    usize mapped_bytes;   ///< Bytes currently mapped via `vmem_alloc`.
+    usize locked_bytes;   ///< Bytes currently locked via `vmem_lock`.
+    usize lock_failures;  ///< Number of `vmem_lock` calls that failed, leaving memory unlocked.
+};
+
+/// Size, in bytes, of a page of virtual memory.
+ALLOHA_API usize vmem_page_size(void);
+
+/// Map a zero-initialized, readable and writable, block of virtual memory.
+///
+/// Parameters:
+///     * `size`: Size, in bytes, of the mapping. Rounded up to a multiple of the page size.
+///     * `flags`: Combination of `enum vmem_flags`.
+///
+/// Return: Page aligned pointer to the mapped memory, or null if the mapping failed.
+ALLOHA_API u8* vmem_alloc(usize size, u32 flags);
+
+/// Unmap a block of memory obtained via `vmem_alloc`.
+///
+/// Memory locked via `vmem_lock` should be unlocked with `vmem_unlock` before being unmapped, so
+/// that the lock accounting stays correct.
+///
+/// Parameters:
+///     * `mem`: Pointer returned by `vmem_alloc`.
+///     * `size`: Size, in bytes, passed to `vmem_alloc`.
+ALLOHA_API void vmem_free(u8* mem, usize size);
+
+/// Make a range of pages reserved via `VMEM_RESERVE` readable and writable.
+///
+/// Parameters:
+///     * `mem`: Page aligned start of the range.
+///     * `size`: Size, in bytes, of the range. Rounded up to a multiple of the page size.
+///
+/// Return: Whether the pages could be committed.
+ALLOHA_API bool vmem_commit(u8* mem, usize size);
+
+/// Pre-fault a range of memory, backing each of its pages with physical memory.
+///
+/// The contents of the memory are preserved, so that any memory range can be pre-faulted, even if
+/// not obtained via `vmem_alloc`. On Linux the kernel populates the pages in one go via
+/// `MADV_POPULATE_WRITE` (Linux 5.14+); otherwise, or if that isn't supported, each page is touched
+/// by a write. Huge ranges are split between `thread_count` threads.
+///
+/// Parameters:
+///     * `mem`: Start of the memory range.
+///     * `size`: Size, in bytes, of the memory range.
+///     * `thread_count`: Maximum number of threads touching pages. Zero or one means that all the
+///                       work is done by the calling thread.
+ALLOHA_API void vmem_prefault(u8* mem, usize size, u32 thread_count);
+
+/// Return the physical memory backing a range of pages to the operating system.
+///
+/// The range stays mapped and can be used again right away, but its contents are lost: with
+/// `lazy`, the kernel reclaims the pages only when under memory pressure (`MADV_FREE`), meanwhile
+/// the pages may keep their old contents; otherwise, the pages are released immediately
+/// (`MADV_DONTNEED`) and read back as zeros. Windows always resets the pages lazily. Only the pages
+/// fully contained in the range are released, and locked pages can't be released.
+///
+/// Parameters:
+///     * `mem`: Start of the range.
+///     * `size`: Size, in bytes, of the range.
+///     * `lazy`: Whether the kernel may defer reclaiming the pages until under memory pressure.
+///
+/// Return: Whether the pages could be released.
+ALLOHA_API bool vmem_decommit(u8* mem, usize size, bool lazy);
+
+/// Lock a range of memory in physical memory.
+///
+/// Locked pages are never paged out nor reclaimed, which keeps major faults out of latency critical
+/// paths. With `on_fault`, pages are only locked once they get faulted in, so that untouched memory
+/// isn't charged. The amount of lockable memory is bounded by `RLIMIT_MEMLOCK` (unless the process
+/// has `CAP_IPC_LOCK`): if the lock fails, a diagnostic is printed (once per process), the failure
+/// is counted in `vmem_stats`, and the memory stays usable but unlocked.
+///
+/// Parameters:
+///     * `mem`: Page aligned start of the range.
+///     * `size`: Size, in bytes, of the range.
+///     * `on_fault`: Whether to lock the pages as they get faulted in, rather than populating and
+///                   locking all of them right away.
+///
+/// Return: Whether the memory was locked.
+ALLOHA_API bool vmem_lock(u8* mem, usize size, bool on_fault);
+
+/// Unlock a range of memory previously locked via `vmem_lock`.
+ALLOHA_API void vmem_unlock(u8* mem, usize size);
+
+/// Current accounting of mapped and locked memory.
+ALLOHA_API struct vmem_stats vmem_stats(void);
+
+ALLOHA_EXTERN_C_END
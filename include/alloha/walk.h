@@ -0,0 +1,121 @@
+/// Heap walking and allocation dumps.
+///
+/// Walkers enumerate the live blocks of the allocators keeping a header for each block: the
+/// blocks of a stack, found by following the `previous_offset` chain of their headers, and the
+/// objects of a garbage collected heap, found by the type stored in their headers. Plain arenas
+/// keep no metadata per block, so their blocks are only known when recorded in a side table by
+/// `arena_tag`, otherwise only their used and free extents are.
+///
+/// Dumps write the layout of an allocator, that is, the boundaries and padding of each of its
+/// blocks, either as JSON, meant to be read by people and scripts:
+/// ```json
+/// {"allocator":"stack","address":"0x7f3a1c000000","capacity":4096,"used":96,"blocks":[
+/// {"offset":72,"size":24,"padding":24},
+/// {"offset":24,"size":48,"padding":24}]}
+/// ```
+/// or in a compact binary format, made of a `struct alloha_dump_header` followed by one
+/// `struct alloha_dump_block` for each block, in the same order as their walk. Every field is
+/// written in the byte order of the machine, which can be told from `magic`.
+///
+/// Walking only reads the memory of the allocator, and can thus be done on a live process from a
+/// debugger, or on the memory of a core dump.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#pragma once
+
+#include <alloha/arena.h>
+#include <alloha/core.h>
+#include <alloha/gc.h>
+#include <alloha/stack.h>
+
+#include <stdio.h>
+
+ALLOHA_EXTERN_C_BEGIN
+
+/// Live block of memory found by a walk.
+struct alloha_block {
+    u8 const* memory;   ///< Start of the memory of the block.
+    usize     offset;   ///< Offset, in bytes, of `memory` from the start of the allocator memory.
+    usize     size;     ///< Size, in bytes, of the memory of the block.
+    usize     padding;  ///< Bytes preceding `memory`, including its header and alignment padding.
+};
+
+/// Function called on each block of a walk.
+///
+/// Return: Whether the walk should continue.
+typedef bool (*alloha_walk_fn)(struct alloha_block const* block, void* user_data);
+
+/// Walk the blocks of a stack, from the most recently allocated one.
+///
+/// Return: The amount of blocks visited.
+ALLOHA_API usize stack_walk(struct stack const* stack, alloha_walk_fn fn, void* user_data);
+
+/// Walk the objects of the to-space of a heap, in the order of their addresses.
+///
+/// The offset of each object is relative to the start of the to-space, and its padding is the size
+/// of the object header.
+///
+/// Return: The amount of objects visited.
+ALLOHA_API usize gc_heap_walk(struct gc_heap const* heap, alloha_walk_fn fn, void* user_data);
+
+/// Walk the blocks recorded by the side table of an arena, in the order of their addresses.
+///
+/// Blocks are only known while the arena is tagged, see `arena_tag`.
+///
+/// Return: The amount of blocks visited.
+ALLOHA_API usize arena_walk(struct arena const* arena, alloha_walk_fn fn, void* user_data);
+
+enum alloha_dump_format {
+    ALLOHA_DUMP_JSON,
+    ALLOHA_DUMP_BINARY,
+};
+
+/// Magic number starting binary dumps, the ASCII of "AHDP" when read in the right byte order.
+#define ALLOHA_DUMP_MAGIC 0x50444841u
+
+/// Version of the binary dump format.
+#define ALLOHA_DUMP_VERSION 1u
+
+/// Kind of allocator of a dump.
+enum alloha_dump_kind {
+    ALLOHA_DUMP_ARENA   = 0,
+    ALLOHA_DUMP_STACK   = 1,
+    ALLOHA_DUMP_GC_HEAP = 2,
+};
+
+/// Header of binary dumps.
+struct alloha_dump_header {
+    u32 magic;    ///< Always `ALLOHA_DUMP_MAGIC`.
+    u32 version;  ///< Always `ALLOHA_DUMP_VERSION`.
+    u32 kind;     ///< The `enum alloha_dump_kind` of the allocator.
+    u32 reserved;
+    u64 address;      ///< Address of the start of the allocator memory.
+    u64 capacity;     ///< Capacity, in bytes, of the allocator.
+    u64 used;         ///< Bytes in use, including headers and padding.
+    u64 block_count;  ///< Amount of `struct alloha_dump_block` following the header.
+};
+
+/// Block of binary dumps.
+struct alloha_dump_block {
+    u64 offset;
+    u64 size;
+    u64 padding;
+};
+
+/// Write the layout of a stack.
+///
+/// Return: Whether the whole dump could be written to `out`.
+ALLOHA_API bool stack_dump(struct stack const* stack, FILE* out, enum alloha_dump_format format);
+
+/// Write the layout of the to-space of a heap.
+///
+/// Return: Whether the whole dump could be written to `out`.
+ALLOHA_API bool gc_heap_dump(struct gc_heap const* heap, FILE* out, enum alloha_dump_format format);
+
+/// Write the used and free extents of an arena, and its blocks if it's tagged.
+///
+/// Return: Whether the whole dump could be written to `out`.
+ALLOHA_API bool arena_dump(struct arena const* arena, FILE* out, enum alloha_dump_format format);
+
+ALLOHA_EXTERN_C_END
@@ -2,6 +2,27 @@
 ///
 /// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
 
+// Expose the POSIX and GNU extensions (threads, virtual memory) used by the library.
+#if !defined(_WIN32) && !defined(_GNU_SOURCE)
+#    define _GNU_SOURCE
+#endif
+
 #include "arena.c"
+#include "context.c"
 #include "core.c"
+#include "down_arena.c"
+#include "fiber_stack.c"
+#include "gc.c"
+#include "jobs.c"
+#include "lifetime.c"
+#include "oom.c"
+#include "pressure.c"
+#include "recycle_arena.c"
+#include "region.c"
+#include "sample.c"
+#include "scavenger.c"
 #include "stack.c"
+#include "temp.c"
+#include "thread.c"
+#include "vmem.c"
+#include "walk.c"
@@ -5,8 +5,11 @@
 #include <alloha/arena.h>
 
 #include <alloha/core.h>
+#include <alloha/probe.h>
+#include <alloha/sample.h>
+#include <alloha/stack.h>
+#include <alloha/vmem.h>
 #include <assert.h>
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -18,6 +21,7 @@ struct arena arena_new(usize capacity, u8* buf) {
         .buf      = buf,
         .capacity = capacity,
         .offset   = 0,
+        .oom      = NULL,
     };
 }
 
@@ -29,28 +33,23 @@ void arena_init(struct arena* restrict arena, usize capacity, u8* restrict buf)
         assert(buf && "arena_init called with an inconsistent data: non-null size but null buffer");
     }
 
-    arena->buf      = buf;
-    arena->capacity = capacity;
-    arena->offset   = 0;
+    arena->buf             = buf;
+    arena->capacity        = capacity;
+    arena->offset          = 0;
+    arena->reserved_offset = 0;
+    arena->reserved_size   = 0;
+    arena->budget          = NULL;
+    arena->oom             = NULL;
+    arena->tags            = NULL;
 }
 
-u8* arena_alloc_aligned(struct arena* arena, usize size, u32 alignment) {
-    if (!arena || arena->capacity == 0 || size == 0) {
-        return NULL;
-    }
-
+/// Bump the offset of the arena, if there is enough memory for the block.
+static u8* arena_bump(struct arena* arena, usize size, u32 alignment) {
     uptr const memory_addr    = (uptr)arena->buf;
     uptr const new_block_addr = align_forward(memory_addr + arena->offset, alignment);
 
     // Check if there is enough memory.
     if (new_block_addr + size > arena->capacity + memory_addr) {
-        fprintf(
-            stderr,
-            "ArenaAlloc::alloc unable to allocate %zu bytes of memory (%zu bytes required due "
-            "to alignment). The allocator has only %zu bytes remaining.\n",
-            size,
-            usize_wrap_sub(size + new_block_addr, (arena->offset + memory_addr)),
-            arena->capacity - arena->offset);
         return NULL;
     }
 
@@ -58,6 +57,116 @@ u8* arena_alloc_aligned(struct arena* arena, usize size, u32 alignment) {
     return (u8*)new_block_addr;
 }
 
+#if defined(ALLOHA_ARENA_TAGGING)
+/// Drop the records of the blocks ending past `end`, which were freed by rewinding the arena.
+static void arena_tag_trim(struct arena_tags* tags, usize end) {
+    while (tags->count > 0) {
+        struct arena_tag const* last = &tags->tags[tags->count - 1];
+        if (last->offset + last->size <= end) {
+            break;
+        }
+        --tags->count;
+    }
+}
+#endif
+
+/// Record a block newly allocated by the arena, if it's tagged.
+static void arena_tag_block(
+    struct arena* arena,
+    u8 const*     block,
+    usize         size,
+    usize         previous_offset) {
+#if defined(ALLOHA_ARENA_TAGGING)
+    struct arena_tags* tags = arena->tags;
+    if (!tags || !block) {
+        return;
+    }
+
+    // The failure policy may have rewound the arena before the block got allocated.
+    usize const offset = (usize)(block - arena->buf);
+    usize const start  = alloha_min(previous_offset, offset);
+    arena_tag_trim(tags, start);
+    if (tags->count == tags->capacity) {
+        ++tags->dropped;
+        return;
+    }
+    tags->tags[tags->count++] = (struct arena_tag){
+        .offset  = offset,
+        .size    = size,
+        .padding = offset - start,
+    };
+#else
+    alloha_discard(arena);
+    alloha_discard(block);
+    alloha_discard(size);
+    alloha_discard(previous_offset);
+#endif
+}
+
+/// Update the record of the last block of the arena, resized in place from `old_size` bytes.
+static void arena_tag_resize(struct arena* arena, u8 const* block, usize old_size, usize size) {
+#if defined(ALLOHA_ARENA_TAGGING)
+    struct arena_tags* tags = arena->tags;
+    if (!tags) {
+        return;
+    }
+
+    usize const offset = (usize)(block - arena->buf);
+    arena_tag_trim(tags, offset + old_size);
+    if (tags->count > 0 && tags->tags[tags->count - 1].offset == offset) {
+        tags->tags[tags->count - 1].size = size;
+    }
+#else
+    alloha_discard(arena);
+    alloha_discard(block);
+    alloha_discard(old_size);
+    alloha_discard(size);
+#endif
+}
+
+/// Apply the failure policy of the arena to an allocation that didn't fit.
+static u8* arena_alloc_failed(
+    struct arena* arena,
+    usize         size,
+    u32           alignment,
+    char const*   function) {
+    ALLOHA_PROBE4(arena_alloc_failed, arena, size, alignment, arena->capacity - arena->offset);
+    for (u32 attempt = 0;; ++attempt) {
+        struct alloha_oom_info const info = {
+            .error     = ALLOHA_ERROR_OUT_OF_MEMORY,
+            .function  = function,
+            .allocator = arena,
+            .size      = size,
+            .alignment = alignment,
+            .available = arena->capacity - arena->offset,
+        };
+        if (!alloha_oom_retry(arena->oom, &info, attempt)) {
+            return NULL;
+        }
+
+        u8* new_block = arena_bump(arena, size, alignment);
+        if (new_block) {
+            return new_block;
+        }
+    }
+}
+
+u8* arena_alloc_aligned(struct arena* arena, usize size, u32 alignment) {
+    if (!arena || arena->capacity == 0 || size == 0) {
+        return NULL;
+    }
+
+    alloha_sample_alloc(size);
+    usize const previous_offset = arena->offset;
+    u8*         new_block       = arena_bump(arena, size, alignment);
+    if (!new_block) {
+        new_block = arena_alloc_failed(arena, size, alignment, "arena_alloc_aligned");
+    }
+    arena_tag_block(arena, new_block, size, previous_offset);
+    ALLOHA_PROBE4(arena_alloc, arena, size, alignment, new_block);
+    return new_block;
+}
+
 u8* arena_alloc(struct arena* arena, usize size) {
     return arena_alloc_aligned(arena, size, ALLOHA_DEFAULT_ALIGNMENT);
 }
@@ -78,46 +187,55 @@ u8* arena_realloc(
 
     // Check if the user wants to allocate a completely new block.
     if (block == NULL || current_capacity == 0) {
-        return arena_alloc_aligned(arena, new_capacity, alignment);
+        u8* new_block = arena_alloc_aligned(arena, new_capacity, alignment);
+        ALLOHA_PROBE5(arena_realloc, arena, block, current_capacity, new_capacity, new_block);
+        return new_block;
     }
 
     uptr const block_addr      = (uptr)block;
     uptr const memory_start    = (uptr)arena->buf;
-    uptr const memory_end      = memory_start + arena->capacity;
     uptr const start_free_addr = memory_start + arena->offset;
 
-    // Check if the block lies within the allocator's memory.
-    if (block_addr < memory_start || block_addr >= memory_end) {
-        fprintf(stderr, "arena_realloc called with pointer outside of its domain.\n");
-        return NULL;
-    }
-
-    // Check if the block is already free.
-    if (block_addr >= start_free_addr) {
-        fprintf(
-            stderr,
-            "arena_realloc called with a pointer to a free address of the arena "
-            "domain.\n");
+    // Check if the block lies within the allocator's memory, and isn't already free.
+    if (block_addr < memory_start || block_addr >= start_free_addr) {
+        alloha_report_error(ALLOHA_ERROR_INVALID_BLOCK, "arena_realloc");
         return NULL;
     }
 
     // If the block is the last allocated, just bump the offset.
     if (block_addr == usize_wrap_sub(start_free_addr, current_capacity)) {
-        // Check if there is enough space.
-        if (block_addr + new_capacity > memory_end) {
-            fprintf(
-                stderr,
-                "arena_realloc unable to reallocate block from %zu bytes to %zu bytes.\n",
-                current_capacity,
-                new_capacity);
-            return NULL;
+        // Check if there is enough space, the failure policy may grow the arena.
+        if (block_addr + new_capacity > memory_start + arena->capacity) {
+            ALLOHA_PROBE4(
+                arena_alloc_failed,
+                arena,
+                new_capacity - current_capacity,
+                1,
+                arena->capacity - arena->offset);
+        }
+        for (u32 attempt = 0; block_addr + new_capacity > memory_start + arena->capacity;
+             ++attempt) {
+            struct alloha_oom_info const info = {
+                .error     = ALLOHA_ERROR_OUT_OF_MEMORY,
+                .function  = "arena_realloc",
+                .allocator = arena,
+                .size      = new_capacity - current_capacity,
+                .alignment = 1,
+                .available = arena->capacity - arena->offset,
+            };
+            if (!alloha_oom_retry(arena->oom, &info, attempt)) {
+                return NULL;
+            }
         }
 
         arena->offset += usize_wrap_sub(new_capacity, current_capacity);
+        arena_tag_resize(arena, block, current_capacity, new_capacity);
+        ALLOHA_PROBE5(arena_realloc, arena, block, current_capacity, new_capacity, block);
         return block;
     }
 
     u8* new_mem = arena_alloc_aligned(arena, new_capacity, alignment);
+    ALLOHA_PROBE5(arena_realloc, arena, block, current_capacity, new_capacity, new_mem);
     if (!new_mem) {
         return NULL;
     }
@@ -129,15 +247,227 @@ u8* arena_realloc(
     return new_mem;
 }
 
+u8* arena_reserve(struct arena* arena, usize max_size, u32 alignment) {
+    if (!arena || arena->capacity == 0) {
+        return NULL;
+    }
+
+    // Bump over the reserved span to check that it fits, then hand the offset back.
+    usize const offset = arena->offset;
+    u8*         span   = arena_bump(arena, max_size, alignment);
+    if (!span) {
+        span = arena_alloc_failed(arena, max_size, alignment, "arena_reserve");
+        if (!span) {
+            return NULL;
+        }
+    }
+
+    arena->offset          = offset;
+    arena->reserved_offset = (usize)(span - arena->buf);
+    arena->reserved_size   = arena->capacity - arena->reserved_offset;
+    return span;
+}
+
+u8* arena_commit(struct arena* arena, usize used) {
+    if (!arena) {
+        return NULL;
+    }
+
+    // The reservation is lost if the arena was allocated from in the meantime.
+    if (used > arena->reserved_size || arena->offset > arena->reserved_offset) {
+        alloha_report_error(ALLOHA_ERROR_INVALID_BLOCK, "arena_commit");
+        arena->reserved_size = 0;
+        return NULL;
+    }
+
+    u8* block            = arena->buf + arena->reserved_offset;
+    arena->reserved_size = 0;
+    if (used == 0) {
+        return NULL;
+    }
+
+    arena_tag_block(arena, block, used, arena->offset);
+    arena->offset = arena->reserved_offset + used;
+    return block;
+}
+
 void arena_clear(struct arena* arena) {
     if (!arena) {
         return;
     }
-    arena->offset = 0;
+    ALLOHA_PROBE2(arena_clear, arena, arena->offset);
+    arena->offset        = 0;
+    arena->reserved_size = 0;
+}
+
+bool arena_tag(struct arena* arena, struct arena_tags* tags) {
+    if (!arena) {
+        return false;
+    }
+
+#if defined(ALLOHA_ARENA_TAGGING)
+    if (tags) {
+        assert(
+            (tags->tags || tags->capacity == 0) && "arena_tag called with a table without memory");
+        tags->count   = 0;
+        tags->dropped = 0;
+    }
+    arena->tags = tags;
+    return tags != NULL;
+#else
+    alloha_discard(tags);
+    return false;
+#endif
+}
+
+void arena_prefault(struct arena* arena, u32 thread_count) {
+    if (!arena || arena->capacity == 0) {
+        return;
+    }
+    vmem_prefault(arena->buf + arena->offset, arena->capacity - arena->offset, thread_count);
+}
+
+bool vm_arena_create(struct vm_arena* vm_arena, usize capacity, u32 flags) {
+    assert(vm_arena && "vm_arena_create called with null arena");
+
+    capacity = (usize)align_forward((uptr)capacity, (u32)vmem_page_size());
+    u8* buf  = vmem_alloc(capacity, (flags & VM_ARENA_POPULATE) ? VMEM_POPULATE : VMEM_DEFAULT);
+    if (!buf) {
+        *vm_arena = (struct vm_arena){0};
+        return false;
+    }
+
+    vm_arena->arena        = arena_new(capacity, buf);
+    vm_arena->locked_bytes = 0;
+    if (flags & VM_ARENA_LOCK) {
+        bool const on_fault = !(flags & VM_ARENA_POPULATE);
+        if (vmem_lock(buf, capacity, on_fault)) {
+            vm_arena->locked_bytes = capacity;
+        }
+    }
+    return true;
+}
+
+void vm_arena_destroy(struct vm_arena* vm_arena) {
+    if (!vm_arena || !vm_arena->arena.buf) {
+        return;
+    }
+
+    if (vm_arena->locked_bytes != 0) {
+        vmem_unlock(vm_arena->arena.buf, vm_arena->locked_bytes);
+    }
+    vmem_free(vm_arena->arena.buf, vm_arena->arena.capacity);
+    *vm_arena = (struct vm_arena){0};
+}
+
+/// Charge the capacity of a new sub-arena to its budget, applying the failure policy of the parent.
+static bool arena_budget_charge(
+    struct arena_budget*            budget,
+    usize                           size,
+    void*                           parent,
+    struct alloha_oom_policy const* policy) {
+    if (!budget) {
+        return true;
+    }
+
+    for (u32 attempt = 0; budget->used > budget->limit || size > budget->limit - budget->used;
+         ++attempt) {
+        struct alloha_oom_info const info = {
+            .error     = ALLOHA_ERROR_OUT_OF_MEMORY,
+            .function  = "arena_sub",
+            .allocator = parent,
+            .size      = size,
+            .alignment = 1,
+            .available = usize_wrap_sub(budget->limit, alloha_min(budget->used, budget->limit)),
+        };
+        if (!alloha_oom_retry(policy, &info, attempt)) {
+            return false;
+        }
+    }
+
+    budget->used += size;
+    return true;
+}
+
+static void arena_budget_refund(struct arena_budget* budget, usize size) {
+    if (budget) {
+        budget->used -= alloha_min(size, budget->used);
+    }
+}
+
+struct arena arena_sub(
+    struct arena* restrict        parent,
+    usize                         capacity,
+    u32                           alignment,
+    struct arena_budget* restrict budget) {
+    if (!parent || capacity == 0 || !arena_budget_charge(budget, capacity, parent, parent->oom)) {
+        return arena_new(0, NULL);
+    }
+
+    u8* buf = arena_alloc_aligned(parent, capacity, alignment);
+    if (!buf) {
+        arena_budget_refund(budget, capacity);
+        return arena_new(0, NULL);
+    }
+
+    struct arena child = arena_new(capacity, buf);
+    child.budget       = budget;
+    return child;
+}
+
+usize arena_sub_end(struct arena* restrict parent, struct arena* restrict child) {
+    if (!parent || !child || !child->buf) {
+        return 0;
+    }
+
+    usize const tail = child->capacity - child->offset;
+    arena_budget_refund(child->budget, tail);
+
+    // The tail can only be given back if nothing was allocated from the parent after the child.
+    usize returned = 0;
+    if (child->buf + child->capacity == parent->buf + parent->offset) {
+        parent->offset -= tail;
+        returned = tail;
+        arena_tag_resize(parent, child->buf, child->capacity, child->offset);
+    }
+
+    *child = arena_new(0, NULL);
+    return returned;
+}
+
+struct arena arena_sub_stack(
+    struct stack* restrict        parent,
+    usize                         capacity,
+    u32                           alignment,
+    struct arena_budget* restrict budget) {
+    if (!parent || capacity == 0 || !arena_budget_charge(budget, capacity, parent, parent->oom)) {
+        return arena_new(0, NULL);
+    }
+
+    u8* buf = stack_alloc_aligned(parent, capacity, alignment);
+    if (!buf) {
+        arena_budget_refund(budget, capacity);
+        return arena_new(0, NULL);
+    }
+
+    struct arena child = arena_new(capacity, buf);
+    child.budget       = budget;
+    return child;
+}
+
+bool arena_sub_stack_end(struct stack* restrict parent, struct arena* restrict child) {
+    if (!parent || !child || !child->buf || !stack_clear_at(parent, child->buf)) {
+        return false;
+    }
+
+    arena_budget_refund(child->budget, child->capacity);
+    *child = arena_new(0, NULL);
+    return true;
 }
 
 struct scratch_arena scratch_arena_start(struct arena* arena) {
     assert(arena && "scratch_arena_start called with null arena");
+    ALLOHA_PROBE2(arena_scratch_start, arena, arena->offset);
     return (struct scratch_arena){
         .parent       = arena,
         .saved_offset = arena->offset,
@@ -158,6 +488,11 @@ void scratch_arena_end(struct scratch_arena* scratch) {
         return;
     }
 
+    ALLOHA_PROBE3(
+        arena_scratch_end,
+        scratch->parent,
+        scratch->parent->offset,
+        scratch->saved_offset);
     scratch->parent->offset = scratch->saved_offset;
     scratch->parent         = NULL;
     scratch->saved_offset   = 0;
@@ -0,0 +1,107 @@
+/// Thread-local allocator context implementation.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/context.h>
+
+#include <alloha/arena.h>
+#include <alloha/core.h>
+#include <alloha/down_arena.h>
+#include <alloha/oom.h>
+#include <alloha/recycle_arena.h>
+#include <alloha/stack.h>
+#include <assert.h>
+
+static u8* alloha_null_alloc(void* allocator, usize size, u32 alignment) {
+    struct alloha_oom_info const info = {
+        .error     = ALLOHA_ERROR_OUT_OF_MEMORY,
+        .function  = "alloha_ctx_alloc_aligned",
+        .allocator = allocator,
+        .size      = size,
+        .alignment = alignment,
+        .available = 0,
+    };
+    alloha_discard(alloha_oom_retry(NULL, &info, 0));
+    return NULL;
+}
+
+/// Allocator context of a thread.
+///
+/// The current allocator is cached out of the stack of saved allocators, so that an allocation
+/// costs a load of the function pointer and an indirect call. The context is accessed on every
+/// allocation, hence the use of `ALLOHA_THREAD_LOCAL`.
+struct alloha_context {
+    struct alloha_allocator current;
+    u32                     depth;
+    struct alloha_allocator saved[ALLOHA_CONTEXT_MAX_DEPTH];
+};
+
+static ALLOHA_THREAD_LOCAL struct alloha_context alloha_context = {
+    .current = {.alloc = alloha_null_alloc, .allocator = NULL},
+};
+
+static u8* alloha_arena_alloc_fn(void* allocator, usize size, u32 alignment) {
+    return arena_alloc_aligned((struct arena*)allocator, size, alignment);
+}
+
+static u8* alloha_stack_alloc_fn(void* allocator, usize size, u32 alignment) {
+    return stack_alloc_aligned((struct stack*)allocator, size, alignment);
+}
+
+static u8* alloha_down_arena_alloc_fn(void* allocator, usize size, u32 alignment) {
+    return down_arena_alloc_aligned((struct down_arena*)allocator, size, alignment);
+}
+
+static u8* alloha_recycle_arena_alloc_fn(void* allocator, usize size, u32 alignment) {
+    return recycle_arena_alloc_aligned((struct recycle_arena*)allocator, size, alignment);
+}
+
+struct alloha_allocator alloha_arena_allocator(struct arena* arena) {
+    return (struct alloha_allocator){.alloc = alloha_arena_alloc_fn, .allocator = arena};
+}
+
+struct alloha_allocator alloha_stack_allocator(struct stack* stack) {
+    return (struct alloha_allocator){.alloc = alloha_stack_alloc_fn, .allocator = stack};
+}
+
+struct alloha_allocator alloha_down_arena_allocator(struct down_arena* arena) {
+    return (struct alloha_allocator){.alloc = alloha_down_arena_alloc_fn, .allocator = arena};
+}
+
+struct alloha_allocator alloha_recycle_arena_allocator(struct recycle_arena* arena) {
+    return (struct alloha_allocator){.alloc = alloha_recycle_arena_alloc_fn, .allocator = arena};
+}
+
+bool alloha_push_allocator(struct alloha_allocator allocator) {
+    assert(allocator.alloc && "alloha_push_allocator called with a null allocation function");
+
+    struct alloha_context* context = &alloha_context;
+    if (context->depth == ALLOHA_CONTEXT_MAX_DEPTH) {
+        return false;
+    }
+    context->saved[context->depth++] = context->current;
+    context->current                 = allocator;
+    return true;
+}
+
+void alloha_pop_allocator(void) {
+    struct alloha_context* context = &alloha_context;
+    assert(context->depth != 0 && "alloha_pop_allocator called without any allocator installed");
+    if (context->depth == 0) {
+        return;
+    }
+    context->current = context->saved[--context->depth];
+}
+
+struct alloha_allocator alloha_current_allocator(void) {
+    return alloha_context.current;
+}
+
+u8* alloha_ctx_alloc_aligned(usize size, u32 alignment) {
+    struct alloha_allocator const current = alloha_context.current;
+    return current.alloc(current.allocator, size, alignment);
+}
+
+u8* alloha_ctx_alloc(usize size) {
+    return alloha_ctx_alloc_aligned(size, ALLOHA_DEFAULT_ALIGNMENT);
+}
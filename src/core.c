@@ -7,6 +7,10 @@
 #include <assert.h>
 #include <string.h>
 
+#if defined(ALLOHA_STRESS_SCHEDULE)
+#    include <alloha/thread.h>
+#endif
+
 usize usize_wrap_sub(usize lhs, usize rhs) {
     isize res = (isize)lhs - (isize)rhs;
     return (res <= 0) ? 0 : (usize)res;
@@ -48,19 +52,35 @@ u32 padding_with_header(uptr ptr, u32 alignment, u32 header_size, u32 header_ali
         alloha_is_power_of_two(header_alignment) &&
         "padding_with_header expected the header alignment to be a power of two");
 
-    u32 padding = 0;
-    u32 mod     = (u32)(ptr & ((uptr)alignment - 1));
-    if (mod != 0) {
-        padding += alignment - mod;
-    }
-    ptr += padding;
+    // The header is placed right before the memory block, and its size is a multiple of its
+    // alignment. Hence, aligning the block to the strictest of both alignments after making room
+    // for the header satisfies both requirements.
+    u32 const  strictest_alignment = alloha_max(alignment, header_alignment);
+    uptr const block_addr          = align_forward(ptr + header_size, strictest_alignment);
+    u32 const  padding             = (u32)(block_addr - ptr);
 
-    // Compute the padding necessary for the header alignment.
-    u32 mod_header = (u32)(ptr & ((uptr)header_alignment - 1));
-    if (mod_header != 0) {
-        padding += header_alignment - mod_header;
+    return padding;
+}
+
+void alloha_sched_point(void) {
+#if defined(ALLOHA_STRESS_SCHEDULE)
+    static _Thread_local u64 state = 0;
+    if (state == 0) {
+        state = (u64)(uptr)&state | 1;  // Distinct seed per thread.
     }
-    padding += header_size;
 
-    return padding;
+    // xorshift64.
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+
+    u64 const dice = state % 64;
+    if (dice < 8) {
+        alloha_thread_yield();
+    } else if (dice < 10) {
+        // Short busy delay, widening the window between the surrounding operations.
+        for (volatile u32 spin = 0; spin < (u32)(state >> 54); ++spin) {
+        }
+    }
+#endif
 }
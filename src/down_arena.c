@@ -0,0 +1,158 @@
+/// Bump-down arena allocator implementation.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/down_arena.h>
+
+#include <alloha/core.h>
+#include <alloha/oom.h>
+#include <alloha/sample.h>
+#include <assert.h>
+#include <string.h>
+
+struct down_arena down_arena_new(usize capacity, u8* buf) {
+    if (capacity != 0) {
+        assert(
+            buf && "down_arena_new called with inconsistent data: non-null size but null buffer");
+    }
+    return (struct down_arena){
+        .buf      = buf,
+        .capacity = capacity,
+        .top      = alloha_ptr_add(buf, capacity),
+        .oom      = NULL,
+    };
+}
+
+void down_arena_init(struct down_arena* restrict arena, usize capacity, u8* restrict buf) {
+    if (!arena) {
+        return;
+    }
+    *arena = down_arena_new(capacity, buf);
+}
+
+/// Bump the top of the arena down, if there is enough memory for the block.
+static u8* down_arena_bump(struct down_arena* arena, usize size, u32 alignment) {
+    assert(alloha_is_power_of_two(alignment) && "down_arena expected a power of two alignment");
+
+    uptr const top = (uptr)arena->top;
+    if (size > top - (uptr)arena->buf) {
+        return NULL;
+    }
+
+    uptr const new_top = (top - size) & ~((uptr)alignment - 1);
+    if (new_top < (uptr)arena->buf) {
+        return NULL;
+    }
+
+    arena->top = (u8*)new_top;
+    return arena->top;
+}
+
+/// Apply the failure policy of the arena to an allocation that didn't fit.
+static u8* down_arena_alloc_failed(struct down_arena* arena, usize size, u32 alignment) {
+    for (u32 attempt = 0;; ++attempt) {
+        struct alloha_oom_info const info = {
+            .error     = ALLOHA_ERROR_OUT_OF_MEMORY,
+            .function  = "down_arena_alloc_aligned",
+            .allocator = arena,
+            .size      = size,
+            .alignment = alignment,
+            .available = (usize)(arena->top - arena->buf),
+        };
+        if (!alloha_oom_retry(arena->oom, &info, attempt)) {
+            return NULL;
+        }
+
+        u8* new_block = down_arena_bump(arena, size, alignment);
+        if (new_block) {
+            return new_block;
+        }
+    }
+}
+
+u8* down_arena_alloc_aligned(struct down_arena* arena, usize size, u32 alignment) {
+    if (!arena || arena->capacity == 0 || size == 0) {
+        return NULL;
+    }
+
+    alloha_sample_alloc(size);
+    u8* new_block = down_arena_bump(arena, size, alignment);
+    return new_block ? new_block : down_arena_alloc_failed(arena, size, alignment);
+}
+
+u8* down_arena_alloc(struct down_arena* arena, usize size) {
+    return down_arena_alloc_aligned(arena, size, ALLOHA_DEFAULT_ALIGNMENT);
+}
+
+u8* down_arena_realloc(
+    struct down_arena* restrict arena,
+    u8* restrict block,
+    usize current_capacity,
+    usize new_capacity,
+    u32   alignment) {
+    assert(new_capacity != 0 && "down_arena_realloc called with a zero `new_capacity` parameter");
+
+    if (!arena || arena->capacity == 0) {
+        return NULL;
+    }
+    if (block == NULL || current_capacity == 0) {
+        return down_arena_alloc_aligned(arena, new_capacity, alignment);
+    }
+
+    // Check if the block lies within the allocated memory of the arena.
+    if (block < arena->top || block >= arena->buf + arena->capacity) {
+        alloha_report_error(ALLOHA_ERROR_INVALID_BLOCK, "down_arena_realloc");
+        return NULL;
+    }
+
+    if (new_capacity <= current_capacity) {
+        return block;
+    }
+
+    // The last allocated block is grown downwards over the free space, reusing its memory.
+    if (block == arena->top) {
+        arena->top    = block + current_capacity;
+        u8* new_block = down_arena_alloc_aligned(arena, new_capacity, alignment);
+        if (!new_block) {
+            arena->top = block;
+            return NULL;
+        }
+        memmove(new_block, block, current_capacity);
+        return new_block;
+    }
+
+    u8* new_block = down_arena_alloc_aligned(arena, new_capacity, alignment);
+    if (new_block) {
+        memory_copy(new_block, block, current_capacity);
+    }
+    return new_block;
+}
+
+void down_arena_clear(struct down_arena* arena) {
+    if (!arena) {
+        return;
+    }
+    arena->top = alloha_ptr_add(arena->buf, arena->capacity);
+}
+
+usize down_arena_used(struct down_arena const* arena) {
+    return (usize)(alloha_ptr_add(arena->buf, arena->capacity) - arena->top);
+}
+
+struct scratch_down_arena scratch_down_arena_start(struct down_arena* arena) {
+    assert(arena && "scratch_down_arena_start called with null arena");
+    return (struct scratch_down_arena){
+        .parent    = arena,
+        .saved_top = arena->top,
+    };
+}
+
+void scratch_down_arena_end(struct scratch_down_arena* scratch) {
+    if (!scratch || !scratch->parent) {
+        return;
+    }
+
+    scratch->parent->top = scratch->saved_top;
+    scratch->parent      = NULL;
+    scratch->saved_top   = NULL;
+}
@@ -0,0 +1,206 @@
+/// Fiber stack allocator implementation.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/fiber_stack.h>
+
+#include <alloha/core.h>
+#include <alloha/oom.h>
+#include <alloha/thread.h>
+#include <alloha/vmem.h>
+#include <assert.h>
+
+bool fiber_stack_pool_create(struct fiber_stack_pool* pool, struct fiber_stack_config config) {
+    assert(pool && "fiber_stack_pool_create called with null pool");
+    assert(
+        (config.stack_size != 0 && config.max_stacks != 0) &&
+        "fiber_stack_pool_create called with an empty configuration");
+
+    u32 const page_size = (u32)vmem_page_size();
+    config.stack_size   = (usize)align_forward((uptr)config.stack_size, page_size);
+    config.guard_size   = (usize)align_forward((uptr)alloha_max(config.guard_size, 1), page_size);
+
+    *pool           = (struct fiber_stack_pool){0};
+    pool->config    = config;
+    pool->slot_size = config.guard_size + config.stack_size;
+    pool->base      = vmem_alloc(pool->slot_size * config.max_stacks, VMEM_RESERVE);
+    if (!pool->base) {
+        return false;
+    }
+    pool->free_slots = (u32*)vmem_alloc(config.max_stacks * sizeof(u32), VMEM_DEFAULT);
+    if (!pool->free_slots) {
+        vmem_free(pool->base, pool->slot_size * config.max_stacks);
+        pool->base = NULL;
+        return false;
+    }
+
+    alloha_mutex_init(&pool->mutex);
+    return true;
+}
+
+void fiber_stack_pool_destroy(struct fiber_stack_pool* pool) {
+    if (!pool || !pool->base) {
+        return;
+    }
+
+    alloha_mutex_destroy(&pool->mutex);
+    vmem_free((u8*)pool->free_slots, pool->config.max_stacks * sizeof(u32));
+    vmem_free(pool->base, pool->slot_size * pool->config.max_stacks);
+    *pool = (struct fiber_stack_pool){0};
+}
+
+u32 fiber_stack_pool_available(struct fiber_stack_pool* pool) {
+    alloha_mutex_lock(&pool->mutex);
+    u32 const available = pool->free_count + (pool->config.max_stacks - pool->next_slot);
+    alloha_mutex_unlock(&pool->mutex);
+    return available;
+}
+
+static struct fiber_stack fiber_stack_of_slot(struct fiber_stack_pool const* pool, u32 slot) {
+    return (struct fiber_stack){
+        .base = pool->base + (usize)slot * pool->slot_size + pool->config.guard_size,
+        .size = pool->config.stack_size,
+    };
+}
+
+/// Slot of a stack handed out by the pool, or `max_stacks` if the stack isn't from the pool.
+static u32 fiber_stack_slot(struct fiber_stack_pool const* pool, struct fiber_stack stack) {
+    uptr const start = (uptr)pool->base + pool->config.guard_size;
+    if ((uptr)stack.base < start) {
+        return pool->config.max_stacks;
+    }
+
+    usize const offset = (usize)((uptr)stack.base - start);
+    usize const slot   = offset / pool->slot_size;
+    if (offset % pool->slot_size != 0 || slot >= pool->config.max_stacks) {
+        return pool->config.max_stacks;
+    }
+    return (u32)slot;
+}
+
+/// Take up to `count` slots from the pool, recycled ones first.
+///
+/// Return: Number of slots taken.
+static u32 fiber_stack_pool_take(struct fiber_stack_pool* pool, u32* slots, u32 count) {
+    alloha_mutex_lock(&pool->mutex);
+    u32 const recycled = alloha_min(count, pool->free_count);
+    pool->free_count -= recycled;
+    for (u32 i = 0; i < recycled; ++i) {
+        slots[i] = pool->free_slots[pool->free_count + i];
+    }
+
+    u32 const first_fresh = pool->next_slot;
+    u32 const fresh       = alloha_min(count - recycled, pool->config.max_stacks - first_fresh);
+    pool->next_slot += fresh;
+    alloha_mutex_unlock(&pool->mutex);
+
+    // Slots handed out for the first time are made accessible, leaving their guard untouched. This
+    // is done out of the lock, since nobody else can get these slots. A slot that can't be made
+    // accessible, for instance once the limit of mappings of the process is reached, stays unused.
+    u32 taken = recycled;
+    for (u32 slot = first_fresh; slot < first_fresh + fresh; ++slot) {
+        struct fiber_stack const stack = fiber_stack_of_slot(pool, slot);
+        if (vmem_commit(stack.base, stack.size)) {
+            slots[taken++] = slot;
+        }
+    }
+    return taken;
+}
+
+/// Give slots back to the pool, releasing the physical memory of their stacks.
+static void fiber_stack_pool_give(struct fiber_stack_pool* pool, u32 const* slots, u32 count) {
+    for (u32 i = 0; i < count; ++i) {
+        struct fiber_stack const stack = fiber_stack_of_slot(pool, slots[i]);
+        alloha_discard(vmem_decommit(stack.base, stack.size, pool->config.lazy));
+    }
+
+    alloha_mutex_lock(&pool->mutex);
+    for (u32 i = 0; i < count; ++i) {
+        pool->free_slots[pool->free_count++] = slots[i];
+    }
+    alloha_mutex_unlock(&pool->mutex);
+}
+
+struct fiber_stack fiber_stack_acquire(struct fiber_stack_pool* pool) {
+    if (!pool || !pool->base) {
+        return (struct fiber_stack){0};
+    }
+
+    u32 slot;
+    for (u32 attempt = 0; fiber_stack_pool_take(pool, &slot, 1) == 0; ++attempt) {
+        struct alloha_oom_info const info = {
+            .error     = ALLOHA_ERROR_OUT_OF_MEMORY,
+            .function  = "fiber_stack_acquire",
+            .allocator = pool,
+            .size      = pool->config.stack_size,
+            .alignment = (u32)vmem_page_size(),
+            .available = 0,
+        };
+        if (!alloha_oom_retry(pool->oom, &info, attempt)) {
+            return (struct fiber_stack){0};
+        }
+    }
+    return fiber_stack_of_slot(pool, slot);
+}
+
+void fiber_stack_release(struct fiber_stack_pool* pool, struct fiber_stack stack) {
+    if (!pool || !stack.base) {
+        return;
+    }
+
+    u32 const slot = fiber_stack_slot(pool, stack);
+    if (slot == pool->config.max_stacks) {
+        alloha_report_error(ALLOHA_ERROR_INVALID_BLOCK, "fiber_stack_release");
+        return;
+    }
+    fiber_stack_pool_give(pool, &slot, 1);
+}
+
+void fiber_stack_cache_init(
+    struct fiber_stack_cache* restrict cache,
+    struct fiber_stack_pool* restrict  pool) {
+    assert(cache && "fiber_stack_cache_init called with null cache");
+    cache->pool  = pool;
+    cache->count = 0;
+}
+
+struct fiber_stack fiber_stack_cache_acquire(struct fiber_stack_cache* cache) {
+    if (cache->count == 0) {
+        cache->count = fiber_stack_pool_take(cache->pool, cache->slots, FIBER_STACK_CACHE_SIZE / 2);
+        if (cache->count == 0) {
+            return fiber_stack_acquire(cache->pool);
+        }
+    }
+    return fiber_stack_of_slot(cache->pool, cache->slots[--cache->count]);
+}
+
+void fiber_stack_cache_release(struct fiber_stack_cache* cache, struct fiber_stack stack) {
+    if (!stack.base) {
+        return;
+    }
+
+    u32 const slot = fiber_stack_slot(cache->pool, stack);
+    if (slot == cache->pool->config.max_stacks) {
+        alloha_report_error(ALLOHA_ERROR_INVALID_BLOCK, "fiber_stack_cache_release");
+        return;
+    }
+
+    // The oldest half of the cache goes back to the pool.
+    if (cache->count == FIBER_STACK_CACHE_SIZE) {
+        u32 const half = FIBER_STACK_CACHE_SIZE / 2;
+        fiber_stack_pool_give(cache->pool, cache->slots, half);
+        for (u32 i = half; i < FIBER_STACK_CACHE_SIZE; ++i) {
+            cache->slots[i - half] = cache->slots[i];
+        }
+        cache->count = FIBER_STACK_CACHE_SIZE - half;
+    }
+    cache->slots[cache->count++] = slot;
+}
+
+void fiber_stack_cache_flush(struct fiber_stack_cache* cache) {
+    if (!cache || cache->count == 0) {
+        return;
+    }
+    fiber_stack_pool_give(cache->pool, cache->slots, cache->count);
+    cache->count = 0;
+}
@@ -0,0 +1,198 @@
+/// Semi-space copying garbage collector implementation.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/gc.h>
+
+#include <alloha/arena.h>
+#include <alloha/core.h>
+#include <alloha/oom.h>
+#include <alloha/sample.h>
+#include <alloha/vmem.h>
+#include <assert.h>
+#include <string.h>
+
+bool gc_heap_create(struct gc_heap* heap, struct gc_config config) {
+    assert(heap && "gc_heap_create called with null heap");
+
+    u32 const   page_size = (u32)vmem_page_size();
+    usize const capacity  = (usize)align_forward((uptr)config.space_capacity, page_size);
+    usize const roots     = (usize)config.max_roots * sizeof(void*);
+
+    *heap = (struct gc_heap){0};
+    u8* buf = vmem_alloc(2 * capacity + roots, VMEM_DEFAULT);
+    if (!buf) {
+        return false;
+    }
+    heap->spaces[0] = arena_new(capacity, buf);
+    heap->spaces[1] = arena_new(capacity, buf + capacity);
+    heap->roots     = (void**)(buf + 2 * capacity);
+    heap->max_roots = config.max_roots;
+    return true;
+}
+
+void gc_heap_destroy(struct gc_heap* heap) {
+    if (!heap || !heap->spaces[0].buf) {
+        return;
+    }
+
+    usize const capacity = heap->spaces[0].capacity;
+    vmem_free(heap->spaces[0].buf, 2 * capacity + (usize)heap->max_roots * sizeof(void*));
+    *heap = (struct gc_heap){0};
+}
+
+static struct gc_header* gc_header_of(u8 const* object) {
+    return (struct gc_header*)(object - sizeof(struct gc_header));
+}
+
+/// Size, in bytes, taken in a space by an object and its header.
+static usize gc_object_footprint(struct gc_type const* type) {
+    return (usize)align_forward((uptr)(sizeof(struct gc_header) + type->size), GC_ALIGNMENT);
+}
+
+/// Copy an object of the from-space to the to-space, unless already copied.
+///
+/// Return: The address of the copy of the object.
+static u8* gc_forward(struct arena* from, struct arena* to, u8* object) {
+    if (!object) {
+        return NULL;
+    }
+    assert(
+        (from->buf < object && object < from->buf + from->offset) &&
+        "gc_collect found a pointer to memory outside of the heap");
+    alloha_discard(from);
+
+    struct gc_header* header = gc_header_of(object);
+    if (header->forward) {
+        return header->forward;
+    }
+
+    // The to-space is as large as the from-space, so the copy always fits, and spaces are packed
+    // without padding since every footprint is a multiple of the alignment.
+    usize const footprint = gc_object_footprint(header->type);
+    u8* const   copy      = to->buf + to->offset;
+    to->offset += footprint;
+    memcpy(copy, header, sizeof(struct gc_header) + header->type->size);
+    header->forward                    = copy + sizeof(struct gc_header);
+    ((struct gc_header*)copy)->forward = NULL;
+    return header->forward;
+}
+
+/// Forward the pointer stored at `slot`, which may be unaligned.
+static void gc_forward_slot(struct arena* from, struct arena* to, u8* slot) {
+    u8* object;
+    memcpy(&object, slot, sizeof(object));
+    object = gc_forward(from, to, object);
+    memcpy(slot, &object, sizeof(object));
+}
+
+void gc_collect(struct gc_heap* heap) {
+    assert(heap && "gc_collect called with null heap");
+
+    struct arena* from = &heap->spaces[heap->to_space];
+    struct arena* to   = &heap->spaces[heap->to_space ^ 1];
+    arena_clear(to);
+
+    for (u32 idx = 0; idx < heap->root_count; ++idx) {
+        gc_forward_slot(from, to, (u8*)heap->roots[idx]);
+    }
+
+    // Objects between `scan` and the offset of the to-space were copied but not scanned yet.
+    usize scan = 0;
+    while (scan < to->offset) {
+        struct gc_header const* header = (struct gc_header const*)(to->buf + scan);
+        u8* const               object = to->buf + scan + sizeof(struct gc_header);
+        for (u32 idx = 0; idx < header->type->pointer_count; ++idx) {
+            gc_forward_slot(from, to, object + header->type->pointer_offsets[idx]);
+        }
+        scan += gc_object_footprint(header->type);
+    }
+
+    heap->copied_bytes += to->offset;
+    ++heap->collections;
+    arena_clear(from);
+    heap->to_space ^= 1;
+}
+
+/// Bump the to-space, if there is enough memory for the object.
+static u8* gc_bump(struct gc_heap* heap, struct gc_type const* type) {
+    struct arena* space     = &heap->spaces[heap->to_space];
+    usize const   footprint = gc_object_footprint(type);
+    if (footprint > space->capacity - space->offset) {
+        return NULL;
+    }
+
+    u8* const block = space->buf + space->offset;
+    space->offset += footprint;
+    memset(block, 0, footprint);
+    ((struct gc_header*)block)->type = type;
+    return block + sizeof(struct gc_header);
+}
+
+/// Apply the failure policy of the heap to an allocation that didn't fit after a collection.
+static u8* gc_alloc_failed(struct gc_heap* heap, struct gc_type const* type) {
+    for (u32 attempt = 0;; ++attempt) {
+        struct arena const*          space = &heap->spaces[heap->to_space];
+        struct alloha_oom_info const info  = {
+            .error     = ALLOHA_ERROR_OUT_OF_MEMORY,
+            .function  = "gc_alloc",
+            .allocator = heap,
+            .size      = gc_object_footprint(type),
+            .alignment = GC_ALIGNMENT,
+            .available = space->capacity - space->offset,
+        };
+        if (!alloha_oom_retry(heap->oom, &info, attempt)) {
+            return NULL;
+        }
+
+        gc_collect(heap);
+        u8* object = gc_bump(heap, type);
+        if (object) {
+            return object;
+        }
+    }
+}
+
+u8* gc_alloc(struct gc_heap* heap, struct gc_type const* type) {
+    assert(heap && type && "gc_alloc called with null heap or type");
+
+    alloha_sample_alloc(type->size);
+    u8* object = gc_bump(heap, type);
+    if (object) {
+        return object;
+    }
+
+    gc_collect(heap);
+    object = gc_bump(heap, type);
+    return object ? object : gc_alloc_failed(heap, type);
+}
+
+bool gc_add_root(struct gc_heap* heap, void* slot) {
+    assert(heap && slot && "gc_add_root called with null heap or slot");
+    if (heap->root_count == heap->max_roots) {
+        return false;
+    }
+    heap->roots[heap->root_count++] = slot;
+    return true;
+}
+
+void gc_remove_root(struct gc_heap* heap, void* slot) {
+    assert(heap && "gc_remove_root called with null heap");
+
+    // Roots are usually removed in the reverse order of their registration.
+    for (u32 idx = heap->root_count; idx > 0; --idx) {
+        if (heap->roots[idx - 1] == slot) {
+            heap->roots[idx - 1] = heap->roots[--heap->root_count];
+            return;
+        }
+    }
+    alloha_report_error(ALLOHA_ERROR_INVALID_BLOCK, "gc_remove_root");
+}
+
+struct gc_type const* gc_type_of(u8 const* object) {
+    return object ? gc_header_of(object)->type : NULL;
+}
+
+usize gc_used(struct gc_heap const* heap) {
+    return heap->spaces[heap->to_space].offset;
+}
@@ -0,0 +1,312 @@
+/// Work-stealing job system implementation.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/jobs.h>
+
+#include <alloha/arena.h>
+#include <alloha/core.h>
+#include <alloha/thread.h>
+#include <alloha/vmem.h>
+#include <assert.h>
+
+/// Failed searches for a job after which an idle worker sleeps rather than yields.
+#define JOB_SPIN_LIMIT 64
+
+/// Worker running on the calling thread.
+static ALLOHA_THREAD_LOCAL struct job_worker* job_tls_worker = NULL;
+
+void job_counter_init(struct job_counter* counter) {
+    assert(counter && "job_counter_init called with null counter");
+    atomic_init(&counter->pending, 0);
+}
+
+// -----------------------------------------------------------------------------
+// Chase-Lev deque.
+//
+// The owner pushes and pops at the bottom, thieves take from the top. The only race is for the
+// last job of the deque, settled by a compare-and-swap of the top. Both sides use sequentially
+// consistent accesses in that race, rather than the standalone fences of the original algorithm,
+// which ThreadSanitizer doesn't model.
+// -----------------------------------------------------------------------------
+
+static bool job_deque_push(struct job_deque* deque, struct job* job) {
+    i64 const bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    i64 const top    = atomic_load_explicit(&deque->top, memory_order_acquire);
+    if (bottom - top > (i64)deque->mask) {
+        return false;
+    }
+
+    atomic_store_explicit(&deque->slots[bottom & deque->mask], (uptr)job, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_release);
+    return true;
+}
+
+static struct job* job_deque_pop(struct job_deque* deque) {
+    i64 const bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_seq_cst);
+    ALLOHA_SCHED_POINT();
+    i64 top = atomic_load_explicit(&deque->top, memory_order_seq_cst);
+    if (top > bottom) {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_release);
+        return NULL;
+    }
+
+    atomic_uintptr_t* slot = &deque->slots[bottom & deque->mask];
+    struct job*       job  = (struct job*)atomic_load_explicit(slot, memory_order_relaxed);
+    if (top == bottom) {
+        // Last job, a thief may be taking it as well.
+        if (!atomic_compare_exchange_strong_explicit(
+                &deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed)) {
+            job = NULL;
+        }
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_release);
+    }
+    return job;
+}
+
+static struct job* job_deque_steal(struct job_deque* deque) {
+    i64 top = atomic_load_explicit(&deque->top, memory_order_seq_cst);
+    ALLOHA_SCHED_POINT();
+    i64 const bottom = atomic_load_explicit(&deque->bottom, memory_order_seq_cst);
+    if (top >= bottom) {
+        return NULL;
+    }
+
+    atomic_uintptr_t* slot = &deque->slots[top & deque->mask];
+    struct job*       job  = (struct job*)atomic_load_explicit(slot, memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(
+            &deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed)) {
+        return NULL;  // Lost the race to the owner or to another thief.
+    }
+    return job;
+}
+
+// -----------------------------------------------------------------------------
+// Workers.
+// -----------------------------------------------------------------------------
+
+static struct job* job_queue_take(struct job_system* system) {
+    if (atomic_load_explicit(&system->queued, memory_order_relaxed) == 0) {
+        return NULL;
+    }
+
+    alloha_mutex_lock(&system->mutex);
+    struct job* job = system->queue_head;
+    if (job) {
+        system->queue_head = job->next;
+        if (!system->queue_head) {
+            system->queue_tail = NULL;
+        }
+        atomic_fetch_sub_explicit(&system->queued, 1, memory_order_relaxed);
+    }
+    alloha_mutex_unlock(&system->mutex);
+    return job;
+}
+
+/// Find a job for the worker: from its own deque, then from the shared queue, then from the deque
+/// of another worker.
+static struct job* job_find(struct job_worker* worker) {
+    struct job* job = job_deque_pop(&worker->deque);
+    if (job) {
+        return job;
+    }
+    job = job_queue_take(worker->system);
+    if (job) {
+        return job;
+    }
+
+    // Visit every other worker, starting from a random one.
+    u32 const count = worker->system->config.worker_count;
+    worker->rng ^= worker->rng << 13;
+    worker->rng ^= worker->rng >> 7;
+    worker->rng ^= worker->rng << 17;
+    u32 const start = (u32)(worker->rng % count);
+    for (u32 i = 0; i < count; ++i) {
+        u32 const victim = (start + i) % count;
+        if (victim == worker->index) {
+            continue;
+        }
+        job = job_deque_steal(&worker->system->workers[victim].deque);
+        if (job) {
+            ++worker->stolen;
+            return job;
+        }
+    }
+    return NULL;
+}
+
+/// Run a job over the scratch arena of the worker, rolling it back afterwards.
+static void job_run(struct job_worker* worker, struct job* job) {
+    // The job may be released as soon as its counter is decremented.
+    struct job_counter* counter = job->counter;
+
+    struct scratch_arena scratch = scratch_arena_start(&worker->scratch.arena);
+    job->fn(job->arg, &worker->scratch.arena);
+    scratch_arena_end(&scratch);
+
+    ++worker->executed;
+    if (counter) {
+        atomic_fetch_sub_explicit(&counter->pending, 1, memory_order_release);
+    }
+}
+
+static int job_worker_run(void* arg) {
+    struct job_worker* worker = (struct job_worker*)arg;
+    struct job_system* system = worker->system;
+    job_tls_worker            = worker;
+
+    u32 idle = 0;
+    while (atomic_load_explicit(&system->running, memory_order_acquire)) {
+        struct job* job = job_find(worker);
+        if (job) {
+            job_run(worker, job);
+            idle = 0;
+        } else if (++idle < JOB_SPIN_LIMIT) {
+            alloha_thread_yield();
+        } else {
+            alloha_thread_sleep(1);
+        }
+    }
+
+    job_tls_worker = NULL;
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+// Job system.
+// -----------------------------------------------------------------------------
+
+/// Size, in bytes, of the memory holding the workers and the slots of their deques.
+static usize job_system_memory_size(struct job_config const* config) {
+    usize const workers_size = config->worker_count * sizeof(struct job_worker);
+    usize const slots_size   = (usize)config->deque_capacity * sizeof(atomic_uintptr_t);
+    return workers_size + config->worker_count * slots_size;
+}
+
+/// Stop and join the first `started` workers, and release the scratch arenas of the first `count`.
+static void job_system_stop_workers(struct job_system* system, u32 started, u32 count) {
+    atomic_store_explicit(&system->running, false, memory_order_release);
+    for (u32 idx = 0; idx < started; ++idx) {
+        alloha_discard(alloha_thread_join(&system->workers[idx].thread));
+    }
+    for (u32 idx = 0; idx < count; ++idx) {
+        vm_arena_destroy(&system->workers[idx].scratch);
+    }
+}
+
+bool job_system_create(struct job_system* system, struct job_config config) {
+    assert(system && "job_system_create called with null system");
+
+    config.worker_count = alloha_max(config.worker_count, 1);
+    if (config.deque_capacity == 0) {
+        config.deque_capacity = JOB_DEQUE_DEFAULT_CAPACITY;
+    }
+    u32 capacity = 1;
+    while (capacity < config.deque_capacity) {
+        capacity <<= 1;
+    }
+    config.deque_capacity = capacity;
+    if (config.scratch_capacity == 0) {
+        config.scratch_capacity = JOB_SCRATCH_DEFAULT_CAPACITY;
+    }
+
+    *system         = (struct job_system){0};
+    system->config  = config;
+    system->workers = (struct job_worker*)vmem_alloc(job_system_memory_size(&config), VMEM_DEFAULT);
+    if (!system->workers) {
+        return false;
+    }
+    alloha_mutex_init(&system->mutex);
+    atomic_init(&system->queued, 0);
+    atomic_init(&system->running, true);
+
+    atomic_uintptr_t* slots = (atomic_uintptr_t*)(system->workers + config.worker_count);
+    for (u32 idx = 0; idx < config.worker_count; ++idx) {
+        struct job_worker* worker = &system->workers[idx];
+        worker->system            = system;
+        worker->index             = idx;
+        worker->rng               = 0x9E3779B97F4A7C15ull * (idx + 1);
+        worker->deque.slots       = slots + (usize)idx * config.deque_capacity;
+        worker->deque.mask        = config.deque_capacity - 1;
+        atomic_init(&worker->deque.top, 0);
+        atomic_init(&worker->deque.bottom, 0);
+
+        if (!vm_arena_create(&worker->scratch, config.scratch_capacity, VM_ARENA_DEFAULT)) {
+            job_system_stop_workers(system, 0, idx);
+            job_system_destroy(system);
+            return false;
+        }
+    }
+
+    for (u32 idx = 0; idx < config.worker_count; ++idx) {
+        struct job_worker* worker = &system->workers[idx];
+        if (!alloha_thread_create(&worker->thread, job_worker_run, worker)) {
+            job_system_stop_workers(system, idx, config.worker_count);
+            job_system_destroy(system);
+            return false;
+        }
+    }
+    return true;
+}
+
+void job_system_destroy(struct job_system* system) {
+    if (!system || !system->workers) {
+        return;
+    }
+
+    if (atomic_load_explicit(&system->running, memory_order_acquire)) {
+        job_system_stop_workers(system, system->config.worker_count, system->config.worker_count);
+    }
+    assert(!system->queue_head && "job_system_destroy called with jobs still queued");
+
+    alloha_mutex_destroy(&system->mutex);
+    vmem_free((u8*)system->workers, job_system_memory_size(&system->config));
+    *system = (struct job_system){0};
+}
+
+void job_submit(struct job_system* restrict system, struct job* restrict job) {
+    assert(system && job && job->fn && "job_submit called with null system or job");
+
+    if (job->counter) {
+        atomic_fetch_add_explicit(&job->counter->pending, 1, memory_order_relaxed);
+    }
+
+    struct job_worker* worker = job_tls_worker;
+    if (worker && worker->system == system) {
+        if (!job_deque_push(&worker->deque, job)) {
+            job_run(worker, job);
+        }
+        return;
+    }
+
+    job->next = NULL;
+    alloha_mutex_lock(&system->mutex);
+    if (system->queue_tail) {
+        system->queue_tail->next = job;
+    } else {
+        system->queue_head = job;
+    }
+    system->queue_tail = job;
+    atomic_fetch_add_explicit(&system->queued, 1, memory_order_relaxed);
+    alloha_mutex_unlock(&system->mutex);
+}
+
+void job_wait(struct job_system* restrict system, struct job_counter* restrict counter) {
+    assert(system && counter && "job_wait called with null system or counter");
+
+    struct job_worker* worker = job_tls_worker;
+    bool const         helps  = worker && worker->system == system;
+    while (atomic_load_explicit(&counter->pending, memory_order_acquire) != 0) {
+        struct job* job = helps ? job_find(worker) : NULL;
+        if (job) {
+            job_run(worker, job);
+        } else {
+            alloha_thread_yield();
+        }
+    }
+}
+
+struct job_worker* job_current_worker(void) {
+    return job_tls_worker;
+}
@@ -0,0 +1,484 @@
+/// Object lifetime profiler implementation.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/lifetime.h>
+
+#include <alloha/core.h>
+#include <alloha/recycle_arena.h>
+#include <alloha/thread.h>
+#include <alloha/vmem.h>
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#    define WIN32_LEAN_AND_MEAN
+#    include <windows.h>
+#else
+#    include <time.h>
+#endif
+
+#define LIFETIME_NONE ((u32)-1)
+
+/// Largest block recycled by the free lists of a recycling arena.
+#define LIFETIME_RECYCLE_MAX_SIZE (RECYCLE_ARENA_MIN_SIZE << (RECYCLE_ARENA_BUCKET_COUNT - 1))
+
+/// Live object tracked by the profiler.
+struct lifetime_object {
+    void const* block;
+    usize       size;
+    u64         birth_clock;  ///< Allocations recorded before the object, from any site.
+    u64         birth_ns;
+    u32         site;
+
+    /// Neighbours among the live objects of the site, in the order of their allocation. Free
+    /// objects are linked via `next`.
+    u32 prev;
+    u32 next;
+};
+
+/// Slot of the table indexing the live objects by their blocks, empty if `block` is null.
+struct lifetime_slot {
+    void const* block;
+    u32         object;
+};
+
+struct lifetime_site {
+    struct alloha_lifetime_site stats;
+    u32                         oldest;  ///< Least recently allocated live object.
+    u32                         newest;  ///< Most recently allocated live object.
+};
+
+/// Profile shared by every thread, accessed under `lock` while the profiler is running.
+static struct {
+    atomic_flag                  lock;
+    atomic_bool                  running;
+    u8*                          memory;
+    usize                        memory_size;
+    struct lifetime_object*      objects;
+    u32                          free_object;
+    struct lifetime_slot*        slots;
+    u32                          slot_mask;
+    struct lifetime_site*        sites;
+    u32*                         site_slots;  ///< Indices of the sites plus one, zero if empty.
+    u32                          site_slot_mask;
+    u32                          max_sites;
+    u64                          clock;
+    struct alloha_lifetime_stats stats;
+} alloha_lifetimes = {.lock = ATOMIC_FLAG_INIT};
+
+static void lifetime_lock(void) {
+    while (atomic_flag_test_and_set_explicit(&alloha_lifetimes.lock, memory_order_acquire)) {
+        alloha_thread_yield();
+    }
+}
+
+static void lifetime_unlock(void) {
+    atomic_flag_clear_explicit(&alloha_lifetimes.lock, memory_order_release);
+}
+
+static u64 lifetime_now_ns(void) {
+#if defined(_WIN32)
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (u64)((f64)counter.QuadPart * 1e9 / (f64)frequency.QuadPart);
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u64)now.tv_sec * 1000000000 + (u64)now.tv_nsec;
+#endif
+}
+
+static u32 lifetime_hash(void const* ptr) {
+    return (u32)(((u64)(uptr)ptr * 0x9e3779b97f4a7c15u) >> 32);
+}
+
+/// FNV-1a hash of the contents of a site name.
+static u32 lifetime_name_hash(char const* name) {
+    u32 hash = 2166136261u;
+    for (; *name; ++name) {
+        hash = (hash ^ (u8)*name) * 16777619u;
+    }
+    return hash;
+}
+
+/// Smallest power of two holding at least twice `count` entries, keeping tables at most half full.
+static u32 lifetime_table_capacity(u32 count) {
+    u32 capacity = 2;
+    while (capacity < 2 * count) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+// -----------------------------------------------------------------------------
+// Tables. Should be accessed under the lock.
+// -----------------------------------------------------------------------------
+
+/// Index of the site named `name`, registering it if needed, or `LIFETIME_NONE` if full.
+///
+/// Names are compared by contents, since equal literals aren't guaranteed to share an address.
+static u32 lifetime_site_of(char const* name) {
+    u32 const mask = alloha_lifetimes.site_slot_mask;
+    for (u32 idx = lifetime_name_hash(name) & mask;; idx = (idx + 1) & mask) {
+        u32 const   site  = alloha_lifetimes.site_slots[idx];
+        char const* other = site != 0 ? alloha_lifetimes.sites[site - 1].stats.name : NULL;
+        if (other && (other == name || strcmp(other, name) == 0)) {
+            return site - 1;
+        }
+        if (site == 0) {
+            if (alloha_lifetimes.stats.sites == alloha_lifetimes.max_sites) {
+                return LIFETIME_NONE;
+            }
+
+            u32 const             new_site = alloha_lifetimes.stats.sites++;
+            struct lifetime_site* entry    = &alloha_lifetimes.sites[new_site];
+            *entry = (struct lifetime_site){
+                .stats  = {.name = name, .min_size = (usize)-1},
+                .oldest = LIFETIME_NONE,
+                .newest = LIFETIME_NONE,
+            };
+            alloha_lifetimes.site_slots[idx] = new_site + 1;
+            return new_site;
+        }
+    }
+}
+
+/// Slot of the live object of `block`, or of the empty slot where it would be inserted.
+static u32 lifetime_slot_of(void const* block) {
+    u32 const mask = alloha_lifetimes.slot_mask;
+    u32       idx  = lifetime_hash(block) & mask;
+    while (alloha_lifetimes.slots[idx].block && alloha_lifetimes.slots[idx].block != block) {
+        idx = (idx + 1) & mask;
+    }
+    return idx;
+}
+
+/// Empty a slot, shifting back the following slots of its probe sequence.
+static void lifetime_slot_remove(u32 idx) {
+    u32 const             mask  = alloha_lifetimes.slot_mask;
+    struct lifetime_slot* slots = alloha_lifetimes.slots;
+    for (u32 next = (idx + 1) & mask; slots[next].block; next = (next + 1) & mask) {
+        // Entries whose home lies cyclically in (idx, next] stay where they are.
+        u32 const  home  = lifetime_hash(slots[next].block) & mask;
+        bool const stays = idx <= next ? (idx < home && home <= next)
+                                       : (idx < home || home <= next);
+        if (!stays) {
+            slots[idx] = slots[next];
+            idx        = next;
+        }
+    }
+    slots[idx].block = NULL;
+}
+
+/// Unlink a live object from its site, and release it.
+static void lifetime_object_release(u32 object) {
+    struct lifetime_object* entry = &alloha_lifetimes.objects[object];
+    struct lifetime_site*   site  = &alloha_lifetimes.sites[entry->site];
+    if (entry->prev != LIFETIME_NONE) {
+        alloha_lifetimes.objects[entry->prev].next = entry->next;
+    } else {
+        site->oldest = entry->next;
+    }
+    if (entry->next != LIFETIME_NONE) {
+        alloha_lifetimes.objects[entry->next].prev = entry->prev;
+    } else {
+        site->newest = entry->prev;
+    }
+    --site->stats.live;
+    --alloha_lifetimes.stats.live;
+
+    entry->block                 = NULL;
+    entry->next                  = alloha_lifetimes.free_object;
+    alloha_lifetimes.free_object = object;
+}
+
+// -----------------------------------------------------------------------------
+// Hooks.
+// -----------------------------------------------------------------------------
+
+static void lifetime_record_alloc(char const* name, void const* block, usize size) {
+    u64 const clock = alloha_lifetimes.clock++;
+
+    // A block allocated again without its release being recorded is forgotten.
+    u32 slot = lifetime_slot_of(block);
+    if (alloha_lifetimes.slots[slot].block) {
+        lifetime_object_release(alloha_lifetimes.slots[slot].object);
+        lifetime_slot_remove(slot);
+        slot = lifetime_slot_of(block);
+    }
+
+    u32 const site   = lifetime_site_of(name);
+    u32 const object = alloha_lifetimes.free_object;
+    if (site == LIFETIME_NONE || object == LIFETIME_NONE) {
+        ++alloha_lifetimes.stats.dropped_allocs;
+        return;
+    }
+
+    struct lifetime_site*   site_entry = &alloha_lifetimes.sites[site];
+    struct lifetime_object* entry      = &alloha_lifetimes.objects[object];
+    alloha_lifetimes.free_object       = entry->next;
+
+    *entry = (struct lifetime_object){
+        .block       = block,
+        .size        = size,
+        .birth_clock = clock,
+        .birth_ns    = lifetime_now_ns(),
+        .site        = site,
+        .prev        = site_entry->newest,
+        .next        = LIFETIME_NONE,
+    };
+    if (site_entry->newest != LIFETIME_NONE) {
+        alloha_lifetimes.objects[site_entry->newest].next = object;
+    } else {
+        site_entry->oldest = object;
+    }
+    site_entry->newest                  = object;
+    alloha_lifetimes.slots[slot].block  = block;
+    alloha_lifetimes.slots[slot].object = object;
+
+    struct alloha_lifetime_site* stats = &site_entry->stats;
+    ++stats->allocs;
+    ++stats->live;
+    ++alloha_lifetimes.stats.live;
+    stats->min_size = alloha_min(stats->min_size, size);
+    stats->max_size = alloha_max(stats->max_size, size);
+    stats->total_size += size;
+    stats->free_run = 0;
+}
+
+static void lifetime_record_free(void const* block) {
+    u32 const slot = lifetime_slot_of(block);
+    if (!alloha_lifetimes.slots[slot].block) {
+        ++alloha_lifetimes.stats.untracked_frees;
+        return;
+    }
+
+    u32 const                    object = alloha_lifetimes.slots[slot].object;
+    struct lifetime_object const entry  = alloha_lifetimes.objects[object];
+    struct lifetime_site*        site   = &alloha_lifetimes.sites[entry.site];
+    struct alloha_lifetime_site* stats  = &site->stats;
+    stats->lifetime_allocs += alloha_lifetimes.clock - entry.birth_clock;
+    stats->lifetime_ns += lifetime_now_ns() - entry.birth_ns;
+    stats->lifo_frees += site->newest == object ? 1 : 0;
+    stats->fifo_frees += site->oldest == object ? 1 : 0;
+    ++stats->frees;
+    ++stats->free_run;
+
+    lifetime_object_release(object);
+    lifetime_slot_remove(slot);
+
+    // The run of releases since the last allocation of the site emptied it.
+    if (stats->live == 0 && stats->free_run >= 2) {
+        stats->batch_frees += stats->free_run;
+    }
+}
+
+void alloha_lifetime_on_alloc(char const* site, void* block, usize size) {
+    assert(site && "alloha_lifetime_on_alloc called with null site");
+    if (!block || !atomic_load_explicit(&alloha_lifetimes.running, memory_order_relaxed)) {
+        return;
+    }
+
+    lifetime_lock();
+    if (atomic_load_explicit(&alloha_lifetimes.running, memory_order_relaxed)) {
+        lifetime_record_alloc(site, block, size);
+    }
+    lifetime_unlock();
+}
+
+void alloha_lifetime_on_free(void const* block) {
+    if (!block || !atomic_load_explicit(&alloha_lifetimes.running, memory_order_relaxed)) {
+        return;
+    }
+
+    lifetime_lock();
+    if (atomic_load_explicit(&alloha_lifetimes.running, memory_order_relaxed)) {
+        lifetime_record_free(block);
+    }
+    lifetime_unlock();
+}
+
+void* alloha_lifetime_malloc(char const* site, usize size) {
+    void* block = malloc(size);
+    alloha_lifetime_on_alloc(site, block, size);
+    return block;
+}
+
+void alloha_lifetime_free(void* block) {
+    alloha_lifetime_on_free(block);
+    free(block);
+}
+
+// -----------------------------------------------------------------------------
+// Profiler.
+// -----------------------------------------------------------------------------
+
+bool alloha_lifetime_start(struct alloha_lifetime_config config) {
+    u32 const max_live =
+        config.max_live != 0 ? config.max_live : ALLOHA_LIFETIME_DEFAULT_MAX_LIVE;
+    u32 const max_sites =
+        config.max_sites != 0 ? config.max_sites : ALLOHA_LIFETIME_DEFAULT_MAX_SITES;
+
+    // Every table is laid out in a single mapping.
+    u32 const   slot_count        = lifetime_table_capacity(max_live);
+    u32 const   site_slot_count   = lifetime_table_capacity(max_sites);
+    usize const slots_offset      = (usize)max_live * sizeof(struct lifetime_object);
+    usize const sites_offset      = slots_offset + (usize)slot_count * sizeof(struct lifetime_slot);
+    usize const site_slots_offset = sites_offset + (usize)max_sites * sizeof(struct lifetime_site);
+    usize const memory_size       = site_slots_offset + (usize)site_slot_count * sizeof(u32);
+
+    lifetime_lock();
+    bool started = false;
+    if (!atomic_load_explicit(&alloha_lifetimes.running, memory_order_relaxed)) {
+        u8* memory = vmem_alloc(memory_size, VMEM_DEFAULT);
+        if (memory) {
+            // The memory is zeroed, so every slot starts empty.
+            alloha_lifetimes.memory         = memory;
+            alloha_lifetimes.memory_size    = memory_size;
+            alloha_lifetimes.objects        = (struct lifetime_object*)memory;
+            alloha_lifetimes.slots          = (struct lifetime_slot*)(memory + slots_offset);
+            alloha_lifetimes.slot_mask      = slot_count - 1;
+            alloha_lifetimes.sites          = (struct lifetime_site*)(memory + sites_offset);
+            alloha_lifetimes.site_slots     = (u32*)(memory + site_slots_offset);
+            alloha_lifetimes.site_slot_mask = site_slot_count - 1;
+            alloha_lifetimes.max_sites      = max_sites;
+            alloha_lifetimes.clock          = 0;
+            alloha_lifetimes.stats          = (struct alloha_lifetime_stats){0};
+
+            for (u32 idx = 0; idx < max_live; ++idx) {
+                alloha_lifetimes.objects[idx].next = idx + 1 < max_live ? idx + 1 : LIFETIME_NONE;
+            }
+            alloha_lifetimes.free_object = 0;
+
+            atomic_store_explicit(&alloha_lifetimes.running, true, memory_order_relaxed);
+            started = true;
+        }
+    }
+    lifetime_unlock();
+    return started;
+}
+
+void alloha_lifetime_stop(void) {
+    lifetime_lock();
+    if (atomic_load_explicit(&alloha_lifetimes.running, memory_order_relaxed)) {
+        atomic_store_explicit(&alloha_lifetimes.running, false, memory_order_relaxed);
+        vmem_free(alloha_lifetimes.memory, alloha_lifetimes.memory_size);
+        alloha_lifetimes.memory = NULL;
+        alloha_lifetimes.stats  = (struct alloha_lifetime_stats){0};
+    }
+    lifetime_unlock();
+}
+
+u32 alloha_lifetime_sites(struct alloha_lifetime_site* sites, u32 max_sites) {
+    lifetime_lock();
+    u32 const count = alloha_lifetimes.stats.sites;
+    for (u32 idx = 0; idx < alloha_min(count, max_sites); ++idx) {
+        sites[idx] = alloha_lifetimes.sites[idx].stats;
+    }
+    lifetime_unlock();
+    return count;
+}
+
+struct alloha_lifetime_stats alloha_lifetime_stats(void) {
+    lifetime_lock();
+    struct alloha_lifetime_stats const stats = alloha_lifetimes.stats;
+    lifetime_unlock();
+    return stats;
+}
+
+// -----------------------------------------------------------------------------
+// Classification.
+// -----------------------------------------------------------------------------
+
+/// Whether `part` is at least `ALLOHA_LIFETIME_PATTERN_THRESHOLD` percent of `whole`.
+static bool lifetime_mostly(u64 part, u64 whole) {
+    return part * 100 >= whole * ALLOHA_LIFETIME_PATTERN_THRESHOLD;
+}
+
+enum alloha_lifetime_pattern alloha_lifetime_pattern_of(struct alloha_lifetime_site const* site) {
+    assert(site && "alloha_lifetime_pattern_of called with null site");
+
+    // Sites releasing only a few of their objects keep the rest for the whole profile.
+    if (site->frees * 100 < site->allocs * (100 - ALLOHA_LIFETIME_PATTERN_THRESHOLD)) {
+        return ALLOHA_LIFETIME_LONG_LIVED;
+    }
+    if (lifetime_mostly(site->lifo_frees, site->frees)) {
+        return ALLOHA_LIFETIME_LIFO;
+    }
+    if (lifetime_mostly(site->batch_frees, site->frees)) {
+        return ALLOHA_LIFETIME_BATCH;
+    }
+    if (lifetime_mostly(site->fifo_frees, site->frees)) {
+        return ALLOHA_LIFETIME_FIFO;
+    }
+    return ALLOHA_LIFETIME_RANDOM;
+}
+
+char const* alloha_lifetime_recommend(struct alloha_lifetime_site const* site) {
+    switch (alloha_lifetime_pattern_of(site)) {
+        case ALLOHA_LIFETIME_LIFO:       return "stack";
+        case ALLOHA_LIFETIME_BATCH:      return "arena";
+        case ALLOHA_LIFETIME_LONG_LIVED: return "arena";
+        case ALLOHA_LIFETIME_FIFO:
+        case ALLOHA_LIFETIME_RANDOM:
+            return site->max_size <= LIFETIME_RECYCLE_MAX_SIZE ? "recycle_arena" : "malloc";
+    }
+    return "malloc";
+}
+
+static char const* lifetime_pattern_name(enum alloha_lifetime_pattern pattern) {
+    switch (pattern) {
+        case ALLOHA_LIFETIME_LIFO:       return "lifo";
+        case ALLOHA_LIFETIME_BATCH:      return "batch";
+        case ALLOHA_LIFETIME_FIFO:       return "fifo";
+        case ALLOHA_LIFETIME_RANDOM:     return "random";
+        case ALLOHA_LIFETIME_LONG_LIVED: return "long-lived";
+    }
+    return "unknown";
+}
+
+bool alloha_lifetime_report(FILE* out) {
+    assert(out && "alloha_lifetime_report called with null output");
+
+    lifetime_lock();
+    bool ok = atomic_load_explicit(&alloha_lifetimes.running, memory_order_relaxed);
+    if (ok) {
+        ok = fprintf(
+                 out,
+                 "%-10s %-13s %10s %10s %10s %10s %10s %12s %12s  %s\n",
+                 "pattern",
+                 "allocator",
+                 "allocs",
+                 "frees",
+                 "live",
+                 "avg size",
+                 "max size",
+                 "life allocs",
+                 "life us",
+                 "site") > 0;
+    }
+    for (u32 idx = 0; ok && idx < alloha_lifetimes.stats.sites; ++idx) {
+        struct alloha_lifetime_site const* site  = &alloha_lifetimes.sites[idx].stats;
+        u64 const                          frees = alloha_max(site->frees, 1);
+        ok = fprintf(
+                 out,
+                 "%-10s %-13s %10llu %10llu %10llu %10llu %10zu %12llu %12.1f  %s\n",
+                 lifetime_pattern_name(alloha_lifetime_pattern_of(site)),
+                 alloha_lifetime_recommend(site),
+                 (unsigned long long)site->allocs,
+                 (unsigned long long)site->frees,
+                 (unsigned long long)site->live,
+                 (unsigned long long)(site->total_size / alloha_max(site->allocs, 1)),
+                 site->max_size,
+                 (unsigned long long)(site->lifetime_allocs / frees),
+                 (f64)site->lifetime_ns / (f64)frees / 1000.0,
+                 site->name) > 0;
+    }
+    lifetime_unlock();
+    return ok && fflush(out) == 0;
+}
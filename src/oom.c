@@ -0,0 +1,104 @@
+/// Allocation failure handling implementation.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/oom.h>
+
+#include <alloha/core.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static _Thread_local enum alloha_error alloha_error_code = ALLOHA_OK;
+static atomic_uint_least64_t           alloha_failures   = 0;
+
+static char const* alloha_error_description(enum alloha_error error) {
+    switch (error) {
+        case ALLOHA_OK:                  return "no error";
+        case ALLOHA_ERROR_OUT_OF_MEMORY: return "out of memory";
+        case ALLOHA_ERROR_INVALID_BLOCK: return "invalid memory block";
+    }
+    return "unknown error";
+}
+
+/// Count the failure, reporting it only when the count reaches a power of two.
+static void alloha_count_failure(struct alloha_oom_info const* info, bool quiet) {
+    u64 const count = atomic_fetch_add_explicit(&alloha_failures, 1, memory_order_relaxed) + 1;
+    if (quiet || !alloha_is_power_of_two(count)) {
+        return;
+    }
+
+    if (info->error == ALLOHA_ERROR_OUT_OF_MEMORY) {
+        fprintf(
+            stderr,
+            "%s unable to allocate %zu bytes of memory aligned to %u bytes, only %zu bytes "
+            "remaining (%llu allocator failures so far).\n",
+            info->function,
+            info->size,
+            info->alignment,
+            info->available,
+            (unsigned long long)count);
+    } else {
+        fprintf(
+            stderr,
+            "%s failed: %s (%llu allocator failures so far).\n",
+            info->function,
+            alloha_error_description(info->error),
+            (unsigned long long)count);
+    }
+}
+
+bool alloha_oom_retry(
+    struct alloha_oom_policy const* restrict policy,
+    struct alloha_oom_info const* restrict   info,
+    u32                                      attempt) {
+    alloha_error_code = info->error;
+
+    enum alloha_oom_action const action = policy ? policy->action : ALLOHA_OOM_RETURN_NULL;
+    bool const                   quiet  = policy ? policy->quiet : false;
+    switch (action) {
+        case ALLOHA_OOM_RETURN_NULL: {
+            break;
+        }
+        case ALLOHA_OOM_RETRY: {
+            if (policy->handler && attempt < ALLOHA_OOM_MAX_RETRIES &&
+                policy->handler(info, policy->user)) {
+                return true;
+            }
+            break;
+        }
+        case ALLOHA_OOM_ABORT: {
+            alloha_count_failure(info, true);
+            fprintf(
+                stderr,
+                "%s unable to allocate %zu bytes of memory aligned to %u bytes, only %zu bytes "
+                "remaining. Aborting.\n",
+                info->function,
+                info->size,
+                info->alignment,
+                info->available);
+            abort();
+        }
+    }
+
+    alloha_count_failure(info, quiet);
+    return false;
+}
+
+void alloha_report_error(enum alloha_error error, char const* function) {
+    alloha_error_code                 = error;
+    struct alloha_oom_info const info = {.error = error, .function = function};
+    alloha_count_failure(&info, false);
+}
+
+enum alloha_error alloha_last_error(void) {
+    return alloha_error_code;
+}
+
+void alloha_clear_error(void) {
+    alloha_error_code = ALLOHA_OK;
+}
+
+u64 alloha_failure_count(void) {
+    return atomic_load_explicit(&alloha_failures, memory_order_relaxed);
+}
@@ -0,0 +1,294 @@
+/// Memory pressure watcher implementation.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/pressure.h>
+
+#include <alloha/core.h>
+#include <alloha/scavenger.h>
+#include <alloha/thread.h>
+#include <assert.h>
+#include <stdio.h>
+
+#if defined(__linux__)
+#    include <errno.h>
+#    include <fcntl.h>
+#    include <poll.h>
+#    include <stdlib.h>
+#    include <string.h>
+#    include <time.h>
+#    include <unistd.h>
+#endif
+
+#define PRESSURE_DEFAULT_CGROUP_DIR  "/sys/fs/cgroup"
+#define PRESSURE_DEFAULT_PSI_TRIGGER "some 150000 1000000"
+
+static void pressure_watcher_reset(
+    struct pressure_watcher* watcher,
+    u32                      calm_ms,
+    struct scavenger*        scavenger,
+    pressure_callback        callback,
+    void*                    user) {
+    watcher->trigger_fd   = -1;
+    watcher->events       = 0;
+    watcher->current_fd   = -1;
+    watcher->high_fd      = -1;
+    watcher->high_percent = 0;
+    watcher->calm_ms      = calm_ms;
+    watcher->last_change  = 0;
+    watcher->scavenger    = scavenger;
+    watcher->callback     = callback;
+    watcher->user         = user;
+    atomic_init(&watcher->level, PRESSURE_NONE);
+    atomic_init(&watcher->running, false);
+}
+
+enum pressure_level pressure_watcher_level(struct pressure_watcher const* watcher) {
+    return (enum pressure_level)atomic_load_explicit(&watcher->level, memory_order_relaxed);
+}
+
+static int pressure_watcher_run(void* arg) {
+    struct pressure_watcher* watcher = (struct pressure_watcher*)arg;
+    while (atomic_load_explicit(&watcher->running, memory_order_acquire)) {
+        alloha_discard(pressure_watcher_poll(watcher, PRESSURE_POLL_INTERVAL_MS));
+    }
+    return 0;
+}
+
+bool pressure_watcher_start(struct pressure_watcher* watcher) {
+    assert(watcher && "pressure_watcher_start called with null watcher");
+    if (atomic_exchange_explicit(&watcher->running, true, memory_order_acq_rel)) {
+        return true;  // Already running.
+    }
+    if (!alloha_thread_create(&watcher->thread, pressure_watcher_run, watcher)) {
+        atomic_store_explicit(&watcher->running, false, memory_order_release);
+        return false;
+    }
+    return true;
+}
+
+#if defined(__linux__)
+
+static u64 pressure_now_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u64)now.tv_sec * 1000 + (u64)now.tv_nsec / 1000000;
+}
+
+static int pressure_open_in(char const* dir, char const* name, int flags) {
+    char path[512];
+    int  len = snprintf(path, sizeof(path), "%s/%s", dir, name);
+    if (len < 0 || (usize)len >= sizeof(path)) {
+        return -1;
+    }
+    return open(path, flags | O_CLOEXEC);
+}
+
+/// Read a cgroup memory value, where `max` means no limit.
+static bool pressure_read_value(int fd, u64* value) {
+    char          buf[32];
+    ssize_t const len = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (len <= 0) {
+        return false;
+    }
+    buf[len] = '\0';
+
+    if (strncmp(buf, "max", 3) == 0) {
+        *value = UINT64_MAX;
+        return true;
+    }
+    char* end = NULL;
+    *value    = (u64)strtoull(buf, &end, 10);
+    return end != buf;
+}
+
+static bool pressure_high_exceeded(struct pressure_watcher const* watcher) {
+    if (watcher->current_fd < 0 || watcher->high_fd < 0 || watcher->high_percent == 0) {
+        return false;
+    }
+
+    u64 current = 0;
+    u64 high    = 0;
+    if (!pressure_read_value(watcher->current_fd, &current) ||
+        !pressure_read_value(watcher->high_fd, &high) || high == UINT64_MAX) {
+        return false;
+    }
+    return current >= (high / 100) * watcher->high_percent;
+}
+
+bool pressure_watcher_open(
+    struct pressure_watcher* restrict      watcher,
+    struct pressure_config const* restrict config,
+    struct scavenger*                      scavenger,
+    pressure_callback                      callback,
+    void*                                  user) {
+    assert(watcher && config && "pressure_watcher_open called with null watcher or config");
+    pressure_watcher_reset(watcher, config->calm_ms, scavenger, callback, user);
+
+    char const* dir     = config->cgroup_dir ? config->cgroup_dir : PRESSURE_DEFAULT_CGROUP_DIR;
+    char const* trigger = config->psi_trigger ? config->psi_trigger : PRESSURE_DEFAULT_PSI_TRIGGER;
+
+    // The trigger is armed by writing it to the file, which then signals `POLLPRI` on each event.
+    int fd = pressure_open_in(dir, "memory.pressure", O_RDWR | O_NONBLOCK);
+    if (fd >= 0 && write(fd, trigger, strlen(trigger) + 1) < 0) {
+        fprintf(
+            stderr,
+            "pressure_watcher_open unable to arm the PSI trigger `%s` in %s: %s.\n",
+            trigger,
+            dir,
+            strerror(errno));
+        close(fd);
+        fd = -1;
+    }
+    watcher->trigger_fd = fd;
+    watcher->events     = POLLPRI;
+
+    if (config->high_percent != 0) {
+        watcher->high_percent = config->high_percent;
+        watcher->current_fd   = pressure_open_in(dir, "memory.current", O_RDONLY);
+        watcher->high_fd      = pressure_open_in(dir, "memory.high", O_RDONLY);
+    }
+
+    bool const watching_high = (watcher->current_fd >= 0 && watcher->high_fd >= 0);
+    if (watcher->trigger_fd < 0 && !watching_high) {
+        pressure_watcher_close(watcher);
+        return false;
+    }
+    return true;
+}
+
+void pressure_watcher_attach(
+    struct pressure_watcher* watcher,
+    int                      fd,
+    u32                      calm_ms,
+    struct scavenger*        scavenger,
+    pressure_callback        callback,
+    void*                    user) {
+    assert(watcher && fd >= 0 && "pressure_watcher_attach called with null watcher or bad fd");
+    pressure_watcher_reset(watcher, calm_ms, scavenger, callback, user);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    watcher->trigger_fd = fd;
+    watcher->events     = POLLIN;
+}
+
+void pressure_watcher_close(struct pressure_watcher* watcher) {
+    if (!watcher) {
+        return;
+    }
+    if (atomic_exchange_explicit(&watcher->running, false, memory_order_acq_rel)) {
+        alloha_discard(alloha_thread_join(&watcher->thread));
+    }
+
+    int* const fds[] = {&watcher->trigger_fd, &watcher->current_fd, &watcher->high_fd};
+    for (usize i = 0; i < sizeof(fds) / sizeof(fds[0]); ++i) {
+        if (*fds[i] >= 0) {
+            close(*fds[i]);
+            *fds[i] = -1;
+        }
+    }
+}
+
+/// Check whether the trigger signaled pressure, disabling it if it became unusable.
+static bool pressure_trigger_signaled(struct pressure_watcher* watcher, u32 timeout_ms) {
+    struct pollfd pfd = {.fd = watcher->trigger_fd, .events = watcher->events, .revents = 0};
+    int const     res = poll(&pfd, 1, (int)timeout_ms);
+    if (res <= 0) {
+        return false;
+    }
+
+    if (watcher->events & POLLIN) {
+        // Each batch of data counts as a single signal.
+        char    drain[64];
+        ssize_t len      = 0;
+        bool    has_data = false;
+        while ((len = read(watcher->trigger_fd, drain, sizeof(drain))) > 0) {
+            has_data = true;
+        }
+        if (len == 0) {
+            // The writing end was closed, polling would return immediately from now on.
+            close(watcher->trigger_fd);
+            watcher->trigger_fd = -1;
+        }
+        return has_data;
+    }
+
+    if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+        // The trigger is gone, polling would return immediately from now on.
+        close(watcher->trigger_fd);
+        watcher->trigger_fd = -1;
+        return false;
+    }
+    return (pfd.revents & watcher->events) != 0;
+}
+
+enum pressure_level pressure_watcher_poll(struct pressure_watcher* watcher, u32 timeout_ms) {
+    assert(watcher && "pressure_watcher_poll called with null watcher");
+
+    bool signaled = false;
+    if (watcher->trigger_fd >= 0) {
+        signaled = pressure_trigger_signaled(watcher, timeout_ms);
+    } else if (timeout_ms != 0) {
+        alloha_thread_sleep(timeout_ms);
+    }
+    signaled = pressure_high_exceeded(watcher) || signaled;
+
+    u64 const now      = pressure_now_ms();
+    u32 const previous = atomic_load_explicit(&watcher->level, memory_order_relaxed);
+    u32       level    = previous;
+    if (signaled) {
+        level                = alloha_min(previous + 1, (u32)PRESSURE_HIGH);
+        watcher->last_change = now;
+    } else if (previous != PRESSURE_NONE && now - watcher->last_change >= watcher->calm_ms) {
+        level                = previous - 1;
+        watcher->last_change = now;
+    }
+    atomic_store_explicit(&watcher->level, level, memory_order_relaxed);
+
+    if (watcher->scavenger && level != previous) {
+        scavenger_set_pressure(watcher->scavenger, (enum pressure_level)level);
+    }
+    if (watcher->scavenger && signaled) {
+        alloha_discard(scavenger_scan(watcher->scavenger));
+    }
+    if (watcher->callback && (signaled || level != previous)) {
+        watcher->callback((enum pressure_level)level, watcher->user);
+    }
+    return (enum pressure_level)level;
+}
+
+#else
+
+bool pressure_watcher_open(
+    struct pressure_watcher* restrict      watcher,
+    struct pressure_config const* restrict config,
+    struct scavenger*                      scavenger,
+    pressure_callback                      callback,
+    void*                                  user) {
+    assert(watcher && config && "pressure_watcher_open called with null watcher or config");
+    pressure_watcher_reset(watcher, config->calm_ms, scavenger, callback, user);
+    return false;  // PSI and cgroups are Linux only.
+}
+
+void pressure_watcher_attach(
+    struct pressure_watcher* watcher,
+    int                      fd,
+    u32                      calm_ms,
+    struct scavenger*        scavenger,
+    pressure_callback        callback,
+    void*                    user) {
+    alloha_discard(fd);
+    pressure_watcher_reset(watcher, calm_ms, scavenger, callback, user);
+}
+
+void pressure_watcher_close(struct pressure_watcher* watcher) {
+    if (watcher && atomic_exchange_explicit(&watcher->running, false, memory_order_acq_rel)) {
+        alloha_discard(alloha_thread_join(&watcher->thread));
+    }
+}
+
+enum pressure_level pressure_watcher_poll(struct pressure_watcher* watcher, u32 timeout_ms) {
+    alloha_thread_sleep(timeout_ms);
+    return pressure_watcher_level(watcher);
+}
+
+#endif
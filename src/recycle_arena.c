@@ -0,0 +1,105 @@
+/// Recycling arena allocator implementation.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/recycle_arena.h>
+
+#include <alloha/arena.h>
+#include <alloha/core.h>
+#include <alloha/sample.h>
+#include <assert.h>
+#include <string.h>
+
+#define RECYCLE_ARENA_MAX_SIZE (RECYCLE_ARENA_MIN_SIZE << (RECYCLE_ARENA_BUCKET_COUNT - 1))
+
+struct recycle_arena recycle_arena_new(usize capacity, u8* buf) {
+    return (struct recycle_arena){
+        .arena      = arena_new(capacity, buf),
+        .free_lists = {0},
+    };
+}
+
+void recycle_arena_init(struct recycle_arena* restrict arena, usize capacity, u8* restrict buf) {
+    if (!arena) {
+        return;
+    }
+    *arena = recycle_arena_new(capacity, buf);
+}
+
+/// Index of the smallest bucket holding blocks of `size` bytes, which should be at most
+/// `RECYCLE_ARENA_MAX_SIZE`.
+static u32 recycle_arena_bucket(usize size) {
+    u32   bucket      = 0;
+    usize bucket_size = RECYCLE_ARENA_MIN_SIZE;
+    while (bucket_size < size) {
+        bucket_size <<= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+/// Read the link to the next free block, which may be unaligned for a pointer.
+static u8* recycle_arena_next(u8 const* block) {
+    u8* next;
+    memcpy(&next, block, sizeof(next));
+    return next;
+}
+
+u8* recycle_arena_alloc_aligned(struct recycle_arena* arena, usize size, u32 alignment) {
+    if (!arena || size == 0) {
+        return NULL;
+    }
+    if (size > RECYCLE_ARENA_MAX_SIZE) {
+        return arena_alloc_aligned(&arena->arena, size, alignment);
+    }
+
+    u32 const bucket = recycle_arena_bucket(size);
+    u8*       head   = arena->free_lists[bucket];
+    if (head && ((uptr)head & ((uptr)alignment - 1)) == 0) {
+        alloha_sample_alloc(size);
+        arena->free_lists[bucket] = recycle_arena_next(head);
+        return head;
+    }
+
+    return arena_alloc_aligned(&arena->arena, (usize)RECYCLE_ARENA_MIN_SIZE << bucket, alignment);
+}
+
+u8* recycle_arena_alloc(struct recycle_arena* arena, usize size) {
+    return recycle_arena_alloc_aligned(arena, size, ALLOHA_DEFAULT_ALIGNMENT);
+}
+
+void recycle_arena_free(struct recycle_arena* restrict arena, u8* restrict block, usize size) {
+    if (!arena || !block || size == 0) {
+        return;
+    }
+
+    u8* const free_space = arena->arena.buf + arena->arena.offset;
+    if (block < arena->arena.buf || block >= free_space) {
+        alloha_report_error(ALLOHA_ERROR_INVALID_BLOCK, "recycle_arena_free");
+        return;
+    }
+
+    bool const  recycled   = size <= RECYCLE_ARENA_MAX_SIZE;
+    u32 const   bucket     = recycled ? recycle_arena_bucket(size) : 0;
+    usize const block_size = recycled ? (usize)RECYCLE_ARENA_MIN_SIZE << bucket : size;
+
+    // The last block goes straight back to the free space.
+    if (block + block_size == free_space) {
+        arena->arena.offset = (usize)(block - arena->arena.buf);
+        return;
+    }
+    if (!recycled) {
+        return;
+    }
+
+    memcpy(block, &arena->free_lists[bucket], sizeof(u8*));
+    arena->free_lists[bucket] = block;
+}
+
+void recycle_arena_clear(struct recycle_arena* arena) {
+    if (!arena) {
+        return;
+    }
+    arena_clear(&arena->arena);
+    memset(arena->free_lists, 0, sizeof(arena->free_lists));
+}
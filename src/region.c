@@ -0,0 +1,144 @@
+/// Reference-counted region implementation.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/region.h>
+
+#include <alloha/arena.h>
+#include <alloha/core.h>
+#include <alloha/oom.h>
+#include <alloha/vmem.h>
+#include <assert.h>
+
+/// Map a chunk of at least `size` bytes, including its header.
+static struct region_chunk* region_chunk_new(usize size) {
+    usize const          chunk_size = (usize)align_forward((uptr)size, (u32)vmem_page_size());
+    struct region_chunk* chunk      = (struct region_chunk*)vmem_alloc(chunk_size, VMEM_DEFAULT);
+    if (chunk) {
+        chunk->next = NULL;
+        chunk->size = chunk_size;
+    }
+    return chunk;
+}
+
+struct region* region_create(usize chunk_size) {
+    if (chunk_size == 0) {
+        chunk_size = REGION_DEFAULT_CHUNK_SIZE;
+    }
+    usize const headers = sizeof(struct region_chunk) + sizeof(struct region);
+    chunk_size          = (usize)align_forward((uptr)alloha_max(chunk_size, 2 * headers),
+                                      (u32)vmem_page_size());
+
+    struct region_chunk* chunk = region_chunk_new(chunk_size);
+    if (!chunk) {
+        return NULL;
+    }
+
+    // The region lives right after the header of its first chunk.
+    struct region* region = (struct region*)(chunk + 1);
+    region->arena         = arena_new(chunk->size - headers, (u8*)(region + 1));
+    region->chunks        = chunk;
+    region->chunk_size    = chunk_size;
+    region->mapped_bytes  = chunk->size;
+    region->oom           = NULL;
+    atomic_init(&region->refs, 1);
+    return region;
+}
+
+/// Bump the arena of the region, if there is enough memory left in the current chunk.
+static u8* region_bump(struct region* region, usize size, u32 alignment) {
+    struct arena* arena = &region->arena;
+    uptr const    start = align_forward((uptr)arena->buf + arena->offset, alignment);
+    if (start + size > (uptr)arena->buf + arena->capacity) {
+        return NULL;
+    }
+    return arena_alloc_aligned(arena, size, alignment);
+}
+
+/// Map a new chunk for the block, and make it the current one.
+static u8* region_grow(struct region* region, usize size, u32 alignment) {
+    usize const          needed = sizeof(struct region_chunk) + size + alignment;
+    struct region_chunk* chunk  = region_chunk_new(alloha_max(region->chunk_size, needed));
+    if (!chunk) {
+        return NULL;
+    }
+
+    chunk->next           = region->chunks;
+    region->chunks        = chunk;
+    region->mapped_bytes += chunk->size;
+    region->arena         = arena_new(chunk->size - sizeof(struct region_chunk), (u8*)(chunk + 1));
+    return arena_alloc_aligned(&region->arena, size, alignment);
+}
+
+/// Apply the failure policy of the region to a chunk that couldn't be mapped.
+static u8* region_alloc_failed(struct region* region, usize size, u32 alignment) {
+    for (u32 attempt = 0;; ++attempt) {
+        struct alloha_oom_info const info = {
+            .error     = ALLOHA_ERROR_OUT_OF_MEMORY,
+            .function  = "region_alloc_aligned",
+            .allocator = region,
+            .size      = size,
+            .alignment = alignment,
+            .available = region->arena.capacity - region->arena.offset,
+        };
+        if (!alloha_oom_retry(region->oom, &info, attempt)) {
+            return NULL;
+        }
+
+        u8* new_block = region_grow(region, size, alignment);
+        if (new_block) {
+            return new_block;
+        }
+    }
+}
+
+u8* region_alloc_aligned(struct region* region, usize size, u32 alignment) {
+    assert(alloha_is_power_of_two(alignment) && "region expected a power of two alignment");
+    if (!region || size == 0) {
+        return NULL;
+    }
+
+    u8* new_block = region_bump(region, size, alignment);
+    if (!new_block) {
+        new_block = region_grow(region, size, alignment);
+    }
+    return new_block ? new_block : region_alloc_failed(region, size, alignment);
+}
+
+u8* region_alloc(struct region* region, usize size) {
+    return region_alloc_aligned(region, size, ALLOHA_DEFAULT_ALIGNMENT);
+}
+
+struct region* region_retain(struct region* region) {
+    assert(region && "region_retain called with null region");
+    usize const previous = atomic_fetch_add_explicit(&region->refs, 1, memory_order_relaxed);
+    assert(previous != 0 && "region_retain called on a released region");
+    alloha_discard(previous);
+    return region;
+}
+
+bool region_release(struct region* region) {
+    if (!region) {
+        return false;
+    }
+
+    // Every access to the region made while holding a reference happens before the release.
+    usize const previous = atomic_fetch_sub_explicit(&region->refs, 1, memory_order_acq_rel);
+    assert(previous != 0 && "region_release called on a released region");
+    if (previous != 1) {
+        return false;
+    }
+
+    // The region lives in its oldest chunk, which is the last one to be unmapped.
+    struct region_chunk* chunk = region->chunks;
+    while (chunk) {
+        struct region_chunk* next = chunk->next;
+        vmem_free((u8*)chunk, chunk->size);
+        chunk = next;
+    }
+    return true;
+}
+
+usize region_ref_count(struct region const* region) {
+    return atomic_load_explicit(&region->refs, memory_order_relaxed);
+}
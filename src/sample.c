@@ -0,0 +1,377 @@
+/// Sampling heap profiler implementation.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/sample.h>
+
+#include <alloha/core.h>
+#include <alloha/thread.h>
+#include <alloha/vmem.h>
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#    include <windows.h>
+#elif defined(__has_include)
+#    if __has_include(<execinfo.h>)
+#        include <execinfo.h>
+#        define ALLOHA_SAMPLE_EXECINFO 1
+#    endif
+#endif
+
+ALLOHA_THREAD_LOCAL i64 alloha_sample_countdown = 0;
+
+/// Whether the countdown of the calling thread was drawn while the profiler was running.
+static ALLOHA_THREAD_LOCAL bool alloha_sample_armed = false;
+
+/// State of the random number generator of the calling thread, seeded on its first draw.
+static ALLOHA_THREAD_LOCAL u64 alloha_sample_rng = 0;
+
+/// Backtrace aggregating the samples taken from it.
+struct alloha_sample_stack {
+    u64   hash;  ///< Zero if the slot is free.
+    u64   count;
+    u64   bytes;
+    u64   estimated_bytes;  ///< Allocated bytes estimated from the samples.
+    u32   depth;
+    void* frames[ALLOHA_SAMPLE_MAX_DEPTH];
+};
+
+/// Profile shared by every thread, accessed under `lock` while the profiler is running.
+static struct {
+    atomic_flag                 lock;
+    atomic_bool                 running;
+    usize                       period;
+    struct alloha_sample_stack* stacks;
+    u32                         capacity;  ///< Amount of slots of `stacks`, a power of two.
+    u32                         max_stacks;
+    struct alloha_sample_stats  stats;
+} alloha_sampler = {.lock = ATOMIC_FLAG_INIT};
+
+static void alloha_sample_lock(void) {
+    while (atomic_flag_test_and_set_explicit(&alloha_sampler.lock, memory_order_acquire)) {
+        alloha_thread_yield();
+    }
+}
+
+static void alloha_sample_unlock(void) {
+    atomic_flag_clear_explicit(&alloha_sampler.lock, memory_order_release);
+}
+
+// -----------------------------------------------------------------------------
+// Sampling distances.
+//
+// The library doesn't link against the math library, hence the approximations below, which are
+// more than precise enough for drawing random distances.
+// -----------------------------------------------------------------------------
+
+#define ALLOHA_SAMPLE_LN2 0.69314718055994530942
+
+static u64 alloha_sample_next_random(void) {
+    if (alloha_sample_rng == 0) {
+        static atomic_uint_least64_t seed = 0x9e3779b97f4a7c15u;
+        alloha_sample_rng =
+            atomic_fetch_add_explicit(&seed, 0x9e3779b97f4a7c15u, memory_order_relaxed) ^
+            (u64)(uptr)&alloha_sample_rng;
+        alloha_sample_rng |= 1;
+    }
+
+    // xorshift64*.
+    alloha_sample_rng ^= alloha_sample_rng >> 12;
+    alloha_sample_rng ^= alloha_sample_rng << 25;
+    alloha_sample_rng ^= alloha_sample_rng >> 27;
+    return alloha_sample_rng * 0x2545f4914f6cdd1du;
+}
+
+/// Natural logarithm of `x`, for `x > 0`.
+static f64 alloha_sample_ln(f64 x) {
+    // Split `x` into `m * 2^e` with `m` in [1, 2), then ln(m) = 2 atanh((m - 1) / (m + 1)).
+    u64 bits;
+    memcpy(&bits, &x, sizeof(bits));
+    i64 const exponent = (i64)((bits >> 52) & 0x7ff) - 1023;
+    bits               = (bits & ~((u64)0x7ff << 52)) | ((u64)1023 << 52);
+    f64 mantissa;
+    memcpy(&mantissa, &bits, sizeof(mantissa));
+
+    f64 const z  = (mantissa - 1.0) / (mantissa + 1.0);
+    f64 const z2 = z * z;
+    f64 const ln = 2.0 * z * (1.0 + z2 * (1.0 / 3.0 + z2 * (1.0 / 5.0 + z2 * (1.0 / 7.0))));
+    return (f64)exponent * ALLOHA_SAMPLE_LN2 + ln;
+}
+
+/// Value of `e^(-x)`, for `x >= 0`.
+static f64 alloha_sample_exp_neg(f64 x) {
+    // e^(-x) = 2^(-k) e^(-t), with `t` in [0, ln 2).
+    f64 const y = x / ALLOHA_SAMPLE_LN2;
+    if (y >= 62.0) {
+        return 0.0;
+    }
+    u32 const k = (u32)y;
+    f64 const t = (y - (f64)k) * ALLOHA_SAMPLE_LN2;
+    f64 const e =
+        1.0 - t * (1.0 - t * (0.5 - t * (1.0 / 6.0 - t * (1.0 / 24.0 - t * (1.0 / 120.0)))));
+    return e / (f64)((u64)1 << k);
+}
+
+/// Draw the distance to the next sample from an exponential distribution of mean `period`.
+static i64 alloha_sample_distance(usize period) {
+    // Uniform in (0, 1], out of the 53 upper bits of a random number.
+    f64 const uniform  = ((f64)(alloha_sample_next_random() >> 11) + 1.0) / 9007199254740992.0;
+    f64 const distance = -alloha_sample_ln(uniform) * (f64)period;
+    return (i64)distance + 1;
+}
+
+// -----------------------------------------------------------------------------
+// Recording.
+// -----------------------------------------------------------------------------
+
+static u32 alloha_sample_backtrace(void** frames, u32 max_depth) {
+#if defined(_WIN32)
+    return (u32)CaptureStackBackTrace(1, (DWORD)max_depth, frames, NULL);
+#elif defined(ALLOHA_SAMPLE_EXECINFO)
+    // Skip this function.
+    void* all_frames[ALLOHA_SAMPLE_MAX_DEPTH + 1];
+    int const depth = backtrace(all_frames, (int)max_depth + 1);
+    if (depth <= 1) {
+        return 0;
+    }
+    memcpy(frames, all_frames + 1, (usize)(depth - 1) * sizeof(void*));
+    return (u32)(depth - 1);
+#elif defined(__GNUC__) || defined(__clang__)
+    frames[0] = __builtin_return_address(0);
+    return max_depth > 0 ? 1 : 0;
+#else
+    alloha_discard(frames);
+    alloha_discard(max_depth);
+    return 0;
+#endif
+}
+
+static u64 alloha_sample_hash(void* const* frames, u32 depth) {
+    u64 hash = 0xcbf29ce484222325u;
+    for (u32 idx = 0; idx < depth; ++idx) {
+        hash = (hash ^ (u64)(uptr)frames[idx]) * 0x100000001b3u;
+    }
+    return hash | 1;
+}
+
+/// Aggregate a sample into the slot of its backtrace. Should be called under the lock.
+static void alloha_sample_record(void* const* frames, u32 depth, usize size) {
+    u64 const hash = alloha_sample_hash(frames, depth);
+    u32 const mask = alloha_sampler.capacity - 1;
+    for (u32 probe = 0; probe < alloha_sampler.capacity; ++probe) {
+        struct alloha_sample_stack* stack = &alloha_sampler.stacks[(hash + probe) & mask];
+        if (stack->hash == 0) {
+            if (alloha_sampler.stats.stacks == alloha_sampler.max_stacks) {
+                break;
+            }
+            stack->hash  = hash;
+            stack->depth = depth;
+            memcpy(stack->frames, frames, depth * sizeof(void*));
+            ++alloha_sampler.stats.stacks;
+        } else if (
+            stack->hash != hash || stack->depth != depth ||
+            memcmp(stack->frames, frames, depth * sizeof(void*)) != 0) {
+            continue;
+        }
+
+        // Each sample of `size` bytes stands for `size / (1 - e^(-size / period))` bytes.
+        f64 const probability =
+            1.0 - alloha_sample_exp_neg((f64)size / (f64)alloha_sampler.period);
+        ++stack->count;
+        stack->bytes += size;
+        stack->estimated_bytes += (u64)((f64)size / probability);
+        ++alloha_sampler.stats.samples;
+        return;
+    }
+    ++alloha_sampler.stats.dropped;
+}
+
+void alloha_sample_slow(usize size) {
+    if (!atomic_load_explicit(&alloha_sampler.running, memory_order_relaxed)) {
+        alloha_sample_armed     = false;
+        alloha_sample_countdown = ALLOHA_SAMPLE_IDLE_BYTES;
+        return;
+    }
+
+    // A countdown that wasn't drawn from the distribution, such as the first one of the thread or
+    // one left from while the profiler was stopped, only arms the thread, so as not to bias the
+    // profile towards the allocations following those.
+    void* frames[ALLOHA_SAMPLE_MAX_DEPTH];
+    u32   depth = 0;
+    if (alloha_sample_armed) {
+        depth = alloha_sample_backtrace(frames, ALLOHA_SAMPLE_MAX_DEPTH);
+    }
+
+    alloha_sample_lock();
+    bool const  running = atomic_load_explicit(&alloha_sampler.running, memory_order_relaxed);
+    usize const period  = alloha_sampler.period;
+    if (running && alloha_sample_armed) {
+        alloha_sample_record(frames, depth, size);
+    }
+    alloha_sample_unlock();
+
+    alloha_sample_armed     = running;
+    alloha_sample_countdown = running ? alloha_sample_distance(period) : ALLOHA_SAMPLE_IDLE_BYTES;
+}
+
+bool alloha_sample_start(struct alloha_sample_config config) {
+    usize const period     = config.period != 0 ? config.period : ALLOHA_SAMPLE_DEFAULT_PERIOD;
+    u32 const   max_stacks =
+        config.max_stacks != 0 ? config.max_stacks : ALLOHA_SAMPLE_DEFAULT_MAX_STACKS;
+
+    // Keep the table at most half full, so that probe sequences stay short.
+    u32 capacity = 2;
+    while (capacity < 2 * max_stacks) {
+        capacity <<= 1;
+    }
+
+    // Load the unwinder up front, which may allocate on its first use.
+    void* frames[ALLOHA_SAMPLE_MAX_DEPTH];
+    alloha_discard(alloha_sample_backtrace(frames, ALLOHA_SAMPLE_MAX_DEPTH));
+
+    alloha_sample_lock();
+    bool started = false;
+    if (!atomic_load_explicit(&alloha_sampler.running, memory_order_relaxed)) {
+        alloha_sampler.stacks = (struct alloha_sample_stack*)vmem_alloc(
+            (usize)capacity * sizeof(struct alloha_sample_stack),
+            VMEM_DEFAULT);
+        if (alloha_sampler.stacks) {
+            alloha_sampler.period     = period;
+            alloha_sampler.capacity   = capacity;
+            alloha_sampler.max_stacks = max_stacks;
+            alloha_sampler.stats      = (struct alloha_sample_stats){0};
+            atomic_store_explicit(&alloha_sampler.running, true, memory_order_relaxed);
+            started = true;
+        }
+    }
+    alloha_sample_unlock();
+
+    // The calling thread starts sampling right away, others once their idle distance is consumed.
+    if (started) {
+        alloha_sample_armed     = true;
+        alloha_sample_countdown = alloha_sample_distance(period);
+    }
+    return started;
+}
+
+void alloha_sample_stop(void) {
+    alloha_sample_lock();
+    if (atomic_load_explicit(&alloha_sampler.running, memory_order_relaxed)) {
+        atomic_store_explicit(&alloha_sampler.running, false, memory_order_relaxed);
+        vmem_free(
+            (u8*)alloha_sampler.stacks,
+            (usize)alloha_sampler.capacity * sizeof(struct alloha_sample_stack));
+        alloha_sampler.stacks = NULL;
+        alloha_sampler.period = 0;
+        alloha_sampler.stats  = (struct alloha_sample_stats){0};
+    }
+    alloha_sample_unlock();
+}
+
+struct alloha_sample_stats alloha_sample_stats(void) {
+    alloha_sample_lock();
+    struct alloha_sample_stats const stats = alloha_sampler.stats;
+    alloha_sample_unlock();
+    return stats;
+}
+
+// -----------------------------------------------------------------------------
+// Profiles.
+// -----------------------------------------------------------------------------
+
+/// Append the memory mappings of the process, used by `pprof` to symbolize the addresses.
+static bool alloha_sample_write_mappings(FILE* out) {
+    if (fputs("\nMAPPED_LIBRARIES:\n", out) < 0) {
+        return false;
+    }
+#if defined(__linux__)
+    FILE* maps = fopen("/proc/self/maps", "r");
+    if (!maps) {
+        return true;
+    }
+    char line[512];
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), maps)) {
+        ok = fputs(line, out) >= 0;
+    }
+    fclose(maps);
+    return ok;
+#else
+    return true;
+#endif
+}
+
+static bool alloha_sample_write_pprof(FILE* out) {
+    u64 total_count = 0;
+    u64 total_bytes = 0;
+    for (u32 idx = 0; idx < alloha_sampler.capacity; ++idx) {
+        total_count += alloha_sampler.stacks[idx].count;
+        total_bytes += alloha_sampler.stacks[idx].bytes;
+    }
+
+    // Arenas release their blocks all at once, so every sampled block counts as in use.
+    bool ok = fprintf(
+                  out,
+                  "heap profile: %llu: %llu [%llu: %llu] @ heap_v2/%llu\n",
+                  (unsigned long long)total_count,
+                  (unsigned long long)total_bytes,
+                  (unsigned long long)total_count,
+                  (unsigned long long)total_bytes,
+                  (unsigned long long)alloha_sampler.period) > 0;
+    for (u32 idx = 0; ok && idx < alloha_sampler.capacity; ++idx) {
+        struct alloha_sample_stack const* stack = &alloha_sampler.stacks[idx];
+        if (stack->hash == 0) {
+            continue;
+        }
+
+        ok = fprintf(
+                 out,
+                 "%llu: %llu [%llu: %llu] @",
+                 (unsigned long long)stack->count,
+                 (unsigned long long)stack->bytes,
+                 (unsigned long long)stack->count,
+                 (unsigned long long)stack->bytes) > 0;
+        for (u32 frame = 0; ok && frame < stack->depth; ++frame) {
+            ok = fprintf(out, " 0x%llx", (unsigned long long)(uptr)stack->frames[frame]) > 0;
+        }
+        ok = ok && fputc('\n', out) != EOF;
+    }
+    return ok && alloha_sample_write_mappings(out);
+}
+
+static bool alloha_sample_write_folded(FILE* out) {
+    bool ok = true;
+    for (u32 idx = 0; ok && idx < alloha_sampler.capacity; ++idx) {
+        struct alloha_sample_stack const* stack = &alloha_sampler.stacks[idx];
+        if (stack->hash == 0) {
+            continue;
+        }
+
+        // Backtraces start from the innermost frame, while flame graphs start from the outermost.
+        for (u32 frame = stack->depth; ok && frame > 0; --frame) {
+            ok = fprintf(
+                     out,
+                     "%s0x%llx",
+                     frame == stack->depth ? "" : ";",
+                     (unsigned long long)(uptr)stack->frames[frame - 1]) > 0;
+        }
+        ok = ok && fprintf(out, " %llu\n", (unsigned long long)stack->estimated_bytes) > 0;
+    }
+    return ok;
+}
+
+bool alloha_sample_write(FILE* out, enum alloha_sample_format format) {
+    assert(out && "alloha_sample_write called with null output");
+
+    alloha_sample_lock();
+    bool ok = atomic_load_explicit(&alloha_sampler.running, memory_order_relaxed);
+    if (ok) {
+        ok = format == ALLOHA_SAMPLE_PPROF ? alloha_sample_write_pprof(out)
+                                           : alloha_sample_write_folded(out);
+    }
+    alloha_sample_unlock();
+    return ok && fflush(out) == 0;
+}
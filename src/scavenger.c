@@ -0,0 +1,221 @@
+/// Background scavenger implementation.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/scavenger.h>
+
+#include <alloha/core.h>
+#include <alloha/thread.h>
+#include <alloha/vmem.h>
+#include <assert.h>
+
+#if defined(_WIN32)
+#    define WIN32_LEAN_AND_MEAN
+#    include <windows.h>
+#else
+#    include <time.h>
+#endif
+
+static u64 scavenger_now_ms(void) {
+#if defined(_WIN32)
+    return (u64)GetTickCount64();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u64)now.tv_sec * 1000 + (u64)now.tv_nsec / 1000000;
+#endif
+}
+
+void scavenger_init(struct scavenger* scavenger, struct scavenger_config config) {
+    assert(scavenger && "scavenger_init called with null scavenger");
+    scavenger->config  = config;
+    scavenger->entries = NULL;
+    alloha_mutex_init(&scavenger->mutex);
+    atomic_init(&scavenger->running, false);
+    atomic_init(&scavenger->pressure, PRESSURE_NONE);
+    atomic_init(&scavenger->released_bytes, 0);
+}
+
+void scavenger_destroy(struct scavenger* scavenger) {
+    if (!scavenger) {
+        return;
+    }
+    assert(!scavenger->entries && "scavenger_destroy called with registered entries");
+    scavenger_stop(scavenger);
+    alloha_mutex_destroy(&scavenger->mutex);
+}
+
+static int scavenger_run(void* arg) {
+    struct scavenger* scavenger = (struct scavenger*)arg;
+    while (atomic_load_explicit(&scavenger->running, memory_order_acquire)) {
+        alloha_discard(scavenger_scan(scavenger));
+        alloha_thread_sleep(scavenger->config.period_ms);
+    }
+    return 0;
+}
+
+bool scavenger_start(struct scavenger* scavenger) {
+    assert(scavenger && "scavenger_start called with null scavenger");
+    if (atomic_exchange_explicit(&scavenger->running, true, memory_order_acq_rel)) {
+        return true;  // Already running.
+    }
+    if (!alloha_thread_create(&scavenger->thread, scavenger_run, scavenger)) {
+        atomic_store_explicit(&scavenger->running, false, memory_order_release);
+        return false;
+    }
+    return true;
+}
+
+void scavenger_stop(struct scavenger* scavenger) {
+    if (!scavenger || !atomic_exchange_explicit(&scavenger->running, false, memory_order_acq_rel)) {
+        return;
+    }
+    alloha_discard(alloha_thread_join(&scavenger->thread));
+}
+
+void scavenger_register(
+    struct scavenger* restrict       scavenger,
+    struct scavenger_entry* restrict entry,
+    u8*                              buf,
+    usize                            capacity) {
+    assert(scavenger && entry && "scavenger_register called with null scavenger or entry");
+
+    entry->buf      = buf;
+    entry->capacity = capacity;
+    atomic_init(&entry->epoch, 1);
+    atomic_init(&entry->last_used, capacity);
+    atomic_init(&entry->peak_used, 0);
+    atomic_init(&entry->trimming, false);
+    entry->high_water   = capacity;
+    entry->window_peak  = 0;
+    entry->window_start = scavenger_now_ms();
+    entry->resident_end = capacity;
+
+    alloha_mutex_lock(&scavenger->mutex);
+    entry->next        = scavenger->entries;
+    scavenger->entries = entry;
+    alloha_mutex_unlock(&scavenger->mutex);
+}
+
+void scavenger_unregister(
+    struct scavenger* restrict       scavenger,
+    struct scavenger_entry* restrict entry) {
+    assert(scavenger && entry && "scavenger_unregister called with null scavenger or entry");
+
+    // Holding the lock guarantees that no scan is releasing the memory of the entry.
+    alloha_mutex_lock(&scavenger->mutex);
+    for (struct scavenger_entry** it = &scavenger->entries; *it; it = &(*it)->next) {
+        if (*it == entry) {
+            *it = entry->next;
+            break;
+        }
+    }
+    alloha_mutex_unlock(&scavenger->mutex);
+    entry->next = NULL;
+}
+
+void scavenger_idle(struct scavenger_entry* entry, usize used) {
+    assert(
+        (atomic_load_explicit(&entry->epoch, memory_order_relaxed) & 1) &&
+        "scavenger_idle called on an idle entry");
+
+    // The peak is only ever overestimated if the scavenger resets it concurrently, which is safe.
+    usize const peak = atomic_load_explicit(&entry->peak_used, memory_order_relaxed);
+    atomic_store_explicit(&entry->last_used, used, memory_order_relaxed);
+    atomic_store_explicit(&entry->peak_used, alloha_max(peak, used), memory_order_relaxed);
+    atomic_fetch_add_explicit(&entry->epoch, 1, memory_order_release);
+}
+
+void scavenger_resume(struct scavenger_entry* entry) {
+    assert(
+        !(atomic_load_explicit(&entry->epoch, memory_order_relaxed) & 1) &&
+        "scavenger_resume called on an active entry");
+
+    // Pairs with the scavenger raising `trimming` before checking the epoch: either the scavenger
+    // sees the new epoch and backs off, or we see the chunk being released and wait for it.
+    atomic_fetch_add_explicit(&entry->epoch, 1, memory_order_seq_cst);
+    ALLOHA_SCHED_POINT();
+    while (atomic_load_explicit(&entry->trimming, memory_order_seq_cst)) {
+        alloha_thread_yield();
+    }
+}
+
+void scavenger_set_pressure(struct scavenger* scavenger, enum pressure_level level) {
+    assert(scavenger && "scavenger_set_pressure called with null scavenger");
+    atomic_store_explicit(&scavenger->pressure, (unsigned)level, memory_order_relaxed);
+}
+
+/// Release the pages of an entry lying above its high-water mark.
+static usize scavenger_trim(
+    struct scavenger*       scavenger,
+    struct scavenger_entry* entry,
+    u64                     now,
+    u32                     pressure) {
+    u64 const epoch = atomic_load_explicit(&entry->epoch, memory_order_acquire);
+    if (epoch & 1) {
+        return 0;
+    }
+
+    // Every page touched since the last scan lies below the reported peak, and the memory used in
+    // the last active period may still hold live data, so it's never released.
+    usize const reported  = atomic_exchange_explicit(&entry->peak_used, 0, memory_order_relaxed);
+    usize const peak      = alloha_min(reported, entry->capacity);
+    usize const last_used = atomic_load_explicit(&entry->last_used, memory_order_relaxed);
+    entry->resident_end = alloha_max(entry->resident_end, peak);
+    entry->window_peak  = alloha_max(entry->window_peak, peak);
+    entry->high_water   = alloha_max(entry->high_water, peak);
+    if (pressure >= PRESSURE_LOW) {
+        entry->high_water   = 0;
+        entry->window_peak  = 0;
+        entry->window_start = now;
+    } else if (now - entry->window_start >= scavenger->config.decay_ms) {
+        entry->high_water   = entry->window_peak;
+        entry->window_peak  = 0;
+        entry->window_start = now;
+    }
+    entry->high_water = alloha_max(entry->high_water, alloha_min(last_used, entry->capacity));
+
+    usize const page_size = vmem_page_size();
+    bool const  lazy      = scavenger->config.lazy && (pressure < PRESSURE_MEDIUM);
+    uptr const  low       = align_forward((uptr)entry->buf + entry->high_water, (u32)page_size);
+    uptr        high      = ((uptr)entry->buf + entry->resident_end) & ~((uptr)page_size - 1);
+    usize       released  = 0;
+    while (high > low) {
+        uptr const chunk_start = alloha_max(low, high - SCAVENGER_CHUNK_SIZE);
+
+        atomic_store_explicit(&entry->trimming, true, memory_order_seq_cst);
+        ALLOHA_SCHED_POINT();
+        if (atomic_load_explicit(&entry->epoch, memory_order_seq_cst) != epoch) {
+            // The owner resumed, the memory may be in use again.
+            atomic_store_explicit(&entry->trimming, false, memory_order_release);
+            break;
+        }
+        bool const ok = vmem_decommit((u8*)chunk_start, (usize)(high - chunk_start), lazy);
+        ALLOHA_SCHED_POINT();
+        atomic_store_explicit(&entry->trimming, false, memory_order_release);
+        if (!ok) {
+            break;
+        }
+
+        released += (usize)(high - chunk_start);
+        high                = chunk_start;
+        entry->resident_end = (usize)(high - (uptr)entry->buf);
+    }
+    return released;
+}
+
+usize scavenger_scan(struct scavenger* scavenger) {
+    assert(scavenger && "scavenger_scan called with null scavenger");
+
+    u64 const now      = scavenger_now_ms();
+    u32 const pressure = atomic_load_explicit(&scavenger->pressure, memory_order_relaxed);
+    usize     released = 0;
+    alloha_mutex_lock(&scavenger->mutex);
+    for (struct scavenger_entry* entry = scavenger->entries; entry; entry = entry->next) {
+        released += scavenger_trim(scavenger, entry, now, pressure);
+    }
+    alloha_mutex_unlock(&scavenger->mutex);
+
+    atomic_fetch_add_explicit(&scavenger->released_bytes, released, memory_order_relaxed);
+    return released;
+}
@@ -5,9 +5,11 @@
 #include <alloha/stack.h>
 
 #include <alloha/core.h>
+#include <alloha/probe.h>
+#include <alloha/sample.h>
+#include <alloha/vmem.h>
 #include <assert.h>
 #include <stdalign.h>
-#include <stdio.h>
 #include <stdlib.h>
 
 struct stack stack_new(usize capacity, u8* buf) {
@@ -20,6 +22,7 @@ struct stack stack_new(usize capacity, u8* buf) {
         .capacity        = capacity,
         .offset          = 0,
         .previous_offset = 0,
+        .oom             = NULL,
     };
 }
 
@@ -36,13 +39,11 @@ void stack_init(struct stack* restrict stack, usize capacity, u8* restrict buf)
     stack->capacity        = capacity;
     stack->offset          = 0;
     stack->previous_offset = 0;
+    stack->oom             = NULL;
 }
 
-u8* stack_alloc_aligned(struct stack* stack, size_t size, u32 alignment) {
-    if (!stack || stack->capacity == 0 || size == 0) {
-        return NULL;
-    }
-
+/// Push a new block to the stack, if there is enough memory for it.
+static u8* stack_push(struct stack* stack, usize size, u32 alignment) {
     u8*   free_mem           = alloha_ptr_add(stack->buf, stack->offset);
     usize available_capacity = usize_wrap_sub(stack->capacity, stack->offset);
 
@@ -54,14 +55,7 @@ u8* stack_alloc_aligned(struct stack* stack, size_t size, u32 alignment) {
     usize required_size = (usize)padding + size;
 
     if (required_size > available_capacity) {
-        fprintf(
-            stderr,
-            "Unable to allocate %zu bytes of memory (%zu bytes required), only %zu "
-            "remaining.\n",
-            size,
-            padding + size,
-            usize_wrap_sub(stack->capacity, stack->offset));
-        return 0;
+        return NULL;
     }
 
     u8* new_block = alloha_ptr_add(free_mem, padding);
@@ -80,6 +74,48 @@ u8* stack_alloc_aligned(struct stack* stack, size_t size, u32 alignment) {
     return new_block;
 }
 
+/// Apply the failure policy of the stack to an allocation that didn't fit.
+static u8* stack_alloc_failed(struct stack* stack, usize size, u32 alignment) {
+    ALLOHA_PROBE4(
+        stack_alloc_failed,
+        stack,
+        size,
+        alignment,
+        usize_wrap_sub(stack->capacity, stack->offset));
+    for (u32 attempt = 0;; ++attempt) {
+        struct alloha_oom_info const info = {
+            .error     = ALLOHA_ERROR_OUT_OF_MEMORY,
+            .function  = "stack_alloc_aligned",
+            .allocator = stack,
+            .size      = size,
+            .alignment = alignment,
+            .available = usize_wrap_sub(stack->capacity, stack->offset),
+        };
+        if (!alloha_oom_retry(stack->oom, &info, attempt)) {
+            return NULL;
+        }
+
+        u8* new_block = stack_push(stack, size, alignment);
+        if (new_block) {
+            return new_block;
+        }
+    }
+}
+
+u8* stack_alloc_aligned(struct stack* stack, usize size, u32 alignment) {
+    if (!stack || stack->capacity == 0 || size == 0) {
+        return NULL;
+    }
+
+    alloha_sample_alloc(size);
+    u8* new_block = stack_push(stack, size, alignment);
+    if (!new_block) {
+        new_block = stack_alloc_failed(stack, size, alignment);
+    }
+    ALLOHA_PROBE4(stack_alloc, stack, size, alignment, new_block);
+    return new_block;
+}
+
 u8* stack_alloc(struct stack* stack, usize size) {
     return stack_alloc_aligned(stack, size, ALLOHA_DEFAULT_ALIGNMENT);
 }
@@ -94,6 +130,8 @@ bool stack_pop(struct stack* stack) {
     struct stack_header const* top_header =
         (struct stack_header const*)alloha_ptr_sub(top, sizeof(struct stack_header));
 
+    ALLOHA_PROBE2(stack_pop, stack, top);
+
     // Update the stack.
     stack->offset          = stack->previous_offset - top_header->padding;
     stack->previous_offset = top_header->previous_offset;
@@ -105,19 +143,16 @@ bool stack_clear_at(struct stack* restrict stack, u8* restrict block) {
         return false;
     }
 
-    if (!(stack->buf <= block && block < alloha_ptr_add(stack->buf, stack->capacity))) {
-        fprintf(
-            stderr,
-            "stack_free requested to free a block of memory outside of the range of the given "
-            "stack allocator.\n");
-        return false;
-    }
-
-    if (block >= alloha_ptr_add(stack->buf, stack->previous_offset)) {
-        fprintf(stderr, "stack_free requested to free an already free memory block");
+    // Check if the block lies within the allocator's memory, and isn't already free. Live blocks
+    // are preceded by their header, and there are none in an empty stack.
+    u8 const* first_block = alloha_ptr_add(stack->buf, sizeof(struct stack_header));
+    if (stack->offset == 0 || block < first_block ||
+        block > alloha_ptr_add(stack->buf, stack->previous_offset)) {
+        alloha_report_error(ALLOHA_ERROR_INVALID_BLOCK, "stack_clear_at");
         return false;
     }
 
+    ALLOHA_PROBE2(stack_clear_at, stack, block);
     struct stack_header const* block_header =
         (struct stack_header const*)alloha_ptr_sub(block, sizeof(struct stack_header));
     stack->offset =
@@ -131,6 +166,14 @@ void stack_clear(struct stack* stack) {
     if (!stack) {
         return;
     }
+    ALLOHA_PROBE2(stack_clear, stack, stack->offset);
     stack->offset          = 0;
     stack->previous_offset = 0;
 }
+
+void stack_prefault(struct stack* stack, u32 thread_count) {
+    if (!stack || stack->capacity == 0) {
+        return;
+    }
+    vmem_prefault(stack->buf + stack->offset, stack->capacity - stack->offset, thread_count);
+}
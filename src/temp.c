@@ -0,0 +1,41 @@
+/// Thread-local temporary stack implementation.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/temp.h>
+
+#include <alloha/arena.h>
+#include <alloha/core.h>
+#include <alloha/oom.h>
+#include <alloha/vmem.h>
+
+ALLOHA_THREAD_LOCAL struct arena alloha_temp_arena = {0};
+
+u8* alloha_temp_push_slow(usize size, u32 alignment) {
+    struct arena* temp = &alloha_temp_arena;
+    if (!temp->buf && size != 0) {
+        u8* buf = vmem_alloc(ALLOHA_TEMP_CAPACITY, VMEM_DEFAULT);
+        if (!buf) {
+            alloha_report_error(ALLOHA_ERROR_OUT_OF_MEMORY, "alloha_temp_push");
+            return NULL;
+        }
+
+        // Keep the failure policy set by the user.
+        struct alloha_oom_policy const* oom = temp->oom;
+        arena_init(temp, ALLOHA_TEMP_CAPACITY, buf);
+        temp->oom = oom;
+    }
+    return arena_alloc_aligned(temp, size, alignment);
+}
+
+void alloha_temp_release(void) {
+    struct arena* temp = &alloha_temp_arena;
+    if (!temp->buf) {
+        return;
+    }
+
+    struct alloha_oom_policy const* oom = temp->oom;
+    vmem_free(temp->buf, temp->capacity);
+    arena_init(temp, 0, NULL);
+    temp->oom = oom;
+}
@@ -0,0 +1,115 @@
+/// Implementation of the threading primitives.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/thread.h>
+
+#include <assert.h>
+
+#if defined(_WIN32)
+#    define WIN32_LEAN_AND_MEAN
+#    include <windows.h>
+#else
+#    include <errno.h>
+#    include <sched.h>
+#    include <time.h>
+#endif
+
+#if defined(_WIN32)
+
+static DWORD WINAPI alloha_thread_start(LPVOID param) {
+    struct alloha_thread* thread = (struct alloha_thread*)param;
+    return (DWORD)thread->fn(thread->arg);
+}
+
+bool alloha_thread_create(struct alloha_thread* thread, alloha_thread_fn fn, void* arg) {
+    assert(thread && fn && "alloha_thread_create called with null thread or entry point");
+    thread->fn     = fn;
+    thread->arg    = arg;
+    thread->handle = CreateThread(NULL, 0, alloha_thread_start, thread, 0, NULL);
+    return thread->handle != NULL;
+}
+
+int alloha_thread_join(struct alloha_thread* thread) {
+    DWORD res = 0;
+    WaitForSingleObject((HANDLE)thread->handle, INFINITE);
+    GetExitCodeThread((HANDLE)thread->handle, &res);
+    CloseHandle((HANDLE)thread->handle);
+    return (int)res;
+}
+
+void alloha_thread_yield(void) {
+    SwitchToThread();
+}
+
+void alloha_thread_sleep(u32 milliseconds) {
+    Sleep((DWORD)milliseconds);
+}
+
+void alloha_mutex_init(struct alloha_mutex* mutex) {
+    InitializeSRWLock((PSRWLOCK)&mutex->srw_lock);
+}
+
+void alloha_mutex_destroy(struct alloha_mutex* mutex) {
+    alloha_discard(mutex);  // SRW locks don't need to be destroyed.
+}
+
+void alloha_mutex_lock(struct alloha_mutex* mutex) {
+    AcquireSRWLockExclusive((PSRWLOCK)&mutex->srw_lock);
+}
+
+void alloha_mutex_unlock(struct alloha_mutex* mutex) {
+    ReleaseSRWLockExclusive((PSRWLOCK)&mutex->srw_lock);
+}
+
+#else
+
+static void* alloha_thread_start(void* param) {
+    struct alloha_thread* thread = (struct alloha_thread*)param;
+    return (void*)(iptr)thread->fn(thread->arg);
+}
+
+bool alloha_thread_create(struct alloha_thread* thread, alloha_thread_fn fn, void* arg) {
+    assert(thread && fn && "alloha_thread_create called with null thread or entry point");
+    thread->fn  = fn;
+    thread->arg = arg;
+    return pthread_create(&thread->handle, NULL, alloha_thread_start, thread) == 0;
+}
+
+int alloha_thread_join(struct alloha_thread* thread) {
+    void* res = NULL;
+    pthread_join(thread->handle, &res);
+    return (int)(iptr)res;
+}
+
+void alloha_thread_yield(void) {
+    sched_yield();
+}
+
+void alloha_thread_sleep(u32 milliseconds) {
+    struct timespec duration = {
+        .tv_sec  = (time_t)(milliseconds / 1000),
+        .tv_nsec = (long)(milliseconds % 1000) * 1000000L,
+    };
+    while (nanosleep(&duration, &duration) != 0 && errno == EINTR) {
+        // Interrupted by a signal, sleep for the remaining time.
+    }
+}
+
+void alloha_mutex_init(struct alloha_mutex* mutex) {
+    pthread_mutex_init(&mutex->handle, NULL);
+}
+
+void alloha_mutex_destroy(struct alloha_mutex* mutex) {
+    pthread_mutex_destroy(&mutex->handle);
+}
+
+void alloha_mutex_lock(struct alloha_mutex* mutex) {
+    pthread_mutex_lock(&mutex->handle);
+}
+
+void alloha_mutex_unlock(struct alloha_mutex* mutex) {
+    pthread_mutex_unlock(&mutex->handle);
+}
+
+#endif
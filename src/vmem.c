@@ -0,0 +1,286 @@
+/// Virtual memory utilities implementation.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/vmem.h>
+
+#include <alloha/core.h>
+#include <alloha/thread.h>
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+#if defined(_WIN32)
+#    define WIN32_LEAN_AND_MEAN
+#    include <windows.h>
+#else
+#    include <errno.h>
+#    include <string.h>
+#    include <sys/mman.h>
+#    include <sys/resource.h>
+#    include <unistd.h>
+#endif
+
+/// Ranges smaller than this are always touched by the calling thread alone, since the cost of
+/// starting the threads would dominate.
+#define VMEM_PARALLEL_PREFAULT_MIN_SIZE (64ull << 20)
+#define VMEM_MAX_PREFAULT_THREADS       32
+
+static atomic_size_t vmem_mapped_bytes  = 0;
+static atomic_size_t vmem_locked_bytes  = 0;
+static atomic_size_t vmem_lock_failures = 0;
+
+usize vmem_page_size(void) {
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (usize)info.dwPageSize;
+#else
+    return (usize)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+u8* vmem_alloc(usize size, u32 flags) {
+    if (size == 0) {
+        return NULL;
+    }
+    size = (usize)align_forward((uptr)size, (u32)vmem_page_size());
+
+    bool const reserve = (flags & VMEM_RESERVE) != 0;
+#if defined(_WIN32)
+    DWORD const type    = reserve ? MEM_RESERVE : (MEM_RESERVE | MEM_COMMIT);
+    DWORD const protect = reserve ? PAGE_NOACCESS : PAGE_READWRITE;
+    u8*         mem     = (u8*)VirtualAlloc(NULL, size, type, protect);
+    if (!mem) {
+        fprintf(stderr, "vmem_alloc unable to map %zu bytes (error %lu).\n", size, GetLastError());
+        return NULL;
+    }
+    if ((flags & VMEM_POPULATE) && !reserve) {
+        vmem_prefault(mem, size, 1);
+    }
+#else
+    int mmap_flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#    if defined(MAP_POPULATE)
+    if ((flags & VMEM_POPULATE) && !reserve) {
+        mmap_flags |= MAP_POPULATE;
+    }
+#    endif
+#    if defined(MAP_NORESERVE)
+    if (reserve) {
+        mmap_flags |= MAP_NORESERVE;
+    }
+#    endif
+    int const prot = reserve ? PROT_NONE : (PROT_READ | PROT_WRITE);
+    void*     mem  = mmap(NULL, size, prot, mmap_flags, -1, 0);
+    if (mem == MAP_FAILED) {
+        fprintf(stderr, "vmem_alloc unable to map %zu bytes: %s.\n", size, strerror(errno));
+        return NULL;
+    }
+#    if !defined(MAP_POPULATE)
+    if ((flags & VMEM_POPULATE) && !reserve) {
+        vmem_prefault((u8*)mem, size, 1);
+    }
+#    endif
+#endif
+
+    atomic_fetch_add_explicit(&vmem_mapped_bytes, size, memory_order_relaxed);
+    return (u8*)mem;
+}
+
+void vmem_free(u8* mem, usize size) {
+    if (!mem) {
+        return;
+    }
+    size = (usize)align_forward((uptr)size, (u32)vmem_page_size());
+#if defined(_WIN32)
+    VirtualFree(mem, 0, MEM_RELEASE);
+#else
+    munmap(mem, size);
+#endif
+    atomic_fetch_sub_explicit(&vmem_mapped_bytes, size, memory_order_relaxed);
+}
+
+bool vmem_commit(u8* mem, usize size) {
+    if (!mem || size == 0) {
+        return false;
+    }
+    size = (usize)align_forward((uptr)size, (u32)vmem_page_size());
+#if defined(_WIN32)
+    return VirtualAlloc(mem, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+#else
+    return mprotect(mem, size, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+struct vmem_touch_range {
+    u8*   first_page;
+    usize page_count;
+    u8*   start;  ///< First byte that may be written, the memory before it may belong to others.
+};
+
+/// Write to each page of the range, keeping its contents.
+static int vmem_touch_pages(void* arg) {
+    struct vmem_touch_range const* range     = (struct vmem_touch_range const*)arg;
+    usize const                    page_size = vmem_page_size();
+    for (usize page = 0; page < range->page_count; ++page) {
+        u8 volatile* ptr = alloha_max(range->first_page + page * page_size, range->start);
+        *ptr             = *ptr;
+    }
+    return 0;
+}
+
+void vmem_prefault(u8* mem, usize size, u32 thread_count) {
+    if (!mem || size == 0) {
+        return;
+    }
+
+    // Only whole pages overlapping the range are considered, but only bytes inside of the range are
+    // touched, the rest of the first page may hold the data of someone else.
+    usize const page_size  = vmem_page_size();
+    uptr const  first_page = (uptr)mem & ~((uptr)page_size - 1);
+    uptr const  end        = align_forward((uptr)mem + size, (u32)page_size);
+
+#if defined(__linux__) && defined(MADV_POPULATE_WRITE)
+    if (madvise((void*)first_page, (usize)(end - first_page), MADV_POPULATE_WRITE) == 0) {
+        return;
+    }
+    // Older kernels don't support populating pages, fall back to touching them.
+#endif
+
+    usize const page_count = (usize)(end - first_page) / page_size;
+    if (thread_count <= 1 || (usize)(end - first_page) < VMEM_PARALLEL_PREFAULT_MIN_SIZE) {
+        struct vmem_touch_range range = {
+            .first_page = (u8*)first_page,
+            .page_count = page_count,
+            .start      = mem,
+        };
+        alloha_discard(vmem_touch_pages(&range));
+        return;
+    }
+
+    thread_count = alloha_min(thread_count, VMEM_MAX_PREFAULT_THREADS);
+
+    // The calling thread touches the first share of the pages while the others do the rest.
+    struct alloha_thread    threads[VMEM_MAX_PREFAULT_THREADS];
+    struct vmem_touch_range ranges[VMEM_MAX_PREFAULT_THREADS];
+    usize const             pages_per_thread = (page_count + thread_count - 1) / thread_count;
+    u32                     spawned          = 0;
+    for (u32 t = 0; t < thread_count; ++t) {
+        usize const start    = alloha_min((usize)t * pages_per_thread, page_count);
+        ranges[t].first_page = (u8*)first_page + start * page_size;
+        ranges[t].page_count = alloha_min(pages_per_thread, page_count - start);
+        ranges[t].start      = mem;
+        if (t == 0 || ranges[t].page_count == 0) {
+            continue;
+        }
+        if (alloha_thread_create(&threads[spawned], vmem_touch_pages, &ranges[t])) {
+            ++spawned;
+        } else {
+            alloha_discard(vmem_touch_pages(&ranges[t]));
+        }
+    }
+
+    alloha_discard(vmem_touch_pages(&ranges[0]));
+    for (u32 t = 0; t < spawned; ++t) {
+        alloha_discard(alloha_thread_join(&threads[t]));
+    }
+}
+
+bool vmem_decommit(u8* mem, usize size, bool lazy) {
+    if (!mem || size == 0) {
+        return false;
+    }
+
+    // Only whole pages inside of the range are released, the rest may still hold live data.
+    usize const page_size = vmem_page_size();
+    uptr const  start     = align_forward((uptr)mem, (u32)page_size);
+    uptr const  end       = ((uptr)mem + size) & ~((uptr)page_size - 1);
+    if (end <= start) {
+        return true;
+    }
+
+#if defined(_WIN32)
+    alloha_discard(lazy);
+    return VirtualAlloc((void*)start, (usize)(end - start), MEM_RESET, PAGE_READWRITE) != NULL;
+#else
+    int advice = MADV_DONTNEED;
+#    if defined(MADV_FREE)
+    if (lazy) {
+        advice = MADV_FREE;
+    }
+#    else
+    alloha_discard(lazy);
+#    endif
+    return madvise((void*)start, (usize)(end - start), advice) == 0;
+#endif
+}
+
+bool vmem_lock(u8* mem, usize size, bool on_fault) {
+    if (!mem || size == 0) {
+        return false;
+    }
+    size = (usize)align_forward((uptr)size, (u32)vmem_page_size());
+
+#if defined(_WIN32)
+    // Windows has no lazy locking, pages are brought in right away.
+    alloha_discard(on_fault);
+    bool const locked = VirtualLock(mem, size);
+#elif defined(__linux__) && defined(MLOCK_ONFAULT)
+    bool const locked = (mlock2(mem, size, on_fault ? MLOCK_ONFAULT : 0) == 0);
+#else
+    alloha_discard(on_fault);
+    bool const locked = (mlock(mem, size) == 0);
+#endif
+
+    if (locked) {
+        atomic_fetch_add_explicit(&vmem_locked_bytes, size, memory_order_relaxed);
+        return true;
+    }
+
+    // Only the first failure is reported, the following ones are only counted.
+    if (atomic_fetch_add_explicit(&vmem_lock_failures, 1, memory_order_relaxed) == 0) {
+#if defined(_WIN32)
+        fprintf(
+            stderr,
+            "vmem_lock unable to lock %zu bytes (error %lu), the memory will stay unlocked. "
+            "Consider raising the working set size of the process.\n",
+            size,
+            GetLastError());
+#else
+        int const     err   = errno;
+        struct rlimit limit = {0};
+        getrlimit(RLIMIT_MEMLOCK, &limit);
+        fprintf(
+            stderr,
+            "vmem_lock unable to lock %zu bytes (%s), the memory will stay unlocked. "
+            "RLIMIT_MEMLOCK allows %llu bytes, %zu of which are locked by alloha.\n",
+            size,
+            strerror(err),
+            (unsigned long long)limit.rlim_cur,
+            atomic_load_explicit(&vmem_locked_bytes, memory_order_relaxed));
+#endif
+    }
+    return false;
+}
+
+void vmem_unlock(u8* mem, usize size) {
+    if (!mem || size == 0) {
+        return;
+    }
+    size = (usize)align_forward((uptr)size, (u32)vmem_page_size());
+
+#if defined(_WIN32)
+    VirtualUnlock(mem, size);
+#else
+    munlock(mem, size);
+#endif
+    atomic_fetch_sub_explicit(&vmem_locked_bytes, size, memory_order_relaxed);
+}
+
+struct vmem_stats vmem_stats(void) {
+    return (struct vmem_stats){
+        .mapped_bytes  = atomic_load_explicit(&vmem_mapped_bytes, memory_order_relaxed),
+        .locked_bytes  = atomic_load_explicit(&vmem_locked_bytes, memory_order_relaxed),
+        .lock_failures = atomic_load_explicit(&vmem_lock_failures, memory_order_relaxed),
+    };
+}
@@ -0,0 +1,220 @@
+/// Heap walking and allocation dumps implementation.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/walk.h>
+
+#include <alloha/arena.h>
+#include <alloha/core.h>
+#include <alloha/gc.h>
+#include <alloha/stack.h>
+#include <assert.h>
+#include <stdio.h>
+
+usize stack_walk(struct stack const* stack, alloha_walk_fn fn, void* user_data) {
+    assert(stack && fn && "stack_walk called with null stack or function");
+
+    // Blocks are contiguous, each one starting, with its padding, where the previous one ends.
+    usize count = 0;
+    usize top   = stack->previous_offset;
+    usize end   = stack->offset;
+    while (end > 0) {
+        u8 const*                  memory = stack->buf + top;
+        struct stack_header const* header =
+            (struct stack_header const*)(memory - sizeof(struct stack_header));
+        assert(
+            (header->padding <= top && top + header->capacity == end) &&
+            "stack_walk found a corrupted block header");
+
+        struct alloha_block const block = {
+            .memory  = memory,
+            .offset  = top,
+            .size    = header->capacity,
+            .padding = header->padding,
+        };
+        ++count;
+        if (!fn(&block, user_data)) {
+            break;
+        }
+
+        end = top - header->padding;
+        top = header->previous_offset;
+    }
+    return count;
+}
+
+usize gc_heap_walk(struct gc_heap const* heap, alloha_walk_fn fn, void* user_data) {
+    assert(heap && fn && "gc_heap_walk called with null heap or function");
+
+    struct arena const* space  = &heap->spaces[heap->to_space];
+    usize               count  = 0;
+    usize               offset = 0;
+    while (offset < space->offset) {
+        struct gc_header const* header = (struct gc_header const*)(space->buf + offset);
+        usize const             start  = offset + sizeof(struct gc_header);
+
+        struct alloha_block const block = {
+            .memory  = space->buf + start,
+            .offset  = start,
+            .size    = header->type->size,
+            .padding = sizeof(struct gc_header),
+        };
+        ++count;
+        if (!fn(&block, user_data)) {
+            break;
+        }
+
+        offset += (usize)align_forward((uptr)(sizeof(struct gc_header) + block.size), GC_ALIGNMENT);
+    }
+    return count;
+}
+
+usize arena_walk(struct arena const* arena, alloha_walk_fn fn, void* user_data) {
+    assert(arena && fn && "arena_walk called with null arena or function");
+
+    struct arena_tags const* tags  = arena->tags;
+    usize                    count = 0;
+    for (usize idx = 0; tags && idx < tags->count; ++idx) {
+        // Records past the offset belong to blocks freed by a rewind, and are trimmed lazily.
+        struct arena_tag const* tag = &tags->tags[idx];
+        if (tag->offset + tag->size > arena->offset) {
+            break;
+        }
+
+        struct alloha_block const block = {
+            .memory  = arena->buf + tag->offset,
+            .offset  = tag->offset,
+            .size    = tag->size,
+            .padding = tag->padding,
+        };
+        ++count;
+        if (!fn(&block, user_data)) {
+            break;
+        }
+    }
+    return count;
+}
+
+// -----------------------------------------------------------------------------
+// Dumps.
+// -----------------------------------------------------------------------------
+
+struct alloha_dump_writer {
+    FILE*                   out;
+    enum alloha_dump_format format;
+    usize                   written;  ///< Amount of blocks written so far.
+    bool                    ok;
+};
+
+static bool alloha_dump_count(struct alloha_block const* block, void* user_data) {
+    alloha_discard(block);
+    alloha_discard(user_data);
+    return true;
+}
+
+static bool alloha_dump_write_block(struct alloha_block const* block, void* user_data) {
+    struct alloha_dump_writer* writer = (struct alloha_dump_writer*)user_data;
+    if (writer->format == ALLOHA_DUMP_BINARY) {
+        struct alloha_dump_block const record = {
+            .offset  = block->offset,
+            .size    = block->size,
+            .padding = block->padding,
+        };
+        writer->ok = fwrite(&record, sizeof(record), 1, writer->out) == 1;
+    } else {
+        writer->ok = fprintf(
+                         writer->out,
+                         "%s\n{\"offset\":%zu,\"size\":%zu,\"padding\":%zu}",
+                         writer->written == 0 ? "" : ",",
+                         block->offset,
+                         block->size,
+                         block->padding) > 0;
+    }
+    ++writer->written;
+    return writer->ok;
+}
+
+/// Walker of the blocks of an allocator, or null if the allocator has no blocks to be listed.
+typedef usize (*alloha_dump_walk_fn)(void const* allocator, alloha_walk_fn fn, void* user_data);
+
+static usize alloha_dump_walk_stack(void const* allocator, alloha_walk_fn fn, void* user_data) {
+    return stack_walk((struct stack const*)allocator, fn, user_data);
+}
+
+static usize alloha_dump_walk_gc_heap(void const* allocator, alloha_walk_fn fn, void* user_data) {
+    return gc_heap_walk((struct gc_heap const*)allocator, fn, user_data);
+}
+
+static usize alloha_dump_walk_arena(void const* allocator, alloha_walk_fn fn, void* user_data) {
+    return arena_walk((struct arena const*)allocator, fn, user_data);
+}
+
+static bool alloha_dump(
+    FILE*                   out,
+    enum alloha_dump_format format,
+    enum alloha_dump_kind   kind,
+    struct arena const*     extent,
+    void const*             allocator,
+    alloha_dump_walk_fn     walk) {
+    assert(out && "alloha_dump called with null output");
+
+    static char const* const kind_names[] = {"arena", "stack", "gc_heap"};
+
+    struct alloha_dump_writer writer = {.out = out, .format = format, .ok = true};
+    if (format == ALLOHA_DUMP_BINARY) {
+        struct alloha_dump_header const header = {
+            .magic       = ALLOHA_DUMP_MAGIC,
+            .version     = ALLOHA_DUMP_VERSION,
+            .kind        = (u32)kind,
+            .address     = (u64)(uptr)extent->buf,
+            .capacity    = extent->capacity,
+            .used        = extent->offset,
+            .block_count = walk ? walk(allocator, alloha_dump_count, NULL) : 0,
+        };
+        writer.ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    } else {
+        writer.ok = fprintf(
+                        out,
+                        "{\"allocator\":\"%s\",\"address\":\"0x%llx\",\"capacity\":%zu,"
+                        "\"used\":%zu,\"blocks\":[",
+                        kind_names[kind],
+                        (unsigned long long)(uptr)extent->buf,
+                        extent->capacity,
+                        extent->offset) > 0;
+    }
+
+    if (writer.ok && walk) {
+        alloha_discard(walk(allocator, alloha_dump_write_block, &writer));
+    }
+    if (writer.ok && format == ALLOHA_DUMP_JSON) {
+        writer.ok = fputs("]}\n", out) >= 0;
+    }
+    return writer.ok && fflush(out) == 0;
+}
+
+bool stack_dump(struct stack const* stack, FILE* out, enum alloha_dump_format format) {
+    assert(stack && "stack_dump called with null stack");
+    struct arena const extent = {
+        .buf      = stack->buf,
+        .capacity = stack->capacity,
+        .offset   = stack->offset,
+    };
+    return alloha_dump(out, format, ALLOHA_DUMP_STACK, &extent, stack, alloha_dump_walk_stack);
+}
+
+bool gc_heap_dump(struct gc_heap const* heap, FILE* out, enum alloha_dump_format format) {
+    assert(heap && "gc_heap_dump called with null heap");
+    return alloha_dump(
+        out,
+        format,
+        ALLOHA_DUMP_GC_HEAP,
+        &heap->spaces[heap->to_space],
+        heap,
+        alloha_dump_walk_gc_heap);
+}
+
+bool arena_dump(struct arena const* arena, FILE* out, enum alloha_dump_format format) {
+    assert(arena && "arena_dump called with null arena");
+    alloha_dump_walk_fn const walk = arena->tags ? alloha_dump_walk_arena : NULL;
+    return alloha_dump(out, format, ALLOHA_DUMP_ARENA, arena, arena, walk);
+}
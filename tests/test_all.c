@@ -6,10 +6,46 @@
 
 #define ALLOHA_TEST_NO_MAIN
 #include "test_arena.c"
+#include "test_concurrency.c"
+#include "test_context.c"
+#include "test_down_arena.c"
+#include "test_fiber_stack.c"
+#include "test_gc.c"
+#include "test_jobs.c"
+#include "test_lifetime.c"
+#include "test_model.c"
+#include "test_oom.c"
+#include "test_pressure.c"
+#include "test_probe.c"
+#include "test_recycle_arena.c"
+#include "test_region.c"
+#include "test_sample.c"
+#include "test_scavenger.c"
 #include "test_stack.c"
+#include "test_temp.c"
+#include "test_vmem.c"
+#include "test_walk.c"
 
 int main(void) {
     test_arena();
     test_stack();
+    test_down_arena();
+    test_recycle_arena();
+    test_fiber_stack();
+    test_model();
+    test_concurrency();
+    test_jobs();
+    test_gc();
+    test_region();
+    test_sample();
+    test_lifetime();
+    test_context();
+    test_temp();
+    test_oom();
+    test_scavenger();
+    test_pressure();
+    test_vmem();
+    test_walk();
+    test_probe();
     return 0;
 }
@@ -5,9 +5,12 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <alloha/arena.h>
 #include <alloha/core.h>
+#include <alloha/stack.h>
+#include <alloha/vmem.h>
 
 struct foo {
     u32 x : 1;
@@ -86,8 +89,10 @@ static void arena_check_offsets(void) {
     struct foo* arr_foo = (struct foo*)arena_alloc_aligned(&arena, arr_foo_size, (u32)arr_foo_alignment);
     for (u32 i = 0; i < arr_foo_len; i++) {
         struct foo f;
-        f.x = f.y = f.z = 1;
-        arr_foo[i]      = f;
+        f.x        = 1;
+        f.y        = 1;
+        f.z        = 1;
+        arr_foo[i] = f;
     }
 
     usize arr_foo_expected_alignment       = arr_u32_expected_offset % arr_foo_alignment;
@@ -99,9 +104,183 @@ static void arena_check_offsets(void) {
     printf("Test `arena_check_offsets` passed.\n");
 }
 
+// Pre-faulting shouldn't change the state of the arena nor its contents.
+static void arena_prefault_keeps_state(void) {
+    usize const  buf_size = 8192;
+    u8*          buf      = (u8*)malloc(buf_size);
+    struct arena arena    = arena_new(buf_size, buf);
+
+    u32* arr = (u32*)arena_alloc_aligned(&arena, 100 * sizeof(u32), alloha_alignof(u32));
+    for (u32 i = 0; i < 100; ++i) {
+        arr[i] = 3 * i;
+    }
+    usize const offset = arena.offset;
+
+    arena_prefault(&arena, 2);
+    assert(arena.offset == offset);
+    for (u32 i = 0; i < 100; ++i) {
+        assert(arr[i] == 3 * i);
+    }
+    u8* const rest = arena_alloc(&arena, buf_size - offset - ALLOHA_DEFAULT_ALIGNMENT);
+    assert(rest);
+
+    free(buf);
+    printf("Test `arena_prefault_keeps_state` passed.\n");
+}
+
+// Data of unknown size is read straight into the reserved span, and only the bytes read are kept.
+static void arena_reserve_commit(void) {
+    usize const  buf_size = 1024;
+    u8*          buf      = (u8*)malloc(buf_size);
+    struct arena arena    = arena_new(buf_size, buf);
+
+    FILE* file = tmpfile();
+    assert(file);
+    char const  message[] = "written straight into the arena";
+    usize const written   = fwrite(message, 1, sizeof(message), file);
+    assert(written == sizeof(message));
+    rewind(file);
+
+    u8* const head = arena_alloc_aligned(&arena, 3, 1);
+    assert(head);
+    u8* span = arena_reserve(&arena, 256, 16);
+    assert(span && ((uptr)span & 15) == 0 && arena.offset == 3);
+    assert(span + arena.reserved_size == buf + buf_size && arena.reserved_size >= 256);
+
+    usize const read = fread(span, 1, arena.reserved_size, file);
+    assert(read == sizeof(message));
+    fclose(file);
+
+    u8* const committed = arena_commit(&arena, read);
+    assert(committed == span);
+    assert(arena.offset == (usize)(span - buf) + read && arena.reserved_size == 0);
+    assert(memcmp(span, message, sizeof(message)) == 0);
+
+    // Committing nothing discards the reservation.
+    usize const offset  = arena.offset;
+    u8* const   aligned = arena_reserve(&arena, 64, 64);
+    u8* const   nothing = arena_commit(&arena, 0);
+    assert(aligned && !nothing && arena.offset == offset);
+
+    // Reservations that don't fit, and commits past the reservation, fail.
+    u8* const too_large = arena_reserve(&arena, buf_size, 1);
+    assert(!too_large && arena.offset == offset);
+    u8* const small   = arena_reserve(&arena, 8, 1);
+    u8* const overrun = arena_commit(&arena, buf_size);
+    assert(small && !overrun && arena.offset == offset);
+
+    // Allocating from the arena invalidates the pending reservation.
+    u8* const pending = arena_reserve(&arena, 8, 1);
+    u8* const block   = arena_alloc(&arena, 8);
+    u8* const stale   = arena_commit(&arena, 8);
+    assert(pending && block && !stale);
+
+    free(buf);
+    printf("Test `arena_reserve_commit` passed.\n");
+}
+
+// Sub-arenas are cleared independently, and the parent reclaims all of them at once.
+static void arena_sub_lifetimes(void) {
+    usize const  buf_size = 4096;
+    u8*          buf      = (u8*)malloc(buf_size);
+    struct arena parent   = arena_new(buf_size, buf);
+
+    struct alloha_oom_policy const quiet  = {.action = ALLOHA_OOM_RETURN_NULL, .quiet = true};
+    struct arena_budget            budget = {.limit = 2048};
+    parent.oom                            = &quiet;
+
+    struct arena first  = arena_sub(&parent, 1024, 64, &budget);
+    struct arena second = arena_sub(&parent, 512, 64, &budget);
+    assert(first.capacity == 1024 && second.capacity == 512 && budget.used == 1536);
+    assert(first.buf + first.capacity <= second.buf);
+
+    u8* kept = arena_alloc(&second, 100);
+    memset(kept, 0x5A, 100);
+    u8* const cleared = arena_alloc(&first, 1000);
+    assert(cleared);
+    arena_clear(&first);
+    for (usize i = 0; i < 100; ++i) {
+        assert(kept[i] == 0x5A);
+    }
+
+    // Nested sub-arenas aren't charged again, their memory already belongs to a charged parent.
+    struct arena nested       = arena_sub(&first, 256, 16, NULL);
+    u8* const    nested_block = arena_alloc(&nested, 64);
+    assert(nested.buf == first.buf && nested_block);
+    usize const nested_tail = arena_sub_end(&first, &nested);
+    assert(nested_tail == 256 - 64 && first.offset == 64);
+    assert(!nested.buf && nested.capacity == 0);
+
+    // The budget refuses sub-arenas over the limit.
+    usize const  offset = parent.offset;
+    struct arena over   = arena_sub(&parent, 1024, 64, &budget);
+    u8* const    none   = arena_alloc(&over, 1);
+    assert(over.capacity == 0 && !none);
+    assert(parent.offset == offset && budget.used == 1536);
+
+    // Ending the last sub-arena gives its unused tail back to the parent and to the budget.
+    usize const second_tail = arena_sub_end(&parent, &second);
+    assert(second_tail == 512 - 100);
+    assert(parent.offset == offset - (512 - 100) && budget.used == 1536 - (512 - 100));
+    assert(kept[0] == 0x5A);
+
+    // Ending a sub-arena that isn't the last block only refunds the budget.
+    usize const first_tail = arena_sub_end(&parent, &first);
+    assert(first_tail == 0);
+    assert(budget.used == 64 + 100);
+
+    struct stack stack = stack_new(buf_size, buf);
+    budget.used        = 0;
+    struct arena block = arena_sub_stack(&stack, 1024, 16, &budget);
+    assert(block.capacity == 1024 && budget.used == 1024);
+    u8* const  whole = arena_alloc(&block, 1024);
+    bool const ended = arena_sub_stack_end(&stack, &block);
+    assert(whole && ended);
+    assert(stack.offset == 0 && budget.used == 0 && !block.buf);
+
+    free(buf);
+    printf("Test `arena_sub_lifetimes` passed.\n");
+}
+
+static void vm_arena_lock_accounting(void) {
+    struct vmem_stats const before = vmem_stats();
+
+    struct vm_arena vm_arena;
+    bool const      mapped = vm_arena_create(&vm_arena, 5 * vmem_page_size() + 1, VM_ARENA_LOCK);
+    assert(mapped);
+    assert(vm_arena.arena.capacity == 6 * vmem_page_size());
+
+    // Locking is subject to the limits of the system, either way the accounting should agree.
+    struct vmem_stats const created = vmem_stats();
+    assert(created.mapped_bytes == before.mapped_bytes + vm_arena.arena.capacity);
+    if (vm_arena.locked_bytes != 0) {
+        assert(vm_arena.locked_bytes == vm_arena.arena.capacity);
+        assert(created.locked_bytes == before.locked_bytes + vm_arena.locked_bytes);
+    } else {
+        assert(created.lock_failures == before.lock_failures + 1);
+    }
+
+    u8* mem = arena_alloc(&vm_arena.arena, vm_arena.arena.capacity / 2);
+    assert(mem);
+    memset(mem, 0xAB, vm_arena.arena.capacity / 2);
+
+    vm_arena_destroy(&vm_arena);
+    assert(!vm_arena.arena.buf && vm_arena.locked_bytes == 0);
+
+    struct vmem_stats const destroyed = vmem_stats();
+    assert(destroyed.mapped_bytes == before.mapped_bytes);
+    assert(destroyed.locked_bytes == before.locked_bytes);
+
+    printf("Test `vm_arena_lock_accounting` passed.\n");
+}
+
 static void test_arena(void) {
     arena_memory_not_owned();
     arena_check_offsets();
+    arena_prefault_keeps_state();
+    arena_reserve_commit();
+    arena_sub_lifetimes();
+    vm_arena_lock_accounting();
 }
 
 #if !defined(ALLOHA_TEST_NO_MAIN)
@@ -0,0 +1,316 @@
+/// Concurrency stress harness for the thread-safe allocators.
+///
+/// The harness runs randomized alloc/release workloads from several threads against an allocator
+/// described by `struct concurrent_allocator`. Each thread stamps the blocks it owns with an
+/// ownership tag (thread index and allocation serial), and checks that the tag is intact right
+/// before releasing the block: a block handed out twice gets its tag overwritten by the second
+/// owner. After all threads finish, the harness checks that every block went back to the
+/// allocator, so that no block was lost.
+///
+/// The harness is meant to be run in the ThreadSanitizer configuration of the test matrix (see
+/// `lua build.lua matrix`), compiled with `ALLOHA_STRESS_SCHEDULE` so that the code annotated with
+/// `ALLOHA_SCHED_POINT()` gets random yields and delays injected. Any concurrent allocator added to
+/// the library should have its workload registered in `test_concurrency`.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/arena.h>
+#include <alloha/core.h>
+#include <alloha/fiber_stack.h>
+#include <alloha/oom.h>
+#include <alloha/thread.h>
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CONCURRENCY_THREAD_COUNT    8
+#define CONCURRENCY_ITERATIONS      20000
+#define CONCURRENCY_MAX_HELD_BLOCKS 16
+#define CONCURRENCY_TAG_FREE        0
+
+/// Fixed block size allocator interface exercised by the harness.
+struct concurrent_allocator {
+    void* self;
+    usize block_size;   ///< Size, in bytes, of each block. Should be a multiple of `sizeof(u64)`.
+    usize block_count;  ///< Total number of blocks managed by the allocator.
+
+    /// Acquire a block, may return null if the allocator is exhausted.
+    u8* (*acquire)(void* self);
+
+    /// Give a block back to the allocator.
+    void (*release)(void* self, u8* block);
+
+    /// Number of blocks currently available for acquisition, called only when the allocator is
+    /// quiescent.
+    usize (*available)(void* self);
+};
+
+struct concurrency_run {
+    struct concurrent_allocator const* allocator;
+    atomic_uint                        double_allocations;
+    atomic_ulong                       acquired;
+    atomic_ulong                       released;
+};
+
+struct concurrency_worker {
+    struct concurrency_run* run;
+    u32                     idx;
+};
+
+static u64 concurrency_tag(u32 thread_idx, u64 serial) {
+    return ((u64)(thread_idx + 1) << 40) | (serial & 0xffffffffffULL);
+}
+
+static void concurrency_stamp(u8* block, usize block_size, u64 tag) {
+    for (usize w = 0; w < block_size / sizeof(u64); ++w) {
+        memcpy(block + w * sizeof(u64), &tag, sizeof(u64));
+    }
+}
+
+static bool concurrency_tag_intact(u8 const* block, usize block_size, u64 tag) {
+    for (usize w = 0; w < block_size / sizeof(u64); ++w) {
+        u64 word;
+        memcpy(&word, block + w * sizeof(u64), sizeof(u64));
+        if (word != tag) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int concurrency_worker_main(void* arg) {
+    struct concurrency_worker const*   worker    = (struct concurrency_worker const*)arg;
+    struct concurrency_run*            run       = worker->run;
+    struct concurrent_allocator const* allocator = run->allocator;
+
+    u8* held[CONCURRENCY_MAX_HELD_BLOCKS];
+    u64 held_tags[CONCURRENCY_MAX_HELD_BLOCKS];
+    u32 held_count = 0;
+    u64 serial     = 0;
+    u64 rng        = 0x9e3779b97f4a7c15ULL * (worker->idx + 1);
+
+    for (u32 it = 0; it < CONCURRENCY_ITERATIONS || held_count != 0; ++it) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+
+        bool const finishing    = (it >= CONCURRENCY_ITERATIONS);
+        bool const want_acquire = !finishing && (held_count == 0 ||
+                                                 (held_count < CONCURRENCY_MAX_HELD_BLOCKS &&
+                                                  (rng & 1) == 0));
+        if (want_acquire) {
+            u8* block = allocator->acquire(allocator->self);
+            if (!block) {
+                continue;
+            }
+            atomic_fetch_add_explicit(&run->acquired, 1, memory_order_relaxed);
+
+            u64 const tag = concurrency_tag(worker->idx, ++serial);
+            concurrency_stamp(block, allocator->block_size, tag);
+            held[held_count]      = block;
+            held_tags[held_count] = tag;
+            ++held_count;
+        } else {
+            u32 const pick = (u32)((rng >> 8) % held_count);
+            u8*       block = held[pick];
+
+            ALLOHA_SCHED_POINT();
+            if (!concurrency_tag_intact(block, allocator->block_size, held_tags[pick])) {
+                atomic_fetch_add_explicit(&run->double_allocations, 1, memory_order_relaxed);
+            }
+            concurrency_stamp(block, allocator->block_size, CONCURRENCY_TAG_FREE);
+            allocator->release(allocator->self, block);
+            atomic_fetch_add_explicit(&run->released, 1, memory_order_relaxed);
+
+            --held_count;
+            held[pick]      = held[held_count];
+            held_tags[pick] = held_tags[held_count];
+        }
+    }
+    return 0;
+}
+
+/// Run the randomized workload against `allocator` and check its invariants.
+///
+/// Return: Whether the allocator passed.
+static bool concurrency_stress(char const* name, struct concurrent_allocator const* allocator) {
+    struct concurrency_run run = {.allocator = allocator};
+    atomic_init(&run.double_allocations, 0);
+    atomic_init(&run.acquired, 0);
+    atomic_init(&run.released, 0);
+
+    struct alloha_thread      threads[CONCURRENCY_THREAD_COUNT];
+    struct concurrency_worker workers[CONCURRENCY_THREAD_COUNT];
+    for (u32 t = 0; t < CONCURRENCY_THREAD_COUNT; ++t) {
+        workers[t]   = (struct concurrency_worker){.run = &run, .idx = t};
+        bool created = alloha_thread_create(&threads[t], concurrency_worker_main, &workers[t]);
+        assert(created);
+    }
+    for (u32 t = 0; t < CONCURRENCY_THREAD_COUNT; ++t) {
+        alloha_discard(alloha_thread_join(&threads[t]));
+    }
+
+    bool          passed             = true;
+    u32 const     double_allocations = atomic_load(&run.double_allocations);
+    usize const   available          = allocator->available(allocator->self);
+    unsigned long acquired           = atomic_load(&run.acquired);
+    unsigned long released           = atomic_load(&run.released);
+    if (double_allocations != 0) {
+        fprintf(
+            stderr,
+            "%s: %u blocks were owned by two threads at once.\n",
+            name,
+            double_allocations);
+        passed = false;
+    }
+    if (acquired != released || available != allocator->block_count) {
+        fprintf(
+            stderr,
+            "%s: lost blocks, %zu of %zu available after %lu acquisitions and %lu releases.\n",
+            name,
+            (size_t)available,
+            (size_t)allocator->block_count,
+            acquired,
+            released);
+        passed = false;
+    }
+    return passed;
+}
+
+// -----------------------------------------------------------------------------
+// Locked block pool.
+//
+// Reference subject of the harness: blocks carved from an arena, recycled through a free list
+// guarded by a mutex.
+// -----------------------------------------------------------------------------
+
+#define LOCKED_POOL_BLOCK_SIZE  64
+#define LOCKED_POOL_BLOCK_COUNT 96
+
+struct locked_pool {
+    struct alloha_mutex lock;
+    u8*                 free_blocks[LOCKED_POOL_BLOCK_COUNT];
+    usize               free_count;
+};
+
+static u8* locked_pool_acquire(void* self) {
+    struct locked_pool* pool  = (struct locked_pool*)self;
+    u8*                 block = NULL;
+    alloha_mutex_lock(&pool->lock);
+    usize const free_count = pool->free_count;
+    if (free_count != 0) {
+        block = pool->free_blocks[free_count - 1];
+        ALLOHA_SCHED_POINT();
+        pool->free_count = free_count - 1;
+    }
+    alloha_mutex_unlock(&pool->lock);
+    return block;
+}
+
+static void locked_pool_release(void* self, u8* block) {
+    struct locked_pool* pool = (struct locked_pool*)self;
+    alloha_mutex_lock(&pool->lock);
+    usize const free_count = pool->free_count;
+    ALLOHA_SCHED_POINT();
+    pool->free_blocks[free_count] = block;
+    pool->free_count              = free_count + 1;
+    alloha_mutex_unlock(&pool->lock);
+}
+
+static usize locked_pool_available(void* self) {
+    return ((struct locked_pool*)self)->free_count;
+}
+
+static void concurrency_locked_pool(void) {
+    usize const  buf_size = LOCKED_POOL_BLOCK_SIZE * LOCKED_POOL_BLOCK_COUNT;
+    u8*          buf      = (u8*)malloc(buf_size);
+    struct arena arena    = arena_new(buf_size, buf);
+
+    struct locked_pool pool;
+    alloha_mutex_init(&pool.lock);
+    pool.free_count = 0;
+    for (usize b = 0; b < LOCKED_POOL_BLOCK_COUNT; ++b) {
+        pool.free_blocks[pool.free_count++] = arena_alloc(&arena, LOCKED_POOL_BLOCK_SIZE);
+    }
+
+    struct concurrent_allocator const allocator = {
+        .self        = &pool,
+        .block_size  = LOCKED_POOL_BLOCK_SIZE,
+        .block_count = LOCKED_POOL_BLOCK_COUNT,
+        .acquire     = locked_pool_acquire,
+        .release     = locked_pool_release,
+        .available   = locked_pool_available,
+    };
+    bool const passed = concurrency_stress("concurrency_locked_pool", &allocator);
+
+    alloha_mutex_destroy(&pool.lock);
+    free(buf);
+    assert(passed);
+    printf("Test `concurrency_locked_pool` passed.\n");
+}
+
+// -----------------------------------------------------------------------------
+// Fiber stack pool.
+//
+// Only the bottom of each stack is stamped, the whole stack being released on every release.
+// -----------------------------------------------------------------------------
+
+#define FIBER_POOL_STAMP_SIZE  256
+#define FIBER_POOL_STACK_COUNT 96
+
+static u8* fiber_pool_acquire(void* self) {
+    return fiber_stack_acquire((struct fiber_stack_pool*)self).base;
+}
+
+static void fiber_pool_release(void* self, u8* block) {
+    struct fiber_stack_pool* pool = (struct fiber_stack_pool*)self;
+    fiber_stack_release(pool, (struct fiber_stack){.base = block, .size = pool->config.stack_size});
+}
+
+static usize fiber_pool_available(void* self) {
+    return fiber_stack_pool_available((struct fiber_stack_pool*)self);
+}
+
+static void concurrency_fiber_stack_pool(void) {
+    struct fiber_stack_config const config = {
+        .stack_size = 2 * FIBER_POOL_STAMP_SIZE,
+        .max_stacks = FIBER_POOL_STACK_COUNT,
+        .lazy       = true,
+    };
+    struct fiber_stack_pool pool;
+    bool const              created = fiber_stack_pool_create(&pool, config);
+    assert(created);
+
+    // Running out of stacks is expected, and shouldn't be reported.
+    struct alloha_oom_policy const quiet = {.action = ALLOHA_OOM_RETURN_NULL, .quiet = true};
+    pool.oom                             = &quiet;
+
+    struct concurrent_allocator const allocator = {
+        .self        = &pool,
+        .block_size  = FIBER_POOL_STAMP_SIZE,
+        .block_count = FIBER_POOL_STACK_COUNT,
+        .acquire     = fiber_pool_acquire,
+        .release     = fiber_pool_release,
+        .available   = fiber_pool_available,
+    };
+    bool const passed = concurrency_stress("concurrency_fiber_stack_pool", &allocator);
+
+    fiber_stack_pool_destroy(&pool);
+    assert(passed);
+    printf("Test `concurrency_fiber_stack_pool` passed.\n");
+}
+
+static void test_concurrency(void) {
+    concurrency_locked_pool();
+    concurrency_fiber_stack_pool();
+}
+
+#if !defined(ALLOHA_TEST_NO_MAIN)
+int main(void) {
+    test_concurrency();
+    return 0;
+}
+#endif
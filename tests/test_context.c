@@ -0,0 +1,140 @@
+/// Thread-local allocator context tests.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/context.h>
+
+#include <alloha/arena.h>
+#include <alloha/core.h>
+#include <alloha/oom.h>
+#include <alloha/stack.h>
+#include <alloha/thread.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/// Library code oblivious of the allocator in use.
+static u32* context_make_sequence(u32 count) {
+    u32* seq = (u32*)alloha_ctx_alloc_aligned(count * sizeof(u32), alloha_alignof(u32));
+    if (seq) {
+        for (u32 i = 0; i < count; ++i) {
+            seq[i] = i;
+        }
+    }
+    return seq;
+}
+
+static void context_push_pop_nesting(void) {
+    u8           arena_buf[512];
+    u8           stack_buf[512];
+    struct arena arena = arena_new(sizeof(arena_buf), arena_buf);
+    struct stack stack = stack_new(sizeof(stack_buf), stack_buf);
+
+    // Without any allocator installed, allocations fail.
+    struct alloha_oom_policy const quiet = {.action = ALLOHA_OOM_RETURN_NULL, .quiet = true};
+    alloha_clear_error();
+    assert(!alloha_current_allocator().allocator);
+    u8* const orphan = alloha_ctx_alloc(8);
+    assert(!orphan && alloha_last_error() == ALLOHA_ERROR_OUT_OF_MEMORY);
+
+    bool const arena_pushed = alloha_push_allocator(alloha_arena_allocator(&arena));
+    assert(arena_pushed);
+    u32* seq = context_make_sequence(10);
+    assert(seq && (u8*)seq == arena_buf && arena.offset == 10 * sizeof(u32));
+
+    bool const stack_pushed = alloha_push_allocator(alloha_stack_allocator(&stack));
+    assert(stack_pushed);
+    u32* inner = context_make_sequence(4);
+    assert(inner && (u8*)inner > stack_buf && (u8*)inner < stack_buf + sizeof(stack_buf));
+    assert(arena.offset == 10 * sizeof(u32));
+    alloha_pop_allocator();
+
+    // The arena is restored, along with its own failure policy.
+    arena.oom = &quiet;
+    assert(alloha_current_allocator().allocator == &arena);
+    u8* const  too_large = alloha_ctx_alloc(sizeof(arena_buf));
+    u32* const next      = context_make_sequence(4);
+    assert(!too_large && next == seq + 10);
+    alloha_pop_allocator();
+    u8* const popped = alloha_ctx_alloc(8);
+    assert(!popped);
+
+    // The depth of the context is bounded.
+    u32 depth = 0;
+    while (alloha_push_allocator(alloha_arena_allocator(&arena))) {
+        ++depth;
+    }
+    assert(depth == ALLOHA_CONTEXT_MAX_DEPTH);
+    for (u32 i = 0; i < depth; ++i) {
+        alloha_pop_allocator();
+    }
+
+    printf("Test `context_push_pop_nesting` passed.\n");
+}
+
+struct context_worker {
+    struct arena arena;
+    u8*          first;
+    bool         inherited;
+};
+
+static int context_worker_run(void* arg) {
+    struct context_worker* worker = (struct context_worker*)arg;
+    worker->inherited             = alloha_current_allocator().allocator != NULL;
+    if (alloha_push_allocator(alloha_arena_allocator(&worker->arena))) {
+        for (u32 i = 0; i < 1000; ++i) {
+            alloha_thread_yield();
+            u8* block = alloha_ctx_alloc(16);
+            if (i == 0) {
+                worker->first = block;
+            }
+        }
+        alloha_pop_allocator();
+    }
+    return 0;
+}
+
+// Each thread has its own context, so threads never allocate from the arena of another.
+static void context_threads_independent(void) {
+    usize const buf_size = 64 * 1024;
+    u8*         buf      = (u8*)malloc(2 * buf_size);
+
+    u8           outer_buf[64];
+    struct arena outer  = arena_new(sizeof(outer_buf), outer_buf);
+    bool const   pushed = alloha_push_allocator(alloha_arena_allocator(&outer));
+    assert(pushed);
+
+    struct context_worker workers[2] = {
+        {.arena = arena_new(buf_size, buf)},
+        {.arena = arena_new(buf_size, buf + buf_size)},
+    };
+    struct alloha_thread threads[2];
+    for (u32 i = 0; i < 2; ++i) {
+        bool const created = alloha_thread_create(&threads[i], context_worker_run, &workers[i]);
+        assert(created);
+    }
+    for (u32 i = 0; i < 2; ++i) {
+        alloha_thread_join(&threads[i]);
+        assert(!workers[i].inherited);
+        assert(workers[i].first == workers[i].arena.buf);
+        assert(workers[i].arena.offset == 1000 * 16);
+    }
+
+    assert(alloha_current_allocator().allocator == &outer && outer.offset == 0);
+    alloha_pop_allocator();
+
+    free(buf);
+    printf("Test `context_threads_independent` passed.\n");
+}
+
+static void test_context(void) {
+    context_push_pop_nesting();
+    context_threads_independent();
+}
+
+#if !defined(ALLOHA_TEST_NO_MAIN)
+int main(void) {
+    test_context();
+    return 0;
+}
+#endif
@@ -0,0 +1,197 @@
+/// Coroutine frame allocation tests.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+// Small enough for the deep chains below to overflow both the stack and the pool.
+#define ALLOHA_CORO_STACK_CAPACITY ((usize)16 << 10)
+#define ALLOHA_CORO_POOL_CAPACITY  ((usize)16 << 10)
+
+#include <alloha/coro.hpp>
+
+#include <alloha/core.h>
+#include <cassert>
+#include <coroutine>
+#include <cstdio>
+#include <exception>
+#include <utility>
+
+/// Lazily started task, resuming its awaiter on completion via symmetric transfer.
+struct task {
+    struct promise_type : alloha::frame_promise {
+        u64                     value = 0;
+        std::coroutine_handle<> continuation;
+
+        task get_return_object() {
+            return task{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        auto final_suspend() noexcept {
+            struct final_awaiter {
+                bool await_ready() noexcept {
+                    return false;
+                }
+                std::coroutine_handle<> await_suspend(
+                    std::coroutine_handle<promise_type> handle) noexcept {
+                    auto continuation = handle.promise().continuation;
+                    return continuation ? continuation : std::noop_coroutine();
+                }
+                void await_resume() noexcept {}
+            };
+            return final_awaiter{};
+        }
+
+        void return_value(u64 result) {
+            value = result;
+        }
+
+        void unhandled_exception() {
+            std::terminate();
+        }
+    };
+
+    explicit task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+    task(task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    task(task const&) = delete;
+
+    ~task() {
+        reset();
+    }
+
+    void reset() {
+        if (handle) {
+            std::exchange(handle, nullptr).destroy();
+        }
+    }
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+        handle.promise().continuation = awaiter;
+        return handle;
+    }
+
+    u64 await_resume() const noexcept {
+        return handle.promise().value;
+    }
+
+    /// Run the task to completion from synchronous code.
+    u64 run() {
+        handle.resume();
+        assert(handle.done() && "task suspended without completing");
+        return handle.promise().value;
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+static task coro_sum_to(u32 depth) {
+    if (depth == 0) {
+        co_return 0;
+    }
+    co_return depth + co_await coro_sum_to(depth - 1);
+}
+
+static task coro_constant(u64 value) {
+    co_return value;
+}
+
+static void coro_chain_uses_stack(void) {
+    alloha::frame_allocator&  allocator = alloha::frame_allocator::current();
+    alloha::frame_stats const before    = allocator.stats();
+
+    u32 const depth = 32;
+    {
+        task root = coro_sum_to(depth);
+        assert(root.run() == (u64)depth * (depth + 1) / 2);
+
+        // Only the root frame is left, the nested ones were popped as each call returned.
+        assert(allocator.stack_used() != 0);
+    }
+    assert(allocator.stack_used() == 0);
+
+    alloha::frame_stats const after = allocator.stats();
+    assert(after.stack_frames - before.stack_frames == depth + 1);
+    assert(after.pool_frames == before.pool_frames && after.heap_frames == before.heap_frames);
+    assert(after.deferred_pops == before.deferred_pops);
+
+    printf("Test `coro_chain_uses_stack` passed.\n");
+}
+
+static void coro_out_of_order_destruction(void) {
+    alloha::frame_allocator&  allocator = alloha::frame_allocator::current();
+    alloha::frame_stats const before    = allocator.stats();
+
+    task first  = coro_constant(1);
+    task second = coro_constant(2);
+    task third  = coro_constant(3);
+    usize const used = allocator.stack_used();
+
+    // Destroying frames below the top only marks them as dead.
+    first.reset();
+    second.reset();
+    assert(allocator.stack_used() == used);
+    assert(allocator.stats().deferred_pops - before.deferred_pops == 2);
+
+    // The dead frames are popped along with the one on top.
+    assert(third.run() == 3);
+    third.reset();
+    assert(allocator.stack_used() == 0);
+
+    // A frame pushed over a dead one is popped normally.
+    task lower = coro_constant(4);
+    task upper = coro_constant(5);
+    lower.reset();
+    task top = coro_constant(6);
+    top.reset();
+    upper.reset();
+    assert(allocator.stack_used() == 0);
+    assert(allocator.stats().deferred_pops - before.deferred_pops == 3);
+
+    printf("Test `coro_out_of_order_destruction` passed.\n");
+}
+
+static void coro_overflow_falls_back(void) {
+    alloha::frame_allocator&  allocator = alloha::frame_allocator::current();
+    alloha::frame_stats const before    = allocator.stats();
+
+    // Far more frames than the stack and the pool can hold.
+    u32 const depth = 1024;
+    for (u32 round = 0; round < 2; ++round) {
+        task root = coro_sum_to(depth);
+        assert(root.run() == (u64)depth * (depth + 1) / 2);
+    }
+    assert(allocator.stack_used() == 0);
+
+    alloha::frame_stats const after = allocator.stats();
+    u64 const frames = (after.stack_frames - before.stack_frames) +
+                       (after.pool_frames - before.pool_frames) +
+                       (after.heap_frames - before.heap_frames);
+    assert(frames == 2 * (depth + 1));
+    assert(after.pool_frames > before.pool_frames && after.heap_frames > before.heap_frames);
+
+    // With the stack free again, frames go back to it.
+    task root = coro_sum_to(8);
+    assert(root.run() == 36);
+    assert(allocator.stats().stack_frames - after.stack_frames == 9);
+
+    printf("Test `coro_overflow_falls_back` passed.\n");
+}
+
+static void test_coro(void) {
+    coro_chain_uses_stack();
+    coro_out_of_order_destruction();
+    coro_overflow_falls_back();
+}
+
+#if !defined(ALLOHA_TEST_NO_MAIN)
+int main(void) {
+    test_coro();
+    return 0;
+}
+#endif
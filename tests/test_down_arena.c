@@ -0,0 +1,131 @@
+/// Bump-down arena allocator tests.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/down_arena.h>
+
+#include <alloha/core.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void down_arena_bumps_downwards(void) {
+    // The buffer is aligned to 16 bytes, but not to 32 bytes.
+    _Alignas(64) static u8 storage[1024 + 64];
+    usize const            buf_size = 1024;
+    u8*                    buf      = storage + 16;
+
+    struct down_arena arena = down_arena_new(buf_size, buf);
+    assert(down_arena_used(&arena) == 0);
+
+    // Blocks are carved from the end of the buffer, aligned down.
+    u8* first = down_arena_alloc_aligned(&arena, 10, 1);
+    assert(first == buf + buf_size - 10);
+    u8* second = down_arena_alloc_aligned(&arena, 24, 16);
+    assert(((uptr)second & 15) == 0);
+    assert(second + 24 <= first && first - (second + 24) < 16);
+    assert(down_arena_used(&arena) == (usize)(buf + buf_size - second));
+    memset(first, 0xAA, 10);
+    memset(second, 0xBB, 24);
+
+    // Allocations that don't fit, by size or by alignment, leave the arena untouched.
+    u8* const top        = arena.top;
+    u8* const too_large  = down_arena_alloc(&arena, buf_size);
+    u8* const misaligned = down_arena_alloc_aligned(&arena, (usize)(top - buf) - 1, 32);
+    assert(!too_large && !misaligned && arena.top == top);
+
+    // The whole remaining space can be allocated.
+    u8* rest = down_arena_alloc_aligned(&arena, (usize)(top - buf), 1);
+    assert(rest == buf && down_arena_used(&arena) == buf_size);
+    u8* const exhausted = down_arena_alloc_aligned(&arena, 1, 1);
+    assert(!exhausted);
+
+    down_arena_clear(&arena);
+    assert(down_arena_used(&arena) == 0);
+
+    printf("Test `down_arena_bumps_downwards` passed.\n");
+}
+
+static void down_arena_realloc_keeps_contents(void) {
+    usize const       buf_size = 1024;
+    u8*               buf      = (u8*)malloc(buf_size);
+    struct down_arena arena    = down_arena_new(buf_size, buf);
+
+    u8* other = down_arena_alloc(&arena, 32);
+    memset(other, 0x11, 32);
+
+    // The last block grows in place, downwards.
+    u8* block = down_arena_alloc(&arena, 64);
+    for (u8 i = 0; i < 64; ++i) {
+        block[i] = i;
+    }
+    u8* const used_top = arena.top;
+    u8*       grown    = down_arena_realloc(&arena, block, 64, 128, ALLOHA_DEFAULT_ALIGNMENT);
+    assert(grown && grown == used_top - 64);
+    for (u8 i = 0; i < 64; ++i) {
+        assert(grown[i] == i);
+    }
+
+    // Shrinking keeps the block.
+    u8* const shrunk = down_arena_realloc(&arena, grown, 128, 16, ALLOHA_DEFAULT_ALIGNMENT);
+    assert(shrunk == grown);
+
+    // Blocks other than the last one are copied.
+    u8* moved = down_arena_realloc(&arena, other, 32, 48, ALLOHA_DEFAULT_ALIGNMENT);
+    assert(moved && moved < grown);
+    for (usize i = 0; i < 32; ++i) {
+        assert(moved[i] == 0x11);
+    }
+    for (u8 i = 0; i < 64; ++i) {
+        assert(grown[i] == i);
+    }
+
+    // Free memory isn't a valid block.
+    u8* const invalid = down_arena_realloc(&arena, buf, 8, 16, ALLOHA_DEFAULT_ALIGNMENT);
+    assert(!invalid);
+
+    free(buf);
+    printf("Test `down_arena_realloc_keeps_contents` passed.\n");
+}
+
+static void down_arena_scratch_rollback(void) {
+    usize const       buf_size = 512;
+    u8*               buf      = (u8*)malloc(buf_size);
+    struct down_arena arena    = down_arena_new(buf_size, buf);
+
+    u8* const kept = down_arena_alloc(&arena, 100);
+    u8* const top  = arena.top;
+    assert(kept);
+    {
+        struct scratch_down_arena scratch = scratch_down_arena_start(&arena);
+        u8* const                 block   = down_arena_alloc(&arena, 200);
+        assert(block);
+        {
+            struct scratch_down_arena nested       = scratch_down_arena_start(&arena);
+            u8* const                 nested_block = down_arena_alloc(&arena, 50);
+            assert(nested_block);
+            scratch_down_arena_end(&nested);
+        }
+        assert(down_arena_used(&arena) > 300);
+        scratch_down_arena_end(&scratch);
+        assert(!scratch.parent);
+    }
+    assert(arena.top == top);
+
+    free(buf);
+    printf("Test `down_arena_scratch_rollback` passed.\n");
+}
+
+static void test_down_arena(void) {
+    down_arena_bumps_downwards();
+    down_arena_realloc_keeps_contents();
+    down_arena_scratch_rollback();
+}
+
+#if !defined(ALLOHA_TEST_NO_MAIN)
+int main(void) {
+    test_down_arena();
+    return 0;
+}
+#endif
@@ -0,0 +1,132 @@
+/// Fiber stack allocator tests.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/fiber_stack.h>
+
+#include <alloha/core.h>
+#include <alloha/oom.h>
+#include <alloha/vmem.h>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__linux__)
+#    include <sys/wait.h>
+#    include <unistd.h>
+#endif
+
+static void fiber_stack_pool_recycles(void) {
+    usize const               page_size = vmem_page_size();
+    struct fiber_stack_config config    = {.stack_size = 3 * page_size + 1, .max_stacks = 4};
+    struct fiber_stack_pool   pool;
+    bool const                created = fiber_stack_pool_create(&pool, config);
+    assert(created);
+    assert(pool.slot_size == 5 * page_size && fiber_stack_pool_available(&pool) == 4);
+
+    // Stacks are whole pages, each right above its guard.
+    struct fiber_stack first  = fiber_stack_acquire(&pool);
+    struct fiber_stack second = fiber_stack_acquire(&pool);
+    assert(first.base == pool.base + page_size && first.size == 4 * page_size);
+    assert(second.base == first.base + pool.slot_size);
+    memset(first.base, 0x7E, first.size);
+    memset(second.base, 0x7F, second.size);
+
+#if defined(__linux__)
+    // Overflowing the stack faults on its guard. The report of sanitizers, if any, is silenced.
+    pid_t const child = fork();
+    if (child == 0) {
+        close(STDERR_FILENO);
+        *(u8 volatile*)(second.base - 1) = 1;
+        _exit(0);
+    }
+    int         status = 0;
+    pid_t const waited = waitpid(child, &status, 0);
+    assert(waited == child);
+    assert(!WIFEXITED(status) || WEXITSTATUS(status) != 0);
+#endif
+
+    // Released stacks are recycled first, with their memory released.
+    fiber_stack_release(&pool, first);
+    assert(fiber_stack_pool_available(&pool) == 3);
+    struct fiber_stack again = fiber_stack_acquire(&pool);
+    assert(again.base == first.base && again.base[0] == 0 && again.base[again.size - 1] == 0);
+    assert(second.base[0] == 0x7F);
+
+    // Running out of slots applies the failure policy.
+    struct alloha_oom_policy const quiet = {.action = ALLOHA_OOM_RETURN_NULL, .quiet = true};
+    pool.oom                             = &quiet;
+    struct fiber_stack third             = fiber_stack_acquire(&pool);
+    struct fiber_stack fourth            = fiber_stack_acquire(&pool);
+    assert(third.base && fourth.base);
+    alloha_clear_error();
+    struct fiber_stack const fifth = fiber_stack_acquire(&pool);
+    assert(!fifth.base);
+    assert(alloha_last_error() == ALLOHA_ERROR_OUT_OF_MEMORY);
+
+    // Stacks not handed out by the pool are rejected.
+    alloha_clear_error();
+    fiber_stack_release(&pool, (struct fiber_stack){.base = first.base + 8, .size = first.size});
+    assert(alloha_last_error() == ALLOHA_ERROR_INVALID_BLOCK);
+
+    fiber_stack_release(&pool, again);
+    fiber_stack_release(&pool, second);
+    fiber_stack_release(&pool, third);
+    fiber_stack_release(&pool, fourth);
+    assert(fiber_stack_pool_available(&pool) == 4);
+
+    fiber_stack_pool_destroy(&pool);
+    assert(!pool.base);
+    printf("Test `fiber_stack_pool_recycles` passed.\n");
+}
+
+static void fiber_stack_cache_batches(void) {
+    struct fiber_stack_config config = {.stack_size = 1, .max_stacks = 64, .lazy = true};
+    struct fiber_stack_pool   pool;
+    bool const                created = fiber_stack_pool_create(&pool, config);
+    assert(created);
+
+    struct fiber_stack_cache cache;
+    fiber_stack_cache_init(&cache, &pool);
+
+    // The cache is refilled in batches.
+    struct fiber_stack stacks[40];
+    stacks[0] = fiber_stack_cache_acquire(&cache);
+    assert(stacks[0].base && cache.count == FIBER_STACK_CACHE_SIZE / 2 - 1);
+    assert(fiber_stack_pool_available(&pool) == 64 - FIBER_STACK_CACHE_SIZE / 2);
+    for (u32 i = 1; i < 40; ++i) {
+        stacks[i] = fiber_stack_cache_acquire(&cache);
+        assert(stacks[i].base);
+        stacks[i].base[0] = (u8)i;
+    }
+
+    // Releases go to the cache, overflowing into the pool.
+    for (u32 i = 0; i < 40; ++i) {
+        fiber_stack_cache_release(&cache, stacks[i]);
+        assert(cache.count <= FIBER_STACK_CACHE_SIZE);
+    }
+    assert(fiber_stack_pool_available(&pool) + cache.count == 64);
+
+    // The most recently released stack, still resident, is reused first.
+    struct fiber_stack hot = fiber_stack_cache_acquire(&cache);
+    assert(hot.base == stacks[39].base && hot.base[0] == 39);
+    fiber_stack_cache_release(&cache, hot);
+
+    fiber_stack_cache_flush(&cache);
+    assert(cache.count == 0 && fiber_stack_pool_available(&pool) == 64);
+
+    fiber_stack_pool_destroy(&pool);
+    printf("Test `fiber_stack_cache_batches` passed.\n");
+}
+
+static void test_fiber_stack(void) {
+    fiber_stack_pool_recycles();
+    fiber_stack_cache_batches();
+}
+
+#if !defined(ALLOHA_TEST_NO_MAIN)
+int main(void) {
+    test_fiber_stack();
+    return 0;
+}
+#endif
@@ -0,0 +1,207 @@
+/// Semi-space copying garbage collector tests.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/gc.h>
+
+#include <alloha/core.h>
+#include <alloha/oom.h>
+#include <alloha/vmem.h>
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+
+struct gc_node {
+    struct gc_node* left;
+    u64             value;
+    struct gc_node* right;
+};
+
+static usize const gc_node_pointers[] = {
+    offsetof(struct gc_node, left),
+    offsetof(struct gc_node, right),
+};
+
+static struct gc_type const gc_node_type = {
+    .size            = sizeof(struct gc_node),
+    .pointer_count   = 2,
+    .pointer_offsets = gc_node_pointers,
+};
+
+/// Object without pointers, of a size that isn't a multiple of the alignment.
+static struct gc_type const gc_blob_type = {.size = 40};
+
+static struct gc_node* gc_node_new(struct gc_heap* heap, u64 value) {
+    struct gc_node* node = (struct gc_node*)gc_alloc(heap, &gc_node_type);
+    assert(node && !node->left && !node->right);
+    node->value = value;
+    return node;
+}
+
+/// Build a complete binary tree of the given depth, with each node holding its heap index.
+static struct gc_node* gc_tree_new(struct gc_heap* heap, u32 depth, u64 index) {
+    struct gc_node* node = gc_node_new(heap, index);
+    gc_add_root(heap, &node);
+    if (depth > 1) {
+        // The node may move while its children are allocated, but the root is kept up to date.
+        struct gc_node* left  = gc_tree_new(heap, depth - 1, 2 * index);
+        node->left            = left;
+        struct gc_node* right = gc_tree_new(heap, depth - 1, 2 * index + 1);
+        node->right           = right;
+    }
+    gc_remove_root(heap, &node);
+    return node;
+}
+
+static u64 gc_tree_check(struct gc_node const* node, u32 depth, u64 index) {
+    assert(node->value == index && gc_type_of((u8 const*)node) == &gc_node_type);
+    if (depth == 1) {
+        assert(!node->left && !node->right);
+        return 1;
+    }
+    return 1 + gc_tree_check(node->left, depth - 1, 2 * index) +
+           gc_tree_check(node->right, depth - 1, 2 * index + 1);
+}
+
+static void gc_collect_keeps_reachable(void) {
+    struct gc_heap heap;
+    bool const     created =
+        gc_heap_create(&heap, (struct gc_config){.space_capacity = 1 << 16, .max_roots = 16});
+    assert(created);
+
+    usize const     header_size = sizeof(struct gc_header);
+    usize const     node_size   = align_forward(header_size + sizeof(struct gc_node), GC_ALIGNMENT);
+    struct gc_node* tree        = NULL;
+    bool const      tree_rooted = gc_add_root(&heap, &tree);
+    assert(tree_rooted);
+    tree = gc_tree_new(&heap, 6, 1);
+
+    // Garbage interleaved with a shared node and a cycle.
+    u8* blob = gc_alloc(&heap, &gc_blob_type);
+    assert(blob && ((uptr)blob % GC_ALIGNMENT) == 0);
+    struct gc_node* shared = gc_node_new(&heap, 100);
+    struct gc_node* cycle  = gc_node_new(&heap, 200);
+    for (u32 i = 0; i < 32; ++i) {
+        alloha_discard(gc_node_new(&heap, 0));
+    }
+    cycle->left  = cycle;
+    cycle->right = shared;
+    struct gc_node* pair = gc_node_new(&heap, 300);
+    pair->left           = shared;
+    pair->right          = cycle;
+    bool const pair_rooted = gc_add_root(&heap, &pair);
+    assert(pair_rooted);
+
+    u8* const old_tree = (u8*)tree;
+    gc_collect(&heap);
+    assert(heap.collections == 1 && (u8*)tree != old_tree);
+
+    // Only the 63 nodes of the tree and the 3 nodes of the pair survive, compacted.
+    u64 const tree_nodes = gc_tree_check(tree, 6, 1);
+    assert(tree_nodes == 63);
+    assert(gc_used(&heap) == (63 + 3) * node_size);
+    assert(pair->value == 300 && pair->left->value == 100 && pair->right->value == 200);
+    assert(pair->right->left == pair->right && pair->right->right == pair->left);
+
+    // Objects keep working across collections.
+    gc_remove_root(&heap, &pair);
+    gc_collect(&heap);
+    u64 const collected_tree_nodes = gc_tree_check(tree, 6, 1);
+    assert(collected_tree_nodes == 63 && gc_used(&heap) == 63 * node_size);
+    assert(heap.copied_bytes == (2 * 63 + 3) * node_size);
+
+    // Only registered roots can be removed.
+    alloha_clear_error();
+    gc_remove_root(&heap, &pair);
+    assert(alloha_last_error() == ALLOHA_ERROR_INVALID_BLOCK);
+
+    gc_heap_destroy(&heap);
+    assert(!heap.spaces[0].buf);
+    printf("Test `gc_collect_keeps_reachable` passed.\n");
+}
+
+static void gc_alloc_collects_when_full(void) {
+    usize const    page_size = vmem_page_size();
+    struct gc_heap heap;
+    bool const     created =
+        gc_heap_create(&heap, (struct gc_config){.space_capacity = page_size, .max_roots = 1});
+    assert(created);
+
+    // A list of the last few nodes stays alive, everything else is garbage.
+    struct gc_node* list   = NULL;
+    bool const      rooted = gc_add_root(&heap, &list);
+    assert(rooted);
+    u32 const count = 10000;
+    for (u32 i = 0; i < count; ++i) {
+        struct gc_node* node = gc_node_new(&heap, i);
+        node->left           = list;
+        list                 = node;
+        if (i % 8 == 7) {
+            list->left->left->left->left = NULL;  // Keep the last 4 nodes.
+        }
+    }
+    assert(heap.collections > 0 && gc_used(&heap) <= page_size);
+
+    u32 length = 0;
+    for (struct gc_node const* node = list; node; node = node->left) {
+        assert(node->value == count - 1 - length);
+        ++length;
+    }
+    assert(length == 4);
+
+    // Roots are bounded.
+    struct gc_node* extra        = NULL;
+    bool const      extra_rooted = gc_add_root(&heap, &extra);
+    assert(!extra_rooted);
+
+    gc_heap_destroy(&heap);
+    printf("Test `gc_alloc_collects_when_full` passed.\n");
+}
+
+static void gc_alloc_fails_when_live_exceeds(void) {
+    struct gc_heap heap;
+    bool const     created =
+        gc_heap_create(&heap, (struct gc_config){.space_capacity = 4096, .max_roots = 1});
+    assert(created);
+    struct alloha_oom_policy const policy = {.action = ALLOHA_OOM_RETURN_NULL, .quiet = true};
+    heap.oom                              = &policy;
+
+    // Everything stays reachable, so the heap eventually runs out of memory.
+    struct gc_node* list   = NULL;
+    bool const      rooted = gc_add_root(&heap, &list);
+    assert(rooted);
+    u32 live = 0;
+    alloha_clear_error();
+    for (;;) {
+        struct gc_node* node = (struct gc_node*)gc_alloc(&heap, &gc_node_type);
+        if (!node) {
+            break;
+        }
+        node->left = list;
+        list       = node;
+        ++live;
+    }
+    assert(alloha_last_error() == ALLOHA_ERROR_OUT_OF_MEMORY);
+    assert(live > 0 && gc_used(&heap) + sizeof(struct gc_header) + sizeof(struct gc_node) > 4096);
+
+    // Dropping the list makes room again.
+    list          = NULL;
+    u8* const node = gc_alloc(&heap, &gc_node_type);
+    assert(node);
+
+    gc_heap_destroy(&heap);
+    printf("Test `gc_alloc_fails_when_live_exceeds` passed.\n");
+}
+
+static void test_gc(void) {
+    gc_collect_keeps_reachable();
+    gc_alloc_collects_when_full();
+    gc_alloc_fails_when_live_exceeds();
+}
+
+#if !defined(ALLOHA_TEST_NO_MAIN)
+int main(void) {
+    test_gc();
+    return 0;
+}
+#endif
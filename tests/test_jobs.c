@@ -0,0 +1,188 @@
+/// Work-stealing job system tests.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/jobs.h>
+
+#include <alloha/arena.h>
+#include <alloha/core.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define JOBS_WORKER_COUNT 4
+
+/// Sum of the squares of `1..count`, computed over a temporary array of the scratch arena.
+struct jobs_sum {
+    u32 count;
+    u64 result;
+};
+
+static void jobs_sum_run(void* arg, struct arena* scratch) {
+    struct jobs_sum*   sum    = (struct jobs_sum*)arg;
+    struct job_worker* worker = job_current_worker();
+    assert(worker && scratch == &worker->scratch.arena);
+
+    u64* squares = (u64*)arena_alloc(scratch, sum->count * sizeof(u64));
+    assert(squares);
+    for (u32 i = 0; i < sum->count; ++i) {
+        squares[i] = (u64)(i + 1) * (i + 1);
+    }
+    sum->result = 0;
+    for (u32 i = 0; i < sum->count; ++i) {
+        sum->result += squares[i];
+    }
+}
+
+static u64 jobs_expected_sum(u32 count) {
+    return (u64)count * (count + 1) * (2 * count + 1) / 6;
+}
+
+/// Worker totals, only read once every job is done.
+static u64 jobs_executed(struct job_system const* system) {
+    u64 executed = 0;
+    for (u32 idx = 0; idx < system->config.worker_count; ++idx) {
+        struct job_worker const* worker = &system->workers[idx];
+        assert(worker->scratch.arena.offset == 0 && "scratch not rolled back after a job");
+        executed += worker->executed;
+    }
+    return executed;
+}
+
+static void jobs_run_submitted(void) {
+    struct job_system system;
+    bool const        created =
+        job_system_create(&system, (struct job_config){.worker_count = JOBS_WORKER_COUNT});
+    assert(created);
+    assert(system.config.deque_capacity == JOB_DEQUE_DEFAULT_CAPACITY);
+    assert(!job_current_worker());
+
+    u32 const          count = 1000;
+    struct job*        jobs  = (struct job*)calloc(count, sizeof(struct job));
+    struct jobs_sum*   sums  = (struct jobs_sum*)calloc(count, sizeof(struct jobs_sum));
+    struct job_counter counter;
+    job_counter_init(&counter);
+    for (u32 i = 0; i < count; ++i) {
+        sums[i] = (struct jobs_sum){.count = 1 + i % 500};
+        jobs[i] = (struct job){.fn = jobs_sum_run, .arg = &sums[i], .counter = &counter};
+        job_submit(&system, &jobs[i]);
+    }
+    job_wait(&system, &counter);
+
+    for (u32 i = 0; i < count; ++i) {
+        assert(sums[i].result == jobs_expected_sum(sums[i].count));
+    }
+    u64 const executed = jobs_executed(&system);
+    assert(executed == count);
+
+    job_system_destroy(&system);
+    assert(!system.workers);
+    free(jobs);
+    free(sums);
+    printf("Test `jobs_run_submitted` passed.\n");
+}
+
+/// Job splitting its work into children, waited upon while its own scratch memory stays live.
+struct jobs_parent {
+    struct job_system* system;
+    u32                child_count;
+    u64                result;
+};
+
+static void jobs_parent_run(void* arg, struct arena* scratch) {
+    struct jobs_parent* parent = (struct jobs_parent*)arg;
+
+    usize const      count    = parent->child_count;
+    struct job*      children = (struct job*)arena_alloc(scratch, count * sizeof(*children));
+    struct jobs_sum* sums     = (struct jobs_sum*)arena_alloc(scratch, count * sizeof(*sums));
+    assert(children && sums);
+
+    struct job_counter counter;
+    job_counter_init(&counter);
+    for (u32 i = 0; i < parent->child_count; ++i) {
+        sums[i]     = (struct jobs_sum){.count = 64 + i};
+        children[i] = (struct job){.fn = jobs_sum_run, .arg = &sums[i], .counter = &counter};
+        job_submit(parent->system, &children[i]);
+    }
+
+    // Children run by this worker while waiting allocate above the parent and roll back to it.
+    job_wait(parent->system, &counter);
+
+    parent->result = 0;
+    for (u32 i = 0; i < parent->child_count; ++i) {
+        assert(sums[i].count == 64 + i);
+        parent->result += sums[i].result;
+    }
+}
+
+static void jobs_nested_wait(void) {
+    struct job_config const config = {.worker_count = JOBS_WORKER_COUNT, .deque_capacity = 100};
+    struct job_system       system;
+    bool const              created = job_system_create(&system, config);
+    assert(created && system.config.deque_capacity == 128);
+
+    u32 const          parent_count = 16;
+    u32 const          child_count  = 64;
+    struct job         jobs[16];
+    struct jobs_parent parents[16];
+    struct job_counter counter;
+    job_counter_init(&counter);
+    for (u32 i = 0; i < parent_count; ++i) {
+        parents[i] = (struct jobs_parent){.system = &system, .child_count = child_count};
+        jobs[i]    = (struct job){.fn = jobs_parent_run, .arg = &parents[i], .counter = &counter};
+        job_submit(&system, &jobs[i]);
+    }
+    job_wait(&system, &counter);
+
+    u64 expected = 0;
+    for (u32 i = 0; i < child_count; ++i) {
+        expected += jobs_expected_sum(64 + i);
+    }
+    for (u32 i = 0; i < parent_count; ++i) {
+        assert(parents[i].result == expected);
+    }
+    u64 const executed = jobs_executed(&system);
+    assert(executed == parent_count * (1 + child_count));
+
+    job_system_destroy(&system);
+    printf("Test `jobs_nested_wait` passed.\n");
+}
+
+static void jobs_full_deque_runs_inline(void) {
+    struct job_config const config = {.worker_count = 1, .deque_capacity = 2};
+    struct job_system       system;
+    bool const              created = job_system_create(&system, config);
+    assert(created);
+
+    // With a single worker nothing is stolen, so most children run right away on submission.
+    struct job_counter counter;
+    job_counter_init(&counter);
+    struct jobs_parent parent = {.system = &system, .child_count = 32};
+    struct job         job    = {.fn = jobs_parent_run, .arg = &parent, .counter = &counter};
+    job_submit(&system, &job);
+    job_wait(&system, &counter);
+
+    u64 expected = 0;
+    for (u32 i = 0; i < parent.child_count; ++i) {
+        expected += jobs_expected_sum(64 + i);
+    }
+    u64 const executed = jobs_executed(&system);
+    assert(parent.result == expected && executed == 1 + parent.child_count);
+    assert(system.workers[0].stolen == 0);
+
+    job_system_destroy(&system);
+    printf("Test `jobs_full_deque_runs_inline` passed.\n");
+}
+
+static void test_jobs(void) {
+    jobs_run_submitted();
+    jobs_nested_wait();
+    jobs_full_deque_runs_inline();
+}
+
+#if !defined(ALLOHA_TEST_NO_MAIN)
+int main(void) {
+    test_jobs();
+    return 0;
+}
+#endif
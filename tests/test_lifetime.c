@@ -0,0 +1,291 @@
+/// Object lifetime profiler tests.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/lifetime.h>
+
+#include <alloha/core.h>
+#include <alloha/thread.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LIFETIME_ROUNDS 64
+#define LIFETIME_DEPTH  8
+
+static char const lifetime_lifo_site[]   = "lifo";
+static char const lifetime_batch_site[]  = "batch";
+static char const lifetime_fifo_site[]   = "fifo";
+static char const lifetime_random_site[] = "random";
+static char const lifetime_large_site[]  = "large";
+static char const lifetime_long_site[]   = "long";
+
+/// Find the statistics of a site among those copied from the profile.
+static struct alloha_lifetime_site const* lifetime_find(
+    struct alloha_lifetime_site const* sites,
+    u32                                count,
+    char const*                        name) {
+    for (u32 idx = 0; idx < count; ++idx) {
+        if (strcmp(sites[idx].name, name) == 0) {
+            return &sites[idx];
+        }
+    }
+    return NULL;
+}
+
+/// Keep `LIFETIME_DEPTH` objects of a site alive, replacing one chosen by `pick` at each step.
+static void lifetime_churn(char const* site, usize size, u32 (*pick)(u32 step)) {
+    void* live[LIFETIME_DEPTH];
+    for (u32 idx = 0; idx < LIFETIME_DEPTH; ++idx) {
+        live[idx] = alloha_lifetime_malloc(site, size);
+    }
+
+    // The array is kept in the order of allocation, oldest first.
+    for (u32 step = 0; step < LIFETIME_ROUNDS * LIFETIME_DEPTH; ++step) {
+        u32 const idx = pick(step);
+        alloha_lifetime_free(live[idx]);
+        memmove(&live[idx], &live[idx + 1], (LIFETIME_DEPTH - 1 - idx) * sizeof(void*));
+        live[LIFETIME_DEPTH - 1] = alloha_lifetime_malloc(site, size);
+    }
+    for (u32 idx = 0; idx < LIFETIME_DEPTH; ++idx) {
+        alloha_lifetime_free(live[idx]);
+    }
+}
+
+static u32 lifetime_pick_oldest(u32 step) {
+    alloha_discard(step);
+    return 0;
+}
+
+static u32 lifetime_pick_any(u32 step) {
+    return (step * 2654435761u >> 7) % LIFETIME_DEPTH;
+}
+
+static void lifetime_classifies_sites(void) {
+    bool const started   = alloha_lifetime_start((struct alloha_lifetime_config){0});
+    bool const restarted = alloha_lifetime_start((struct alloha_lifetime_config){0});
+    assert(started && !restarted);
+
+    // Nested scopes.
+    void* objects[LIFETIME_DEPTH];
+    for (u32 round = 0; round < LIFETIME_ROUNDS; ++round) {
+        for (u32 idx = 0; idx < LIFETIME_DEPTH; ++idx) {
+            objects[idx] = alloha_lifetime_malloc(lifetime_lifo_site, 16 + idx);
+        }
+        for (u32 idx = LIFETIME_DEPTH; idx > 0; --idx) {
+            alloha_lifetime_free(objects[idx - 1]);
+        }
+    }
+
+    // Phases releasing their objects all at once, in no particular order.
+    for (u32 round = 0; round < LIFETIME_ROUNDS; ++round) {
+        for (u32 idx = 0; idx < LIFETIME_DEPTH; ++idx) {
+            objects[idx] = alloha_lifetime_malloc(lifetime_batch_site, 32);
+        }
+        for (u32 idx = 0; idx < LIFETIME_DEPTH; ++idx) {
+            alloha_lifetime_free(objects[idx * 3 % LIFETIME_DEPTH]);
+        }
+    }
+
+    lifetime_churn(lifetime_fifo_site, 48, lifetime_pick_oldest);
+    lifetime_churn(lifetime_random_site, 64, lifetime_pick_any);
+    lifetime_churn(lifetime_large_site, 4096, lifetime_pick_any);
+
+    void* long_lived[LIFETIME_ROUNDS];
+    for (u32 idx = 0; idx < LIFETIME_ROUNDS; ++idx) {
+        long_lived[idx] = alloha_lifetime_malloc(lifetime_long_site, 128);
+    }
+
+    struct alloha_lifetime_site sites[8];
+    u32 const                   site_count = alloha_lifetime_sites(sites, 8);
+    assert(site_count == 6);
+
+    struct alloha_lifetime_site const* lifo = lifetime_find(sites, 6, lifetime_lifo_site);
+    assert(lifo && lifo->allocs == LIFETIME_ROUNDS * LIFETIME_DEPTH && lifo->live == 0);
+    assert(lifo->min_size == 16 && lifo->max_size == 16 + LIFETIME_DEPTH - 1);
+    assert(lifo->lifo_frees == lifo->frees);
+
+    // Each round, the object allocated `i`-th lives for `LIFETIME_DEPTH - i` allocations.
+    assert(lifo->lifetime_allocs == LIFETIME_ROUNDS * LIFETIME_DEPTH * (LIFETIME_DEPTH + 1) / 2);
+    assert(alloha_lifetime_pattern_of(lifo) == ALLOHA_LIFETIME_LIFO);
+    assert(strcmp(alloha_lifetime_recommend(lifo), "stack") == 0);
+
+    struct alloha_lifetime_site const* batch = lifetime_find(sites, 6, lifetime_batch_site);
+    assert(batch && batch->batch_frees == batch->frees);
+    assert(alloha_lifetime_pattern_of(batch) == ALLOHA_LIFETIME_BATCH);
+    assert(strcmp(alloha_lifetime_recommend(batch), "arena") == 0);
+
+    struct alloha_lifetime_site const* fifo = lifetime_find(sites, 6, lifetime_fifo_site);
+    assert(fifo && fifo->fifo_frees == fifo->frees);
+    assert(alloha_lifetime_pattern_of(fifo) == ALLOHA_LIFETIME_FIFO);
+    assert(strcmp(alloha_lifetime_recommend(fifo), "recycle_arena") == 0);
+
+    struct alloha_lifetime_site const* random = lifetime_find(sites, 6, lifetime_random_site);
+    assert(random && alloha_lifetime_pattern_of(random) == ALLOHA_LIFETIME_RANDOM);
+    assert(strcmp(alloha_lifetime_recommend(random), "recycle_arena") == 0);
+
+    // Blocks too large to be recycled.
+    struct alloha_lifetime_site const* large = lifetime_find(sites, 6, lifetime_large_site);
+    assert(large && alloha_lifetime_pattern_of(large) == ALLOHA_LIFETIME_RANDOM);
+    assert(strcmp(alloha_lifetime_recommend(large), "malloc") == 0);
+
+    struct alloha_lifetime_site const* long_site = lifetime_find(sites, 6, lifetime_long_site);
+    assert(long_site && long_site->frees == 0 && long_site->live == LIFETIME_ROUNDS);
+    assert(alloha_lifetime_pattern_of(long_site) == ALLOHA_LIFETIME_LONG_LIVED);
+    assert(strcmp(alloha_lifetime_recommend(long_site), "arena") == 0);
+
+    struct alloha_lifetime_stats const stats = alloha_lifetime_stats();
+    assert(stats.sites == 6 && stats.live == LIFETIME_ROUNDS);
+    assert(stats.dropped_allocs == 0 && stats.untracked_frees == 0);
+
+    alloha_lifetime_stop();
+    for (u32 idx = 0; idx < LIFETIME_ROUNDS; ++idx) {
+        alloha_lifetime_free(long_lived[idx]);
+    }
+    printf("Test `lifetime_classifies_sites` passed.\n");
+}
+
+static void lifetime_report_and_limits(void) {
+    bool const started =
+        alloha_lifetime_start((struct alloha_lifetime_config){.max_live = 4, .max_sites = 1});
+    assert(started);
+
+    // Objects beyond the limits are left untracked, and so are their releases.
+    void* objects[6];
+    for (u32 idx = 0; idx < 6; ++idx) {
+        objects[idx] = alloha_lifetime_malloc(ALLOHA_LIFETIME_SITE, 24);
+    }
+    void* other = alloha_lifetime_malloc("other", 24);
+    alloha_lifetime_free(other);
+    for (u32 idx = 6; idx > 0; --idx) {
+        alloha_lifetime_free(objects[idx - 1]);
+    }
+
+    struct alloha_lifetime_stats const stats = alloha_lifetime_stats();
+    assert(stats.sites == 1 && stats.live == 0);
+    assert(stats.dropped_allocs == 3 && stats.untracked_frees == 3);
+
+    struct alloha_lifetime_site site;
+    u32 const                   site_count = alloha_lifetime_sites(&site, 1);
+    assert(site_count == 1);
+    assert(site.allocs == 4 && site.frees == 4 && strstr(site.name, "test_lifetime.c:"));
+
+    FILE* file = tmpfile();
+    assert(file);
+    bool const reported = alloha_lifetime_report(file);
+    long const size     = ftell(file);
+    assert(reported && size > 0);
+    rewind(file);
+
+    char* text = (char*)malloc((usize)size + 1);
+    assert(text);
+    usize const read = fread(text, 1, (usize)size, file);
+    assert(read == (usize)size);
+    text[size] = 0;
+    fclose(file);
+
+    assert(strncmp(text, "pattern", strlen("pattern")) == 0);
+    char const* row = strchr(text, '\n') + 1;
+    assert(strncmp(row, "lifo       stack", strlen("lifo       stack")) == 0);
+    assert(strstr(row, site.name) && strchr(row, '\n')[1] == 0);
+    free(text);
+
+    alloha_lifetime_stop();
+    assert(alloha_lifetime_stats().sites == 0);
+    file = tmpfile();
+    assert(file);
+    bool const stopped_report = alloha_lifetime_report(file);
+    assert(!stopped_report);
+    fclose(file);
+    printf("Test `lifetime_report_and_limits` passed.\n");
+}
+
+static void lifetime_sites_by_contents(void) {
+    bool const started = alloha_lifetime_start((struct alloha_lifetime_config){0});
+    assert(started);
+
+    // Names built at runtime share the site of any name with the same contents.
+    char names[2][16];
+    for (u32 idx = 0; idx < 2; ++idx) {
+        snprintf(names[idx], sizeof(names[idx]), "built:%d", 7);
+        void* object = alloha_lifetime_malloc(names[idx], 16);
+        alloha_lifetime_free(object);
+    }
+    void* object = alloha_lifetime_malloc("built:7", 16);
+    alloha_lifetime_free(object);
+    object = alloha_lifetime_malloc("built:8", 16);
+    alloha_lifetime_free(object);
+
+    struct alloha_lifetime_site sites[4];
+    u32 const                   site_count = alloha_lifetime_sites(sites, 4);
+    assert(site_count == 2);
+
+    struct alloha_lifetime_site const* built = lifetime_find(sites, 2, "built:7");
+    assert(built && built->allocs == 3 && built->frees == 3);
+    struct alloha_lifetime_site const* other = lifetime_find(sites, 2, "built:8");
+    assert(other && other->allocs == 1);
+
+    alloha_lifetime_stop();
+    printf("Test `lifetime_sites_by_contents` passed.\n");
+}
+
+static char const lifetime_thread_sites[4][8] = {"thread0", "thread1", "thread2", "thread3"};
+
+static int lifetime_thread_run(void* arg) {
+    char const* site = (char const*)arg;
+    void*       objects[LIFETIME_DEPTH];
+    for (u32 round = 0; round < LIFETIME_ROUNDS; ++round) {
+        for (u32 idx = 0; idx < LIFETIME_DEPTH; ++idx) {
+            objects[idx] = alloha_lifetime_malloc(site, 32);
+        }
+        for (u32 idx = LIFETIME_DEPTH; idx > 0; --idx) {
+            alloha_lifetime_free(objects[idx - 1]);
+        }
+    }
+    return 0;
+}
+
+static void lifetime_across_threads(void) {
+    enum { THREAD_COUNT = 4 };
+    struct alloha_thread threads[THREAD_COUNT];
+
+    bool const started = alloha_lifetime_start((struct alloha_lifetime_config){0});
+    assert(started);
+    for (u32 i = 0; i < THREAD_COUNT; ++i) {
+        void*      site    = (void*)lifetime_thread_sites[i];
+        bool const created = alloha_thread_create(&threads[i], lifetime_thread_run, site);
+        assert(created);
+    }
+    for (u32 i = 0; i < THREAD_COUNT; ++i) {
+        int const result = alloha_thread_join(&threads[i]);
+        assert(result == 0);
+    }
+
+    // Threads interleave their allocations, but each site is still released in LIFO order.
+    struct alloha_lifetime_site sites[THREAD_COUNT];
+    u32 const                   site_count = alloha_lifetime_sites(sites, THREAD_COUNT);
+    assert(site_count == THREAD_COUNT);
+    for (u32 i = 0; i < THREAD_COUNT; ++i) {
+        assert(sites[i].allocs == LIFETIME_ROUNDS * LIFETIME_DEPTH && sites[i].live == 0);
+        assert(alloha_lifetime_pattern_of(&sites[i]) == ALLOHA_LIFETIME_LIFO);
+    }
+    assert(alloha_lifetime_stats().untracked_frees == 0);
+
+    alloha_lifetime_stop();
+    printf("Test `lifetime_across_threads` passed.\n");
+}
+
+static void test_lifetime(void) {
+    lifetime_classifies_sites();
+    lifetime_report_and_limits();
+    lifetime_sites_by_contents();
+    lifetime_across_threads();
+}
+
+#if !defined(ALLOHA_TEST_NO_MAIN)
+int main(void) {
+    test_lifetime();
+    return 0;
+}
+#endif
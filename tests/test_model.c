@@ -0,0 +1,582 @@
+/// Randomized differential tests of the allocators against a reference model.
+///
+/// Each test generates random sequences of operations, runs them against the real allocator and
+/// against a much simpler model of it, and checks that both agree on every returned pointer and
+/// offset. Live blocks are filled with a tagged pattern, so that overlapping blocks and data lost
+/// across a reallocation are caught when the pattern is verified after each operation.
+///
+/// When a sequence fails it is shrunk to a (locally) minimal failing sequence before being
+/// reported, together with the seed that reproduces it.
+///
+/// Environment variables:
+///     * `ALLOHA_TEST_SEED`: Seed of the random generator (default: fixed seed).
+///     * `ALLOHA_TEST_SOAK_ITERATIONS`: Number of random sequences to test per allocator, set it to
+///                                      a large number for a long soak run.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/arena.h>
+#include <alloha/stack.h>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MODEL_BUF_SIZE           4096
+#define MODEL_MAX_OPS            128
+#define MODEL_MAX_BLOCKS         MODEL_MAX_OPS
+#define MODEL_MAX_SCRATCHES      8
+#define MODEL_DEFAULT_ITERATIONS 256
+#define MODEL_DEFAULT_SEED       0x5eed0a110aULL
+
+enum model_op_kind {
+    MODEL_OP_ALLOC,
+    MODEL_OP_REALLOC,
+    MODEL_OP_POP,
+    MODEL_OP_CLEAR_AT,
+    MODEL_OP_CLEAR,
+    MODEL_OP_SCRATCH_START,
+    MODEL_OP_SCRATCH_END,
+};
+
+static char const* const model_op_names[] = {
+    "alloc",
+    "realloc",
+    "pop",
+    "clear_at",
+    "clear",
+    "scratch_start",
+    "scratch_end",
+};
+
+struct model_op {
+    enum model_op_kind kind;
+    usize              size;
+    u32                alignment;
+    u32                target;  ///< Selects the target block, taken modulo the live block count.
+};
+
+struct model_block {
+    u8*   ptr;
+    usize size;
+    usize padding;  ///< Only used by the stack model.
+    u8    tag;
+};
+
+/// Reference model of the allocator state.
+struct model {
+    u8*                buf;
+    struct model_block blocks[MODEL_MAX_BLOCKS];
+    u32                block_count;
+    usize              offset;
+    usize              previous_offset;
+    usize              scratches[MODEL_MAX_SCRATCHES];
+    u32                scratch_count;
+    u8                 next_tag;
+    char               failure[256];
+};
+
+// -----------------------------------------------------------------------------
+// Random generation of operations.
+// -----------------------------------------------------------------------------
+
+static u64 model_rng_next(u64* state) {
+    // splitmix64.
+    u64 z = (*state += 0x9e3779b97f4a7c15ULL);
+    z     = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z     = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static u64 model_env_u64(char const* name, u64 default_value) {
+    char const* value = getenv(name);
+    if (!value || *value == '\0') {
+        return default_value;
+    }
+    return (u64)strtoull(value, NULL, 0);
+}
+
+static usize model_random_size(u64* rng) {
+    u64 dice = model_rng_next(rng) % 100;
+    if (dice < 2) {
+        return 0;
+    }
+    if (dice < 4) {
+        return MODEL_BUF_SIZE + (model_rng_next(rng) % 64);
+    }
+    if (dice < 20) {
+        return 1 + (model_rng_next(rng) % 512);
+    }
+    return 1 + (model_rng_next(rng) % 64);
+}
+
+static void model_random_ops(
+    u64*                      rng,
+    enum model_op_kind const* kinds,
+    u32 const*                weights,
+    u32                       kind_count,
+    struct model_op*          ops,
+    u32                       op_count) {
+    u32 total_weight = 0;
+    for (u32 k = 0; k < kind_count; ++k) {
+        total_weight += weights[k];
+    }
+
+    for (u32 i = 0; i < op_count; ++i) {
+        u32 pick = (u32)(model_rng_next(rng) % total_weight);
+        u32 k    = 0;
+        while (pick >= weights[k]) {
+            pick -= weights[k];
+            ++k;
+        }
+
+        ops[i] = (struct model_op){
+            .kind      = kinds[k],
+            .size      = model_random_size(rng),
+            .alignment = 1u << (model_rng_next(rng) % 7),
+            .target    = (u32)model_rng_next(rng),
+        };
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Model helpers.
+// -----------------------------------------------------------------------------
+
+static void model_reset(struct model* m, u8* buf) {
+    memset(m, 0, sizeof(*m));
+    m->buf = buf;
+}
+
+static u8 model_pattern(u8 tag, usize idx) {
+    return (u8)(tag * 31u + (u8)idx);
+}
+
+static void model_fill(struct model_block const* block) {
+    for (usize i = 0; i < block->size; ++i) {
+        block->ptr[i] = model_pattern(block->tag, i);
+    }
+}
+
+static bool model_fail(struct model* m, char const* what) {
+    if (m->failure[0] == '\0') {
+        snprintf(m->failure, sizeof(m->failure), "%s", what);
+    }
+    return false;
+}
+
+static void model_push_block(struct model* m, u8* ptr, usize size, usize padding) {
+    struct model_block* block = &m->blocks[m->block_count++];
+    block->ptr                = ptr;
+    block->size               = size;
+    block->padding            = padding;
+    block->tag                = ++m->next_tag;
+    model_fill(block);
+}
+
+/// Check that every live block is in range and still contains its pattern.
+static bool model_check_blocks(struct model* m, usize capacity) {
+    for (u32 b = 0; b < m->block_count; ++b) {
+        struct model_block const* block = &m->blocks[b];
+        if (block->ptr < m->buf || block->ptr + block->size > m->buf + capacity) {
+            return model_fail(m, "live block lies outside of the allocator buffer");
+        }
+        for (usize i = 0; i < block->size; ++i) {
+            if (block->ptr[i] != model_pattern(block->tag, i)) {
+                return model_fail(m, "live block content was overwritten (overlapping blocks)");
+            }
+        }
+    }
+    return true;
+}
+
+/// Expected result of a bump allocation at the current model offset, or null if it can't fit.
+static u8* model_expected_bump(struct model const* m, usize capacity, usize size, u32 alignment) {
+    if (size == 0) {
+        return NULL;
+    }
+    uptr const start = align_forward((uptr)m->buf + m->offset, alignment);
+    if (start + size > (uptr)m->buf + capacity) {
+        return NULL;
+    }
+    return (u8*)start;
+}
+
+// -----------------------------------------------------------------------------
+// Arena.
+// -----------------------------------------------------------------------------
+
+static bool model_arena_step(struct model* m, struct arena* arena, struct model_op const* op) {
+    switch (op->kind) {
+        case MODEL_OP_ALLOC: {
+            if (m->block_count == MODEL_MAX_BLOCKS) {
+                return true;
+            }
+            u8* expected = model_expected_bump(m, arena->capacity, op->size, op->alignment);
+            u8* actual   = arena_alloc_aligned(arena, op->size, op->alignment);
+            if (actual != expected) {
+                return model_fail(m, "arena_alloc_aligned returned an unexpected pointer");
+            }
+            if (actual) {
+                if (((uptr)actual & (op->alignment - 1)) != 0) {
+                    return model_fail(m, "arena_alloc_aligned returned a misaligned pointer");
+                }
+                m->offset = (usize)(actual - m->buf) + op->size;
+                model_push_block(m, actual, op->size, 0);
+            }
+            break;
+        }
+        case MODEL_OP_REALLOC: {
+            if (m->block_count == 0) {
+                return true;
+            }
+            usize const         new_size = alloha_max(op->size, 1);
+            struct model_block* block    = &m->blocks[op->target % m->block_count];
+
+            u8*  expected = NULL;
+            bool in_place = (block->ptr + block->size == m->buf + m->offset);
+            if (in_place) {
+                expected = (block->ptr + new_size <= m->buf + arena->capacity) ? block->ptr : NULL;
+            } else {
+                expected = model_expected_bump(m, arena->capacity, new_size, op->alignment);
+            }
+
+            u8* actual =
+                arena_realloc(arena, block->ptr, block->size, new_size, op->alignment);
+            if (actual != expected) {
+                return model_fail(m, "arena_realloc returned an unexpected pointer");
+            }
+            if (!actual) {
+                break;
+            }
+
+            usize const preserved = alloha_min(block->size, new_size);
+            for (usize i = 0; i < preserved; ++i) {
+                if (actual[i] != model_pattern(block->tag, i)) {
+                    return model_fail(m, "arena_realloc did not preserve the block content");
+                }
+            }
+
+            if (in_place) {
+                m->offset += usize_wrap_sub(new_size, block->size);
+            } else {
+                m->offset = (usize)(actual - m->buf) + new_size;
+            }
+            block->ptr  = actual;
+            block->size = new_size;
+            block->tag  = ++m->next_tag;
+            model_fill(block);
+            break;
+        }
+        case MODEL_OP_CLEAR: {
+            arena_clear(arena);
+            m->offset      = 0;
+            m->block_count = 0;
+            break;
+        }
+        case MODEL_OP_SCRATCH_START: {
+            // The scratch arenas are kept outside of the model, see `model_arena_run`.
+            break;
+        }
+        case MODEL_OP_SCRATCH_END: {
+            // Blocks living above the restored offset are now free memory.
+            usize const saved = m->offset;
+            u32         kept  = 0;
+            for (u32 b = 0; b < m->block_count; ++b) {
+                struct model_block block = m->blocks[b];
+                if (block.ptr >= m->buf + saved) {
+                    continue;
+                }
+                if (block.ptr + block.size > m->buf + saved) {
+                    block.size = (usize)(m->buf + saved - block.ptr);
+                }
+                m->blocks[kept++] = block;
+            }
+            m->block_count = kept;
+            break;
+        }
+        default: break;
+    }
+
+    if (arena->offset != m->offset) {
+        return model_fail(m, "arena offset diverged from the model");
+    }
+    return model_check_blocks(m, arena->capacity);
+}
+
+/// Run a sequence of operations against a fresh arena.
+///
+/// Return: Index of the first failing operation, or `op_count` if the whole sequence passed.
+static u32 model_arena_run(struct model* m, u8* buf, struct model_op const* ops, u32 op_count) {
+    memset(buf, 0, MODEL_BUF_SIZE);
+    model_reset(m, buf);
+
+    struct arena         arena = arena_new(MODEL_BUF_SIZE, buf);
+    struct scratch_arena scratches[MODEL_MAX_SCRATCHES];
+
+    for (u32 i = 0; i < op_count; ++i) {
+        struct model_op const* op = &ops[i];
+        if (op->kind == MODEL_OP_SCRATCH_START) {
+            if (m->scratch_count == MODEL_MAX_SCRATCHES) {
+                continue;
+            }
+            scratches[m->scratch_count]   = scratch_arena_start(&arena);
+            m->scratches[m->scratch_count] = m->offset;
+            ++m->scratch_count;
+        } else if (op->kind == MODEL_OP_SCRATCH_END) {
+            if (m->scratch_count == 0) {
+                continue;
+            }
+            --m->scratch_count;
+            scratch_arena_end(&scratches[m->scratch_count]);
+            m->offset = m->scratches[m->scratch_count];
+        }
+
+        if (!model_arena_step(m, &arena, op)) {
+            return i;
+        }
+    }
+    return op_count;
+}
+
+// -----------------------------------------------------------------------------
+// Stack.
+// -----------------------------------------------------------------------------
+
+static bool model_stack_step(struct model* m, struct stack* stack, struct model_op const* op) {
+    switch (op->kind) {
+        case MODEL_OP_ALLOC: {
+            if (m->block_count == MODEL_MAX_BLOCKS) {
+                return true;
+            }
+            // The header sits right below the block, so both alignments have to hold.
+            u8* const   free_mem     = m->buf + m->offset;
+            u32 const   header_align = alloha_alignof(struct stack_header);
+            u32 const   alignment    = alloha_max(op->alignment, header_align);
+            uptr const  lowest       = (uptr)free_mem + sizeof(struct stack_header);
+            uptr const  start        = align_forward(lowest, alignment);
+            usize const padding      = (usize)(start - (uptr)free_mem);
+
+            bool fits = (op->size != 0) && (padding + op->size <= stack->capacity - m->offset);
+            u8*  expected = fits ? free_mem + padding : NULL;
+
+            u8* actual = stack_alloc_aligned(stack, op->size, op->alignment);
+            if (actual != expected) {
+                return model_fail(m, "stack_alloc_aligned returned an unexpected pointer");
+            }
+            if (actual) {
+                if (((uptr)actual & (op->alignment - 1)) != 0) {
+                    return model_fail(m, "stack_alloc_aligned returned a misaligned pointer");
+                }
+                m->previous_offset = m->offset + padding;
+                m->offset += padding + op->size;
+                model_push_block(m, actual, op->size, padding);
+            }
+            break;
+        }
+        case MODEL_OP_POP:
+        case MODEL_OP_CLEAR_AT: {
+            bool const expected = (m->block_count != 0);
+            bool       actual   = false;
+            u32        target   = 0;
+            if (op->kind == MODEL_OP_POP) {
+                actual = stack_pop(stack);
+                target = m->block_count - 1;
+            } else if (expected) {
+                target = op->target % m->block_count;
+                actual = stack_clear_at(stack, m->blocks[target].ptr);
+            }
+            if (actual != expected) {
+                return model_fail(m, "stack pop/clear_at returned an unexpected status");
+            }
+            if (!actual) {
+                break;
+            }
+
+            struct model_block const* block = &m->blocks[target];
+            m->offset                       = (usize)(block->ptr - m->buf) - block->padding;
+            m->previous_offset = (target == 0) ? 0 : (usize)(m->blocks[target - 1].ptr - m->buf);
+            m->block_count     = target;
+            break;
+        }
+        case MODEL_OP_CLEAR: {
+            stack_clear(stack);
+            m->offset          = 0;
+            m->previous_offset = 0;
+            m->block_count     = 0;
+            break;
+        }
+        default: break;
+    }
+
+    if (stack->offset != m->offset || stack->previous_offset != m->previous_offset) {
+        return model_fail(m, "stack offsets diverged from the model");
+    }
+    return model_check_blocks(m, stack->capacity);
+}
+
+/// Run a sequence of operations against a fresh stack.
+///
+/// Return: Index of the first failing operation, or `op_count` if the whole sequence passed.
+static u32 model_stack_run(struct model* m, u8* buf, struct model_op const* ops, u32 op_count) {
+    memset(buf, 0, MODEL_BUF_SIZE);
+    model_reset(m, buf);
+
+    struct stack stack = stack_new(MODEL_BUF_SIZE, buf);
+    for (u32 i = 0; i < op_count; ++i) {
+        if (!model_stack_step(m, &stack, &ops[i])) {
+            return i;
+        }
+    }
+    return op_count;
+}
+
+// -----------------------------------------------------------------------------
+// Shrinking and the test driver.
+// -----------------------------------------------------------------------------
+
+typedef u32 (*model_run_fn)(struct model*, u8*, struct model_op const*, u32);
+
+/// Shrink a failing sequence by removing chunks of operations and reducing sizes for as long as
+/// the sequence keeps failing.
+///
+/// Return: The length of the shrunk sequence.
+static u32 model_shrink(
+    model_run_fn     run,
+    struct model*    m,
+    u8*              buf,
+    struct model_op* ops,
+    u32              count) {
+    struct model_op candidate[MODEL_MAX_OPS];
+
+    // The operations after the failing one are irrelevant.
+    count = run(m, buf, ops, count) + 1;
+
+    bool progress = true;
+    while (progress) {
+        progress = false;
+
+        for (u32 chunk = count / 2; chunk >= 1; chunk /= 2) {
+            for (u32 start = 0; start + chunk <= count;) {
+                u32 const candidate_count = count - chunk;
+                memcpy(candidate, ops, start * sizeof(struct model_op));
+                memcpy(
+                    candidate + start,
+                    ops + start + chunk,
+                    (count - start - chunk) * sizeof(struct model_op));
+
+                u32 const failed_at = run(m, buf, candidate, candidate_count);
+                if (failed_at < candidate_count) {
+                    memcpy(ops, candidate, candidate_count * sizeof(struct model_op));
+                    count    = failed_at + 1;
+                    progress = true;
+                } else {
+                    ++start;
+                }
+            }
+        }
+
+        for (u32 i = 0; i < count; ++i) {
+            while (ops[i].size > 1) {
+                struct model_op const saved = ops[i];
+                ops[i].size /= 2;
+                if (run(m, buf, ops, count) < count) {
+                    progress = true;
+                } else {
+                    ops[i] = saved;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Leave the failure message of the shrunk sequence in the model.
+    alloha_discard(run(m, buf, ops, count));
+    return count;
+}
+
+static void model_report(
+    char const*            name,
+    u64                    seed,
+    struct model const*    m,
+    struct model_op const* ops,
+    u32                    count) {
+    fprintf(stderr, "%s: %s (seed: 0x%llx)\n", name, m->failure, (unsigned long long)seed);
+    fprintf(stderr, "Minimal failing sequence:\n");
+    for (u32 i = 0; i < count; ++i) {
+        fprintf(
+            stderr,
+            "    %s(size: %llu, alignment: %u, target: %u)\n",
+            model_op_names[ops[i].kind],
+            (unsigned long long)ops[i].size,
+            ops[i].alignment,
+            ops[i].target);
+    }
+}
+
+static void model_check_allocator(
+    char const*               name,
+    model_run_fn              run,
+    enum model_op_kind const* kinds,
+    u32 const*                weights,
+    u32                       kind_count) {
+    u64 const seed       = model_env_u64("ALLOHA_TEST_SEED", MODEL_DEFAULT_SEED);
+    u64 const iterations = model_env_u64("ALLOHA_TEST_SOAK_ITERATIONS", MODEL_DEFAULT_ITERATIONS);
+
+    u8*          buf = (u8*)malloc(MODEL_BUF_SIZE);
+    struct model m;
+    struct model_op ops[MODEL_MAX_OPS];
+    u64             rng = seed;
+
+    bool passed = true;
+    for (u64 it = 0; it < iterations && passed; ++it) {
+        u32 const op_count = 1 + (u32)(model_rng_next(&rng) % MODEL_MAX_OPS);
+        model_random_ops(&rng, kinds, weights, kind_count, ops, op_count);
+
+        if (run(&m, buf, ops, op_count) < op_count) {
+            u32 const shrunk = model_shrink(run, &m, buf, ops, op_count);
+            model_report(name, seed, &m, ops, shrunk);
+            passed = false;
+        }
+    }
+
+    free(buf);
+    assert(passed);
+    printf("Test `%s` passed.\n", name);
+}
+
+static void model_arena_differential(void) {
+    enum model_op_kind const kinds[] = {
+        MODEL_OP_ALLOC,
+        MODEL_OP_REALLOC,
+        MODEL_OP_CLEAR,
+        MODEL_OP_SCRATCH_START,
+        MODEL_OP_SCRATCH_END,
+    };
+    u32 const weights[] = {50, 20, 2, 8, 8};
+    model_check_allocator("model_arena_differential", model_arena_run, kinds, weights, 5);
+}
+
+static void model_stack_differential(void) {
+    enum model_op_kind const kinds[] = {
+        MODEL_OP_ALLOC,
+        MODEL_OP_POP,
+        MODEL_OP_CLEAR_AT,
+        MODEL_OP_CLEAR,
+    };
+    u32 const weights[] = {60, 20, 10, 2};
+    model_check_allocator("model_stack_differential", model_stack_run, kinds, weights, 4);
+}
+
+static void test_model(void) {
+    model_arena_differential();
+    model_stack_differential();
+}
+
+#if !defined(ALLOHA_TEST_NO_MAIN)
+int main(void) {
+    test_model();
+    return 0;
+}
+#endif
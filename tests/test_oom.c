@@ -0,0 +1,154 @@
+/// Allocation failure policy tests.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/oom.h>
+
+#include <alloha/arena.h>
+#include <alloha/core.h>
+#include <alloha/stack.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/// Handler growing the capacity of an arena, or of a stack, into the rest of its buffer.
+struct oom_growth {
+    usize buf_size;  ///< Actual size of the buffer of the allocator.
+    usize step;      ///< Bytes added to the capacity on each call.
+    u32   calls;
+};
+
+static bool oom_grow_arena(struct alloha_oom_info const* info, void* user) {
+    struct oom_growth* growth = (struct oom_growth*)user;
+    struct arena*      arena  = (struct arena*)info->allocator;
+    ++growth->calls;
+    if (arena->capacity >= growth->buf_size) {
+        return false;
+    }
+    arena->capacity = alloha_min(arena->capacity + growth->step, growth->buf_size);
+    return true;
+}
+
+static bool oom_grow_stack(struct alloha_oom_info const* info, void* user) {
+    struct oom_growth* growth = (struct oom_growth*)user;
+    struct stack*      stack  = (struct stack*)info->allocator;
+    ++growth->calls;
+    if (stack->capacity >= growth->buf_size) {
+        return false;
+    }
+    stack->capacity = alloha_min(stack->capacity + growth->step, growth->buf_size);
+    return true;
+}
+
+static void oom_return_null_sets_error(void) {
+    u8           buf[256];
+    struct arena arena = arena_new(sizeof(buf), buf);
+
+    struct alloha_oom_policy const policy = {.action = ALLOHA_OOM_RETURN_NULL, .quiet = true};
+    arena.oom                             = &policy;
+
+    alloha_clear_error();
+    u64 const failures = alloha_failure_count();
+    u8* const fitting  = arena_alloc(&arena, 128);
+    assert(fitting && alloha_last_error() == ALLOHA_OK);
+
+    u8* const too_large = arena_alloc(&arena, 256);
+    assert(!too_large);
+    assert(alloha_last_error() == ALLOHA_ERROR_OUT_OF_MEMORY);
+    assert(alloha_failure_count() == failures + 1);
+    assert(arena.offset == 128);
+
+    // Misuses are recorded as well.
+    alloha_clear_error();
+    u8* const foreign = arena_realloc(&arena, buf + 200, 8, 16, 8);
+    assert(!foreign);
+    assert(alloha_last_error() == ALLOHA_ERROR_INVALID_BLOCK);
+    assert(alloha_failure_count() == failures + 2);
+
+    printf("Test `oom_return_null_sets_error` passed.\n");
+}
+
+static void oom_retry_grows_arena(void) {
+    usize const buf_size = 4096;
+    u8*         buf      = (u8*)malloc(buf_size);
+
+    struct oom_growth              growth = {.buf_size = buf_size, .step = 512};
+    struct alloha_oom_policy const policy = {
+        .action  = ALLOHA_OOM_RETRY,
+        .handler = oom_grow_arena,
+        .user    = &growth,
+    };
+    struct arena arena = arena_new(1024, buf);
+    arena.oom          = &policy;
+
+    // Grows twice to fit.
+    u8* first = arena_alloc(&arena, 2000);
+    assert(first && arena.capacity == 2048 && growth.calls == 2);
+
+    // The last block is extended in place.
+    u8* extended = arena_realloc(&arena, first, 2000, 2400, ALLOHA_DEFAULT_ALIGNMENT);
+    assert(extended == first && arena.capacity == 2560 && growth.calls == 3);
+
+    // The handler gives up once the buffer is exhausted.
+    alloha_clear_error();
+    growth.calls       = 0;
+    u8* const exhausted = arena_alloc(&arena, buf_size);
+    assert(!exhausted);
+    assert(arena.capacity == buf_size && growth.calls == 4);
+    assert(alloha_last_error() == ALLOHA_ERROR_OUT_OF_MEMORY);
+
+    // Retries are bounded even if the handler never gives up.
+    growth.buf_size   = SIZE_MAX;
+    growth.step       = 0;
+    growth.calls      = 0;
+    u8* const endless = arena_alloc(&arena, 2 * buf_size);
+    assert(!endless);
+    assert(growth.calls == ALLOHA_OOM_MAX_RETRIES);
+
+    free(buf);
+    printf("Test `oom_retry_grows_arena` passed.\n");
+}
+
+static void oom_retry_grows_stack(void) {
+    usize const buf_size = 4096;
+    u8*         buf      = (u8*)malloc(buf_size);
+
+    struct oom_growth              growth = {.buf_size = buf_size, .step = 1024};
+    struct alloha_oom_policy const policy = {
+        .action  = ALLOHA_OOM_RETRY,
+        .handler = oom_grow_stack,
+        .user    = &growth,
+    };
+    struct stack stack = stack_new(512, buf);
+    stack.oom          = &policy;
+
+    u8* first = stack_alloc(&stack, 256);
+    assert(first && growth.calls == 0);
+    u8* second = stack_alloc(&stack, 1024);
+    assert(second && stack.capacity == 1536 && growth.calls == 1);
+    bool const popped = stack_pop(&stack);
+    u8* const  again  = stack_alloc(&stack, 1024);
+    assert(popped && again == second);
+
+    // Misuses aren't handled by the policy.
+    alloha_clear_error();
+    bool const cleared = stack_clear_at(&stack, buf + buf_size - 1);
+    assert(!cleared);
+    assert(alloha_last_error() == ALLOHA_ERROR_INVALID_BLOCK && growth.calls == 1);
+
+    free(buf);
+    printf("Test `oom_retry_grows_stack` passed.\n");
+}
+
+static void test_oom(void) {
+    oom_return_null_sets_error();
+    oom_retry_grows_arena();
+    oom_retry_grows_stack();
+}
+
+#if !defined(ALLOHA_TEST_NO_MAIN)
+int main(void) {
+    test_oom();
+    return 0;
+}
+#endif
@@ -0,0 +1,202 @@
+/// Memory pressure watcher tests.
+///
+/// The PSI trigger and cgroup files are simulated with a pipe and a temporary directory, so that
+/// the tests don't depend on the cgroup setup of the machine running them.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/pressure.h>
+
+#include <alloha/arena.h>
+#include <alloha/core.h>
+#include <alloha/scavenger.h>
+#include <alloha/vmem.h>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__linux__)
+#    include <fcntl.h>
+#    include <stdlib.h>
+#    include <unistd.h>
+
+#    define PRESSURE_TEST_PAGES 64
+#    define PRESSURE_TEST_CALM  50
+
+struct pressure_log {
+    u32                 calls;
+    enum pressure_level last;
+};
+
+static void pressure_test_callback(enum pressure_level level, void* user) {
+    struct pressure_log* log = (struct pressure_log*)user;
+    ++log->calls;
+    log->last = level;
+}
+
+static void pressure_signal(int fd) {
+    char const    byte    = 1;
+    ssize_t const written = write(fd, &byte, 1);
+    assert(written == 1);
+}
+
+static void pressure_pipe_escalates_and_trims(void) {
+    usize const     page_size = vmem_page_size();
+    struct vm_arena vm_arena;
+    bool const      mapped =
+        vm_arena_create(&vm_arena, PRESSURE_TEST_PAGES * page_size, VM_ARENA_DEFAULT);
+    assert(mapped);
+    struct arena* arena = &vm_arena.arena;
+
+    // With such a decay, the scavenger alone wouldn't release anything during the test.
+    struct scavenger scavenger;
+    scavenger_init(&scavenger, (struct scavenger_config){.period_ms = 0, .decay_ms = 3600000});
+    struct scavenger_entry entry;
+    scavenger_register(&scavenger, &entry, arena->buf, arena->capacity);
+
+    memset(arena_alloc(arena, arena->capacity), 0xCD, arena->capacity);
+    arena_clear(arena);
+    scavenger_idle(&entry, arena->capacity);
+    scavenger_resume(&entry);
+    u8* const used = arena_alloc(arena, 8 * page_size);
+    assert(used);
+    arena_clear(arena);
+    scavenger_idle(&entry, 8 * page_size);
+    usize const decayed = scavenger_scan(&scavenger);
+    assert(decayed == 0);
+
+    int       fds[2];
+    int const piped = pipe(fds);
+    assert(piped == 0);
+    struct pressure_log     log = {0};
+    struct pressure_watcher watcher;
+    pressure_watcher_attach(
+        &watcher,
+        fds[0],
+        PRESSURE_TEST_CALM,
+        &scavenger,
+        pressure_test_callback,
+        &log);
+
+    enum pressure_level const quiet = pressure_watcher_poll(&watcher, 0);
+    assert(quiet == PRESSURE_NONE && log.calls == 0);
+
+    // The first signal drops the high-water mark, releasing everything above the last usage.
+    pressure_signal(fds[1]);
+    enum pressure_level const signaled = pressure_watcher_poll(&watcher, 0);
+    assert(signaled == PRESSURE_LOW);
+    assert(log.calls == 1 && log.last == PRESSURE_LOW);
+    assert(atomic_load(&scavenger.released_bytes) == (PRESSURE_TEST_PAGES - 8) * page_size);
+    for (usize i = 0; i < 8 * page_size; ++i) {
+        assert(arena->buf[i] == 0xCD);
+    }
+    for (usize i = 8 * page_size; i < arena->capacity; ++i) {
+        assert(arena->buf[i] == 0);
+    }
+
+    // Sustained pressure escalates up to the highest level.
+    pressure_signal(fds[1]);
+    enum pressure_level const escalated = pressure_watcher_poll(&watcher, 0);
+    pressure_signal(fds[1]);
+    enum pressure_level const highest = pressure_watcher_poll(&watcher, 0);
+    pressure_signal(fds[1]);
+    enum pressure_level const sustained = pressure_watcher_poll(&watcher, 0);
+    assert(escalated == PRESSURE_MEDIUM && highest == PRESSURE_HIGH && sustained == PRESSURE_HIGH);
+    assert(log.calls == 4 && log.last == PRESSURE_HIGH);
+    assert(atomic_load(&scavenger.pressure) == PRESSURE_HIGH);
+
+    // Once calm, the level goes down one step per period.
+    alloha_thread_sleep(PRESSURE_TEST_CALM + 10);
+    enum pressure_level const calmed = pressure_watcher_poll(&watcher, 0);
+    assert(calmed == PRESSURE_MEDIUM);
+    assert(log.calls == 5 && log.last == PRESSURE_MEDIUM);
+    assert(atomic_load(&scavenger.pressure) == PRESSURE_MEDIUM);
+
+    // Closing the writing end isn't a signal, and stops the polling of the pipe.
+    close(fds[1]);
+    enum pressure_level const closed = pressure_watcher_poll(&watcher, 0);
+    assert(closed == PRESSURE_MEDIUM && watcher.trigger_fd == -1);
+
+    pressure_watcher_close(&watcher);
+    scavenger_unregister(&scavenger, &entry);
+    scavenger_destroy(&scavenger);
+    vm_arena_destroy(&vm_arena);
+    printf("Test `pressure_pipe_escalates_and_trims` passed.\n");
+}
+
+static void pressure_write_file(char const* dir, char const* name, char const* contents) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE* file = fopen(path, "w");
+    assert(file);
+    fputs(contents, file);
+    fclose(file);
+}
+
+static void pressure_remove_file(char const* dir, char const* name) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    unlink(path);
+}
+
+static void pressure_cgroup_memory_high(void) {
+    char        dir[] = "/tmp/alloha_cgroup_XXXXXX";
+    char const* made  = mkdtemp(dir);
+    assert(made);
+    pressure_write_file(dir, "memory.pressure", "");
+    pressure_write_file(dir, "memory.current", "950000\n");
+    pressure_write_file(dir, "memory.high", "1000000\n");
+
+    struct pressure_config const config = {
+        .cgroup_dir   = dir,
+        .high_percent = 90,
+        .calm_ms      = 0,
+    };
+    struct pressure_log     log = {0};
+    struct pressure_watcher watcher;
+    bool const              opened =
+        pressure_watcher_open(&watcher, &config, NULL, pressure_test_callback, &log);
+    assert(opened);
+
+    // Being over the threshold of `memory.high` signals pressure on each poll.
+    enum pressure_level const over       = pressure_watcher_poll(&watcher, 0);
+    enum pressure_level const still_over = pressure_watcher_poll(&watcher, 0);
+    assert(over == PRESSURE_LOW && still_over == PRESSURE_MEDIUM);
+
+    pressure_write_file(dir, "memory.current", "500000\n");
+    enum pressure_level const under = pressure_watcher_poll(&watcher, 0);
+    assert(under == PRESSURE_LOW);
+
+    pressure_write_file(dir, "memory.current", "2000000\n");
+    pressure_write_file(dir, "memory.high", "max\n");
+    enum pressure_level const unlimited = pressure_watcher_poll(&watcher, 0);
+    assert(unlimited == PRESSURE_NONE);
+    assert(log.calls == 4 && log.last == PRESSURE_NONE);
+
+    pressure_watcher_close(&watcher);
+    pressure_remove_file(dir, "memory.pressure");
+    pressure_remove_file(dir, "memory.current");
+    pressure_remove_file(dir, "memory.high");
+    rmdir(dir);
+    printf("Test `pressure_cgroup_memory_high` passed.\n");
+}
+
+static void test_pressure(void) {
+    pressure_pipe_escalates_and_trims();
+    pressure_cgroup_memory_high();
+}
+
+#else
+
+static void test_pressure(void) {
+    printf("Tests of the pressure watcher skipped, PSI is only available on Linux.\n");
+}
+
+#endif
+
+#if !defined(ALLOHA_TEST_NO_MAIN)
+int main(void) {
+    test_pressure();
+    return 0;
+}
+#endif
@@ -0,0 +1,123 @@
+/// Static tracepoint tests.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/probe.h>
+
+#include <alloha/core.h>
+#include <stdio.h>
+
+#if defined(ALLOHA_USDT_ENABLED)
+
+#    include <assert.h>
+#    include <elf.h>
+#    include <stdlib.h>
+#    include <string.h>
+
+static char const* const probe_names[] = {
+    "arena_alloc",
+    "arena_realloc",
+    "arena_alloc_failed",
+    "arena_clear",
+    "arena_scratch_start",
+    "arena_scratch_end",
+    "stack_alloc",
+    "stack_alloc_failed",
+    "stack_pop",
+    "stack_clear_at",
+    "stack_clear",
+};
+
+#    define PROBE_COUNT (sizeof(probe_names) / sizeof(probe_names[0]))
+
+/// Read the whole executable of the running process.
+static u8* probe_read_self(usize* size) {
+    FILE* file = fopen("/proc/self/exe", "rb");
+    assert(file && "unable to open the executable of the process");
+    int const  sought = fseek(file, 0, SEEK_END);
+    long const length = ftell(file);
+    assert(sought == 0 && length > 0);
+    rewind(file);
+
+    u8* data = (u8*)malloc((usize)length);
+    assert(data);
+    usize const read = fread(data, 1, (usize)length, file);
+    assert(read == (usize)length);
+    fclose(file);
+    *size = (usize)length;
+    return data;
+}
+
+static usize probe_align4(usize size) {
+    return (size + 3) & ~(usize)3;
+}
+
+/// Every probe of the allocators is described by a note of the `.note.stapsdt` section.
+static void probe_notes_present(void) {
+    usize     size = 0;
+    u8* const data = probe_read_self(&size);
+
+    Elf64_Ehdr const* ehdr = (Elf64_Ehdr const*)data;
+    assert(memcmp(ehdr->e_ident, ELFMAG, SELFMAG) == 0 && ehdr->e_ident[EI_CLASS] == ELFCLASS64);
+    Elf64_Shdr const* sections = (Elf64_Shdr const*)(data + ehdr->e_shoff);
+    char const*       names    = (char const*)(data + sections[ehdr->e_shstrndx].sh_offset);
+
+    bool found[PROBE_COUNT] = {0};
+    u32  notes              = 0;
+    for (u32 idx = 0; idx < ehdr->e_shnum; ++idx) {
+        if (strcmp(names + sections[idx].sh_name, ".note.stapsdt") != 0) {
+            continue;
+        }
+
+        // Each note holds the probe address, the base and semaphore addresses, followed by the
+        // provider, probe name and argument strings.
+        u8 const* note = data + sections[idx].sh_offset;
+        u8 const* end  = note + sections[idx].sh_size;
+        while (note < end) {
+            Elf64_Nhdr const* header = (Elf64_Nhdr const*)note;
+            char const*       owner  = (char const*)(header + 1);
+            u8 const*         desc   = (u8 const*)owner + probe_align4(header->n_namesz);
+            if (header->n_type == 3 && strcmp(owner, "stapsdt") == 0) {
+                char const* provider = (char const*)(desc + 3 * sizeof(u64));
+                char const* name     = provider + strlen(provider) + 1;
+                for (usize probe = 0; probe < PROBE_COUNT; ++probe) {
+                    if (strcmp(provider, "alloha") == 0 && strcmp(name, probe_names[probe]) == 0) {
+                        found[probe] = true;
+                        ++notes;
+                    }
+                }
+            }
+            note = desc + probe_align4(header->n_descsz);
+        }
+    }
+
+    for (usize probe = 0; probe < PROBE_COUNT; ++probe) {
+        if (!found[probe]) {
+            printf("Probe `alloha:%s` not found.\n", probe_names[probe]);
+        }
+        assert(found[probe]);
+    }
+    assert(notes >= PROBE_COUNT);
+
+    free(data);
+    printf("Test `probe_notes_present` passed.\n");
+}
+
+static void test_probe(void) {
+    probe_notes_present();
+}
+
+#else
+
+static void test_probe(void) {
+    printf("Tests of the USDT probes skipped, `<sys/sdt.h>` wasn't found.\n");
+}
+
+#endif
+
+#if !defined(ALLOHA_TEST_NO_MAIN)
+int main(void) {
+    test_probe();
+    return 0;
+}
+#endif
@@ -0,0 +1,109 @@
+/// Recycling arena allocator tests.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/recycle_arena.h>
+
+#include <alloha/core.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void recycle_arena_reuses_buckets(void) {
+    usize const          buf_size = 4096;
+    u8*                  buf      = (u8*)malloc(buf_size);
+    struct recycle_arena arena    = recycle_arena_new(buf_size, buf);
+
+    // Sizes are rounded up to their bucket, so blocks of close sizes are interchangeable.
+    u8* first  = recycle_arena_alloc(&arena, 24);
+    u8* second = recycle_arena_alloc(&arena, 100);
+    u8* third  = recycle_arena_alloc(&arena, 32);
+    assert(first && second && third);
+    assert(second - first == 32 && third - second == 128);
+    memset(first, 0x11, 24);
+
+    recycle_arena_free(&arena, first, 24);
+    usize const offset   = arena.arena.offset;
+    u8* const   recycled = recycle_arena_alloc(&arena, 30);
+    assert(recycled == first && arena.arena.offset == offset);
+
+    // Free lists are LIFO, and a miss bumps the arena.
+    recycle_arena_free(&arena, second, 100);
+    u8* const missed = recycle_arena_alloc(&arena, 20);
+    assert(missed != second && arena.arena.offset > offset);
+    u8* const hit = recycle_arena_alloc(&arena, 65);
+    assert(hit == second);
+
+    // Blocks not satisfying the alignment aren't reused.
+    u8* odd  = recycle_arena_alloc_aligned(&arena, 16, 1);
+    u8* byte = recycle_arena_alloc_aligned(&arena, 1, 1);
+    assert(odd && byte);
+    if (((uptr)odd & 255) != 0) {
+        recycle_arena_free(&arena, odd, 16);
+        u8* const aligned = recycle_arena_alloc_aligned(&arena, 16, 256);
+        u8* const reused  = recycle_arena_alloc_aligned(&arena, 16, 1);
+        assert(aligned != odd && reused == odd);
+    }
+
+    // Freeing the last block rolls the offset back, even for sizes without a bucket.
+    usize const before = arena.arena.offset;
+    u8*         large  = recycle_arena_alloc_aligned(&arena, 3000, 1);
+    assert(large && arena.arena.offset == before + 3000);
+    recycle_arena_free(&arena, large, 3000);
+    assert(arena.arena.offset == before);
+
+    // Blocks outside of the arena are rejected.
+    alloha_clear_error();
+    recycle_arena_free(&arena, buf + buf_size - 16, 16);
+    assert(alloha_last_error() == ALLOHA_ERROR_INVALID_BLOCK);
+
+    recycle_arena_clear(&arena);
+    assert(arena.arena.offset == 0 && !arena.free_lists[0]);
+
+    free(buf);
+    printf("Test `recycle_arena_reuses_buckets` passed.\n");
+}
+
+// A churning workload stays within a bounded amount of memory.
+static void recycle_arena_bounded_churn(void) {
+    usize const          buf_size = 16 * 1024;
+    u8*                  buf      = (u8*)malloc(buf_size);
+    struct recycle_arena arena    = recycle_arena_new(buf_size, buf);
+
+    u8*   live[32]  = {0};
+    usize sizes[32] = {0};
+    usize peak      = 0;
+    for (u32 it = 0; it < 10000; ++it) {
+        u32 const slot = it % 32;
+        if (live[slot]) {
+            for (usize i = 0; i < sizes[slot]; ++i) {
+                assert(live[slot][i] == (u8)slot);
+            }
+            recycle_arena_free(&arena, live[slot], sizes[slot]);
+        }
+        sizes[slot] = 8 + (it * 37) % 120;
+        live[slot]  = recycle_arena_alloc(&arena, sizes[slot]);
+        assert(live[slot]);
+        memset(live[slot], (int)slot, sizes[slot]);
+        peak = alloha_max(peak, arena.arena.offset);
+    }
+
+    // At most every bucket is filled with a whole window of live blocks.
+    assert(peak <= 32 * (16 + 32 + 64 + 128));
+
+    free(buf);
+    printf("Test `recycle_arena_bounded_churn` passed.\n");
+}
+
+static void test_recycle_arena(void) {
+    recycle_arena_reuses_buckets();
+    recycle_arena_bounded_churn();
+}
+
+#if !defined(ALLOHA_TEST_NO_MAIN)
+int main(void) {
+    test_recycle_arena();
+    return 0;
+}
+#endif
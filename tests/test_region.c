@@ -0,0 +1,152 @@
+/// Reference-counted region tests.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/region.h>
+
+#include <alloha/core.h>
+#include <alloha/oom.h>
+#include <alloha/thread.h>
+#include <alloha/vmem.h>
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+static void region_alloc_grows_chunks(void) {
+    usize const    page_size = vmem_page_size();
+    usize const    baseline  = vmem_stats().mapped_bytes;
+    struct region* region    = region_create(1);
+    assert(region && region->chunk_size == page_size && region_ref_count(region) == 1);
+    assert(vmem_stats().mapped_bytes == baseline + page_size);
+
+    // Blocks are written as they're allocated, so that overlaps would be caught when read back.
+    u32 const count  = 1000;
+    u64*      blocks[1000];
+    for (u32 i = 0; i < count; ++i) {
+        blocks[i] = (u64*)region_alloc(region, 4 * sizeof(u64));
+        assert(blocks[i] && ((uptr)blocks[i] % ALLOHA_DEFAULT_ALIGNMENT) == 0);
+        blocks[i][0] = i;
+        blocks[i][3] = ~(u64)i;
+    }
+    for (u32 i = 0; i < count; ++i) {
+        assert(blocks[i][0] == i && blocks[i][3] == ~(u64)i);
+    }
+    assert(region->mapped_bytes > page_size && region->chunks->next);
+
+    // Blocks larger than the chunk size get a chunk of their own.
+    u8* large = region_alloc_aligned(region, 3 * page_size, 256);
+    assert(large && ((uptr)large % 256) == 0);
+    large[3 * page_size - 1] = 1;
+    assert(region->chunks->size >= 3 * page_size);
+    assert(vmem_stats().mapped_bytes == baseline + region->mapped_bytes);
+
+    // Releasing the region unmaps every chunk at once.
+    bool const released = region_release(region);
+    assert(released);
+    assert(vmem_stats().mapped_bytes == baseline);
+    printf("Test `region_alloc_grows_chunks` passed.\n");
+}
+
+static void region_release_on_last_reference(void) {
+    usize const    baseline = vmem_stats().mapped_bytes;
+    struct region* region   = region_create(0);
+    assert(region && region->chunk_size == REGION_DEFAULT_CHUNK_SIZE);
+    u8* const first = region_alloc(region, 128);
+    assert(first);
+
+    struct region* const first_reference  = region_retain(region);
+    struct region* const second_reference = region_retain(region);
+    assert(first_reference == region && second_reference == region);
+    assert(region_ref_count(region) == 3);
+    bool const first_released  = region_release(first_reference);
+    bool const second_released = region_release(second_reference);
+    assert(!first_released && !second_released);
+    u8* const second = region_alloc(region, 128);
+    assert(region_ref_count(region) == 1 && second);
+    assert(vmem_stats().mapped_bytes > baseline);
+
+    bool const released = region_release(region);
+    assert(released);
+    assert(vmem_stats().mapped_bytes == baseline);
+    bool const null_released = region_release(NULL);
+    u8* const  null_block    = region_alloc(NULL, 8);
+    assert(!null_released && !null_block);
+    printf("Test `region_release_on_last_reference` passed.\n");
+}
+
+/// Data shared by the readers, living in the region it belongs to.
+struct region_shared {
+    struct region* region;
+    u64            count;
+    u64*           values;
+};
+
+struct region_reader {
+    struct region_shared* shared;
+    atomic_uint*          releases;  ///< Amount of readers that released the region.
+    u64                   sum;
+};
+
+static int region_reader_run(void* arg) {
+    struct region_reader* reader = (struct region_reader*)arg;
+    struct region_shared* shared = reader->shared;
+    for (u64 i = 0; i < shared->count; ++i) {
+        reader->sum += shared->values[i];
+        ALLOHA_SCHED_POINT();
+    }
+    if (region_release(shared->region)) {
+        atomic_fetch_add_explicit(reader->releases, 1, memory_order_relaxed);
+    }
+    return 0;
+}
+
+static void region_shared_across_threads(void) {
+    usize const    baseline = vmem_stats().mapped_bytes;
+    struct region* region   = region_create(0);
+    assert(region);
+
+    struct region_shared* shared =
+        (struct region_shared*)region_alloc(region, sizeof(struct region_shared));
+    shared->region = region;
+    shared->count  = 512;
+    shared->values = (u64*)region_alloc(region, shared->count * sizeof(u64));
+    for (u64 i = 0; i < shared->count; ++i) {
+        shared->values[i] = i;
+    }
+
+    // Each reader holds a reference, and the builder drops its own while they're still reading.
+    enum { READER_COUNT = 4 };
+    atomic_uint          releases = 0;
+    struct region_reader readers[READER_COUNT];
+    struct alloha_thread threads[READER_COUNT];
+    for (u32 i = 0; i < READER_COUNT; ++i) {
+        readers[i] = (struct region_reader){.shared = shared, .releases = &releases};
+        region_retain(region);
+        bool const created = alloha_thread_create(&threads[i], region_reader_run, &readers[i]);
+        assert(created);
+    }
+    bool const builder_released = region_release(region);
+
+    for (u32 i = 0; i < READER_COUNT; ++i) {
+        int const result = alloha_thread_join(&threads[i]);
+        assert(result == 0 && readers[i].sum == 511 * 512 / 2);
+    }
+
+    // The region was released exactly once, by whoever dropped the last reference.
+    assert(atomic_load(&releases) + (builder_released ? 1u : 0u) == 1);
+    assert(vmem_stats().mapped_bytes == baseline);
+    printf("Test `region_shared_across_threads` passed.\n");
+}
+
+static void test_region(void) {
+    region_alloc_grows_chunks();
+    region_release_on_last_reference();
+    region_shared_across_threads();
+}
+
+#if !defined(ALLOHA_TEST_NO_MAIN)
+int main(void) {
+    test_region();
+    return 0;
+}
+#endif
@@ -0,0 +1,197 @@
+/// Sampling heap profiler tests.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/sample.h>
+
+#include <alloha/arena.h>
+#include <alloha/core.h>
+#include <alloha/stack.h>
+#include <alloha/thread.h>
+#include <stdio.h>
+
+#if !defined(ALLOHA_NO_SAMPLE)
+
+#    include <assert.h>
+#    include <stdlib.h>
+#    include <string.h>
+
+#    define SAMPLE_PERIOD     4096
+#    define SAMPLE_BLOCK_SIZE 64
+#    define SAMPLE_BUF_SIZE   (64 << 10)
+
+/// Allocate `total` bytes from an arena, in blocks of `SAMPLE_BLOCK_SIZE` bytes.
+static void sample_arena_workload(u8* buf, usize total) {
+    struct arena arena = arena_new(SAMPLE_BUF_SIZE, buf);
+    for (usize allocated = 0; allocated < total; allocated += SAMPLE_BLOCK_SIZE) {
+        if (!arena_alloc(&arena, SAMPLE_BLOCK_SIZE)) {
+            arena_clear(&arena);
+            u8* const block = arena_alloc(&arena, SAMPLE_BLOCK_SIZE);
+            assert(block);
+        }
+    }
+}
+
+/// Same as `sample_arena_workload`, allocating from a stack.
+static void sample_stack_workload(u8* buf, usize total) {
+    struct stack stack = stack_new(SAMPLE_BUF_SIZE, buf);
+    for (usize allocated = 0; allocated < total; allocated += SAMPLE_BLOCK_SIZE) {
+        if (!stack_alloc(&stack, SAMPLE_BLOCK_SIZE)) {
+            stack_clear(&stack);
+            u8* const block = stack_alloc(&stack, SAMPLE_BLOCK_SIZE);
+            assert(block);
+        }
+    }
+}
+
+/// Write the profile to a temporary file and read it back.
+static char* sample_write_profile(enum alloha_sample_format format) {
+    FILE* file = tmpfile();
+    assert(file);
+    bool const written = alloha_sample_write(file, format);
+    long const size    = ftell(file);
+    assert(written && size > 0);
+    rewind(file);
+
+    char* text = (char*)malloc((usize)size + 1);
+    assert(text);
+    usize const read = fread(text, 1, (usize)size, file);
+    assert(read == (usize)size);
+    text[size] = 0;
+    fclose(file);
+    return text;
+}
+
+static void sample_estimates_allocated_bytes(void) {
+    static u8 buf[SAMPLE_BUF_SIZE];
+    usize const total = (usize)16 << 20;
+
+    // Nothing is sampled while the profiler is stopped.
+    sample_arena_workload(buf, (usize)4 << 20);
+    assert(alloha_sample_stats().samples == 0);
+
+    bool const started =
+        alloha_sample_start((struct alloha_sample_config){.period = SAMPLE_PERIOD});
+    assert(started);
+    bool const restarted = alloha_sample_start((struct alloha_sample_config){0});
+    assert(!restarted);
+    sample_arena_workload(buf, total);
+
+    // About one sample every `SAMPLE_PERIOD` bytes, with a standard deviation of 64 samples.
+    struct alloha_sample_stats const stats = alloha_sample_stats();
+    assert(stats.samples > 3600 && stats.samples < 4600);
+    assert(stats.stacks >= 1 && stats.dropped == 0);
+
+    // The weights of the folded stacks estimate the allocated bytes.
+    char* const folded    = sample_write_profile(ALLOHA_SAMPLE_FOLDED);
+    u64         estimated = 0;
+    u32         lines     = 0;
+    for (char const* line = folded; *line;) {
+        char const* end    = strchr(line, '\n');
+        char const* weight = end;
+        while (weight[-1] != ' ') {
+            --weight;
+        }
+        assert(strncmp(line, "0x", 2) == 0);
+        estimated += strtoull(weight, NULL, 10);
+        ++lines;
+        line = end + 1;
+    }
+    assert(lines == stats.stacks);
+    assert(estimated > total / 10 * 9 && estimated < total / 10 * 11);
+    free(folded);
+
+    alloha_sample_stop();
+    assert(alloha_sample_stats().samples == 0);
+    FILE* file = tmpfile();
+    assert(file);
+    bool const stopped_write = alloha_sample_write(file, ALLOHA_SAMPLE_FOLDED);
+    assert(!stopped_write);
+    fclose(file);
+    printf("Test `sample_estimates_allocated_bytes` passed.\n");
+}
+
+static void sample_pprof_profile(void) {
+    static u8  buf[SAMPLE_BUF_SIZE];
+    bool const started = alloha_sample_start(
+        (struct alloha_sample_config){.period = SAMPLE_PERIOD, .max_stacks = 1});
+    assert(started);
+    sample_arena_workload(buf, (usize)1 << 20);
+    sample_stack_workload(buf, (usize)1 << 20);
+
+    // Samples of backtraces beyond the first one are dropped.
+    struct alloha_sample_stats const stats = alloha_sample_stats();
+    assert(stats.stacks == 1 && stats.samples > 0 && stats.dropped > 0);
+
+    char* const text = sample_write_profile(ALLOHA_SAMPLE_PPROF);
+    char        header[128];
+    snprintf(
+        header,
+        sizeof(header),
+        "heap profile: %llu: %llu [%llu: %llu] @ heap_v2/%u\n",
+        (unsigned long long)stats.samples,
+        (unsigned long long)(stats.samples * SAMPLE_BLOCK_SIZE),
+        (unsigned long long)stats.samples,
+        (unsigned long long)(stats.samples * SAMPLE_BLOCK_SIZE),
+        SAMPLE_PERIOD);
+    assert(strncmp(text, header, strlen(header)) == 0);
+    char const* record = text + strlen(header);
+    assert(strncmp(strchr(record, '@'), "@ 0x", 4) == 0);
+    assert(strstr(record, "\nMAPPED_LIBRARIES:\n"));
+    free(text);
+
+    alloha_sample_stop();
+    printf("Test `sample_pprof_profile` passed.\n");
+}
+
+static int sample_thread_run(void* arg) {
+    u8* buf = (u8*)arg;
+    sample_arena_workload(buf, (usize)4 << 20);
+    return 0;
+}
+
+static void sample_across_threads(void) {
+    enum { THREAD_COUNT = 4 };
+    static u8            bufs[THREAD_COUNT][SAMPLE_BUF_SIZE];
+    struct alloha_thread threads[THREAD_COUNT];
+
+    bool const started =
+        alloha_sample_start((struct alloha_sample_config){.period = SAMPLE_PERIOD});
+    assert(started);
+    for (u32 i = 0; i < THREAD_COUNT; ++i) {
+        bool const created = alloha_thread_create(&threads[i], sample_thread_run, bufs[i]);
+        assert(created);
+    }
+    for (u32 i = 0; i < THREAD_COUNT; ++i) {
+        int const result = alloha_thread_join(&threads[i]);
+        assert(result == 0);
+    }
+
+    // Each thread samples about 1024 times.
+    struct alloha_sample_stats const stats = alloha_sample_stats();
+    assert(stats.samples > 3600 && stats.samples < 4600);
+
+    alloha_sample_stop();
+    printf("Test `sample_across_threads` passed.\n");
+}
+
+static void test_sample(void) {
+    sample_estimates_allocated_bytes();
+    sample_pprof_profile();
+    sample_across_threads();
+}
+
+#else
+
+static void test_sample(void) {
+    printf("Tests of the sampling heap profiler skipped, `ALLOHA_NO_SAMPLE` is defined.\n");
+}
+
+#endif
+
+#if !defined(ALLOHA_TEST_NO_MAIN)
+int main(void) {
+    test_sample();
+    return 0;
+}
+#endif
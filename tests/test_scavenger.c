@@ -0,0 +1,143 @@
+/// Background scavenger tests.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/scavenger.h>
+
+#include <alloha/arena.h>
+#include <alloha/core.h>
+#include <alloha/vmem.h>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SCAVENGER_TEST_PAGES      64
+#define SCAVENGER_TEST_ITERATIONS 2000
+
+static void scavenger_releases_above_high_water(void) {
+    usize const     page_size = vmem_page_size();
+    struct vm_arena vm_arena;
+    bool const      mapped =
+        vm_arena_create(&vm_arena, SCAVENGER_TEST_PAGES * page_size, VM_ARENA_DEFAULT);
+    assert(mapped);
+    struct arena* arena = &vm_arena.arena;
+
+    struct scavenger scavenger;
+    scavenger_init(&scavenger, (struct scavenger_config){.period_ms = 0, .decay_ms = 0});
+    struct scavenger_entry entry;
+    scavenger_register(&scavenger, &entry, arena->buf, arena->capacity);
+
+    // Nothing is released while the allocator is active.
+    memset(arena_alloc(arena, arena->capacity), 0xCD, arena->capacity);
+    usize const active = scavenger_scan(&scavenger);
+    assert(active == 0);
+
+    // The whole arena was used, so the high-water mark covers it.
+    usize used = arena->offset;
+    arena_clear(arena);
+    scavenger_idle(&entry, used);
+    usize const undecayed = scavenger_scan(&scavenger);
+    assert(undecayed == 0);
+
+    // Once the usage decays, the pages above the new high-water mark are released.
+    scavenger_resume(&entry);
+    u8* const block = arena_alloc(arena, 8 * page_size - 1);
+    assert(block);
+    used = arena->offset;
+    arena_clear(arena);
+    scavenger_idle(&entry, used);
+    usize const released = scavenger_scan(&scavenger);
+    usize const again    = scavenger_scan(&scavenger);
+    assert(released == (SCAVENGER_TEST_PAGES - 8) * page_size && again == 0);
+
+    for (usize i = 0; i < 8 * page_size; ++i) {
+        assert(arena->buf[i] == 0xCD);
+    }
+    for (usize i = 8 * page_size; i < arena->capacity; ++i) {
+        assert(arena->buf[i] == 0);
+    }
+
+    scavenger_unregister(&scavenger, &entry);
+    scavenger_destroy(&scavenger);
+    vm_arena_destroy(&vm_arena);
+    printf("Test `scavenger_releases_above_high_water` passed.\n");
+}
+
+/// Stamp the first and last words of each page of the range.
+static void scavenger_stamp_pages(u8* mem, usize page_count, u64 stamp) {
+    usize const page_size = vmem_page_size();
+    for (usize page = 0; page < page_count; ++page) {
+        u64* words                         = (u64*)(mem + page * page_size);
+        words[0]                           = stamp;
+        words[page_size / sizeof(u64) - 1] = stamp;
+    }
+}
+
+static void scavenger_check_pages(u8 const* mem, usize page_count, u64 stamp) {
+    usize const page_size = vmem_page_size();
+    for (usize page = 0; page < page_count; ++page) {
+        u64 const* words   = (u64 const*)(mem + page * page_size);
+        bool const stamped = words[0] == stamp && words[page_size / sizeof(u64) - 1] == stamp;
+        assert(stamped);
+    }
+}
+
+static void scavenger_background_keeps_live_memory(void) {
+    usize const     page_size = vmem_page_size();
+    struct vm_arena vm_arena;
+    bool const      mapped =
+        vm_arena_create(&vm_arena, SCAVENGER_TEST_PAGES * page_size, VM_ARENA_DEFAULT);
+    assert(mapped);
+    struct arena* arena = &vm_arena.arena;
+
+    struct scavenger scavenger;
+    scavenger_init(&scavenger, (struct scavenger_config){.period_ms = 0, .decay_ms = 0});
+    struct scavenger_entry entry;
+    scavenger_register(&scavenger, &entry, arena->buf, arena->capacity);
+    bool const started = scavenger_start(&scavenger);
+    assert(started);
+
+    // The memory used in an active period should survive both the period itself and the idle
+    // period that follows, while anything above may be released at any time.
+    u64   rng        = 0x9E3779B97F4A7C15ull;
+    usize last_pages = 0;
+    for (u64 iter = 1; iter <= SCAVENGER_TEST_ITERATIONS; ++iter) {
+        scavenger_check_pages(arena->buf, last_pages, iter - 1);
+
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        usize const pages = 1 + (usize)(rng % SCAVENGER_TEST_PAGES);
+
+        u8* mem = arena_alloc_aligned(arena, pages * page_size, (u32)page_size);
+        assert(mem == arena->buf);
+        scavenger_stamp_pages(mem, pages, iter);
+        alloha_thread_yield();
+        scavenger_check_pages(mem, pages, iter);
+
+        usize const used = arena->offset;
+        arena_clear(arena);
+        scavenger_idle(&entry, used);
+        alloha_thread_yield();
+        scavenger_resume(&entry);
+        last_pages = pages;
+    }
+
+    scavenger_stop(&scavenger);
+    scavenger_unregister(&scavenger, &entry);
+    scavenger_destroy(&scavenger);
+    vm_arena_destroy(&vm_arena);
+    printf("Test `scavenger_background_keeps_live_memory` passed.\n");
+}
+
+static void test_scavenger(void) {
+    scavenger_releases_above_high_water();
+    scavenger_background_keeps_live_memory();
+}
+
+#if !defined(ALLOHA_TEST_NO_MAIN)
+int main(void) {
+    test_scavenger();
+    return 0;
+}
+#endif
@@ -4,6 +4,7 @@
 
 #include <alloha/stack.h>
 
+#include <alloha/oom.h>
 #include <assert.h>
 #include <stdalign.h>
 #include <stdio.h>
@@ -176,9 +177,40 @@ static void stack_memory_stress_and_free(void) {
     printf("Test `stack_stress_and_free` passed.\n");
 }
 
+static void stack_clear_at_rejects_free_blocks(void) {
+    usize const buf_size = 256;
+    u8* const   buf      = (u8*)malloc(buf_size);
+
+    // An empty stack has no block to clear, not even at the start of its memory.
+    struct stack stack = stack_new(buf_size, buf);
+    alloha_clear_error();
+    bool const empty_cleared = stack_clear_at(&stack, stack.buf);
+    assert(!empty_cleared && alloha_last_error() == ALLOHA_ERROR_INVALID_BLOCK);
+    assert(stack.offset == 0 && stack.previous_offset == 0);
+
+    // Blocks are preceded by their header, so nothing below it can be a block.
+    u8* a1 = (u8*)stack_alloc(&stack, 16);
+    assert(a1);
+    usize const offset       = stack.offset;
+    bool const  below_header = stack_clear_at(&stack, stack.buf);
+    assert(!below_header);
+    assert(stack.offset == offset && stack.previous_offset == (usize)(a1 - stack.buf));
+
+    // The topmost block can be cleared once.
+    bool const cleared = stack_clear_at(&stack, a1);
+    assert(cleared && stack.offset == 0 && stack.previous_offset == 0);
+    bool const cleared_again = stack_clear_at(&stack, a1);
+    assert(!cleared_again && stack.offset == 0 && stack.previous_offset == 0);
+
+    alloha_clear_error();
+    free(buf);
+    printf("Test `stack_clear_at_rejects_free_blocks` passed.\n");
+}
+
 static void test_stack(void) {
     stack_offsets_reads_and_writes();
     stack_memory_stress_and_free();
+    stack_clear_at_rejects_free_blocks();
 }
 
 #if !defined(ALLOHA_TEST_NO_MAIN)
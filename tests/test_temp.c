@@ -0,0 +1,104 @@
+/// Thread-local temporary stack tests.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/temp.h>
+
+#include <alloha/core.h>
+#include <alloha/oom.h>
+#include <alloha/thread.h>
+#include <alloha/vmem.h>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+/// Hot function using temporaries sized by its input, way past what `alloca` could afford.
+static u64 temp_sum_of_squares(u32 count) {
+    usize const mark = alloha_temp_mark();
+    u64*        tmp  = (u64*)alloha_temp_push(count * sizeof(u64), alloha_alignof(u64));
+    assert(tmp && ((uptr)tmp & (alloha_alignof(u64) - 1)) == 0);
+    for (u32 i = 0; i < count; ++i) {
+        tmp[i] = (u64)i * i;
+    }
+    u64 sum = 0;
+    for (u32 i = 0; i < count; ++i) {
+        sum += tmp[i];
+    }
+    alloha_temp_pop_to(mark);
+    return sum;
+}
+
+static int temp_worker_run(void* arg) {
+    u8** first = (u8**)arg;
+
+    // Each thread reserves its own temporary stack on its first push.
+    assert(!alloha_temp_arena.buf);
+    *first = alloha_temp_push(64, 64);
+    assert(*first && ((uptr)*first & 63) == 0);
+    memset(*first, 0x3C, 64);
+    alloha_temp_pop_to(0);
+    alloha_temp_release();
+    return 0;
+}
+
+static void temp_push_pop_marks(void) {
+    usize const mapped = vmem_stats().mapped_bytes;
+
+    u8* block = alloha_temp_push(100, 1);
+    assert(block && alloha_temp_arena.capacity == ALLOHA_TEMP_CAPACITY);
+    assert(vmem_stats().mapped_bytes == mapped + ALLOHA_TEMP_CAPACITY);
+
+    // Marks nest like the frames of the system stack.
+    usize const outer = alloha_temp_mark();
+    u8*         a     = alloha_temp_push(10, 16);
+    assert(a && ((uptr)a & 15) == 0 && a > block);
+    {
+        usize const inner  = alloha_temp_mark();
+        u8* const   nested = alloha_temp_push(1000, 8);
+        assert(nested);
+        alloha_temp_pop_to(inner);
+    }
+    assert(alloha_temp_mark() == outer + (usize)(a - block - 100) + 10);
+    alloha_temp_pop_to(outer);
+    u8* const again = alloha_temp_push(10, 16);
+    assert(again == a);
+    alloha_temp_pop_to(outer);
+
+    // Large temporaries, and more than fits.
+    u32 const count = 1 << 20;
+    u64 const sum   = temp_sum_of_squares(count);
+    assert(sum == (u64)(count - 1) * count * (2 * (u64)count - 1) / 6);
+    assert(alloha_temp_mark() == outer);
+
+    struct alloha_oom_policy const quiet = {.action = ALLOHA_OOM_RETURN_NULL, .quiet = true};
+    alloha_temp_arena.oom                = &quiet;
+    alloha_clear_error();
+    u8* const too_large = alloha_temp_push(ALLOHA_TEMP_CAPACITY, 1);
+    assert(!too_large);
+    assert(alloha_last_error() == ALLOHA_ERROR_OUT_OF_MEMORY && alloha_temp_mark() == outer);
+
+    u8*                  first = NULL;
+    struct alloha_thread thread;
+    bool const           created = alloha_thread_create(&thread, temp_worker_run, &first);
+    assert(created);
+    alloha_thread_join(&thread);
+    assert(first && first != block && block[0] != 0x3C);
+
+    alloha_temp_release();
+    assert(!alloha_temp_arena.buf && alloha_temp_arena.oom == &quiet);
+    assert(vmem_stats().mapped_bytes == mapped);
+    alloha_temp_arena.oom = NULL;
+
+    printf("Test `temp_push_pop_marks` passed.\n");
+}
+
+static void test_temp(void) {
+    temp_push_pop_marks();
+}
+
+#if !defined(ALLOHA_TEST_NO_MAIN)
+int main(void) {
+    test_temp();
+    return 0;
+}
+#endif
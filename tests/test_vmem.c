@@ -0,0 +1,60 @@
+/// Virtual memory utilities tests.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/vmem.h>
+
+#include <assert.h>
+#include <stdio.h>
+
+static void vmem_alloc_zeroed_and_aligned(void) {
+    usize const page_size = vmem_page_size();
+    assert(alloha_is_power_of_two(page_size));
+
+    usize const size = 3 * page_size + 17;
+    u8*         mem  = vmem_alloc(size, VMEM_POPULATE);
+    assert(mem);
+    assert(((uptr)mem & (page_size - 1)) == 0);
+    for (usize i = 0; i < size; ++i) {
+        assert(mem[i] == 0);
+    }
+
+    vmem_free(mem, size);
+    printf("Test `vmem_alloc_zeroed_and_aligned` passed.\n");
+}
+
+static void vmem_prefault_keeps_contents(void) {
+    usize const page_size = vmem_page_size();
+    usize const size      = 64 * page_size;
+    u8*         mem       = vmem_alloc(size, VMEM_DEFAULT);
+    assert(mem);
+
+    // Write to some of the pages, leaving the others untouched.
+    for (usize page = 0; page < 64; page += 3) {
+        mem[page * page_size + 7] = (u8)(page + 1);
+    }
+
+    // Pre-fault an unaligned range, both with a single and many threads.
+    vmem_prefault(mem + 5, size - 10, 1);
+    vmem_prefault(mem, size, 4);
+
+    for (usize page = 0; page < 64; ++page) {
+        u8 const expected = (page % 3 == 0) ? (u8)(page + 1) : 0;
+        assert(mem[page * page_size + 7] == expected);
+    }
+
+    vmem_free(mem, size);
+    printf("Test `vmem_prefault_keeps_contents` passed.\n");
+}
+
+static void test_vmem(void) {
+    vmem_alloc_zeroed_and_aligned();
+    vmem_prefault_keeps_contents();
+}
+
+#if !defined(ALLOHA_TEST_NO_MAIN)
+int main(void) {
+    test_vmem();
+    return 0;
+}
+#endif
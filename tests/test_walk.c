@@ -0,0 +1,246 @@
+/// Heap walking and allocation dump tests.
+///
+/// Author: Luiz G. Mugnaini A. <luizmugnaini@gmail.com>
+
+#include <alloha/walk.h>
+
+#include <alloha/arena.h>
+#include <alloha/core.h>
+#include <alloha/gc.h>
+#include <alloha/stack.h>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define WALK_MAX_BLOCKS 16
+
+struct walk_record {
+    struct alloha_block blocks[WALK_MAX_BLOCKS];
+    usize               count;
+    usize               limit;  ///< Amount of blocks after which the walk is stopped.
+};
+
+static bool walk_record_block(struct alloha_block const* block, void* user_data) {
+    struct walk_record* record = (struct walk_record*)user_data;
+    assert(record->count < WALK_MAX_BLOCKS);
+    record->blocks[record->count++] = *block;
+    return record->count < record->limit;
+}
+
+static void walk_stack_blocks(void) {
+    _Alignas(64) u8 buf[2048];
+    struct stack stack = stack_new(sizeof(buf), buf);
+
+    struct walk_record record = {.limit = WALK_MAX_BLOCKS};
+    usize const        none   = stack_walk(&stack, walk_record_block, &record);
+    assert(none == 0);
+
+    usize const sizes[]      = {24, 100, 8, 64, 3};
+    u32 const   alignments[] = {8, 64, 16, 32, 8};
+    u8*         blocks[5];
+    for (u32 i = 0; i < 5; ++i) {
+        blocks[i] = stack_alloc_aligned(&stack, sizes[i], alignments[i]);
+        assert(blocks[i]);
+    }
+
+    // Blocks are found from the most recent, and cover the whole used memory of the stack.
+    usize const all = stack_walk(&stack, walk_record_block, &record);
+    assert(all == 5 && record.count == 5);
+    usize used = 0;
+    for (u32 i = 0; i < 5; ++i) {
+        struct alloha_block const* block = &record.blocks[4 - i];
+        assert(block->memory == blocks[i] && block->offset == (usize)(blocks[i] - buf));
+        assert(block->size == sizes[i] && block->padding >= sizeof(struct stack_header));
+        used += block->padding + block->size;
+    }
+    assert(used == stack.offset);
+
+    // Walks stop when asked to.
+    record              = (struct walk_record){.limit = 2};
+    usize const stopped = stack_walk(&stack, walk_record_block, &record);
+    assert(stopped == 2);
+    assert(record.blocks[1].memory == blocks[3]);
+
+    // Freed blocks aren't found anymore.
+    bool const popped  = stack_pop(&stack);
+    bool const cleared = stack_clear_at(&stack, blocks[2]);
+    assert(popped && cleared);
+    record                = (struct walk_record){.limit = WALK_MAX_BLOCKS};
+    usize const remaining = stack_walk(&stack, walk_record_block, &record);
+    assert(remaining == 2);
+    assert(record.blocks[0].memory == blocks[1] && record.blocks[1].memory == blocks[0]);
+    printf("Test `walk_stack_blocks` passed.\n");
+}
+
+static void walk_gc_heap_objects(void) {
+    struct gc_heap heap;
+    bool const     created =
+        gc_heap_create(&heap, (struct gc_config){.space_capacity = 4096, .max_roots = 1});
+    assert(created);
+
+    struct gc_type const small = {.size = 8};
+    struct gc_type const large = {.size = 72};
+    u8* const            first = gc_alloc(&heap, &small);
+    u8* const            last  = gc_alloc(&heap, &large);
+
+    struct walk_record record = {.limit = WALK_MAX_BLOCKS};
+    usize const        live   = gc_heap_walk(&heap, walk_record_block, &record);
+    assert(live == 2);
+    assert(record.blocks[0].memory == first && record.blocks[0].size == 8);
+    assert(record.blocks[1].memory == last && record.blocks[1].size == 72);
+    assert(record.blocks[1].padding == sizeof(struct gc_header));
+
+    // Unreachable objects are gone after a collection.
+    gc_collect(&heap);
+    record                = (struct walk_record){.limit = WALK_MAX_BLOCKS};
+    usize const survivors = gc_heap_walk(&heap, walk_record_block, &record);
+    assert(survivors == 0);
+
+    gc_heap_destroy(&heap);
+    printf("Test `walk_gc_heap_objects` passed.\n");
+}
+
+/// Read back the whole contents of a temporary file.
+static usize walk_read_file(FILE* file, u8* buf, usize capacity) {
+    rewind(file);
+    usize const size = fread(buf, 1, capacity - 1, file);
+    buf[size]        = 0;
+    return size;
+}
+
+static void walk_dump_formats(void) {
+    _Alignas(16) u8 buf[1024];
+    struct stack stack = stack_new(sizeof(buf), buf);
+    u8* const    first = stack_alloc_aligned(&stack, 40, 16);
+    u8* const    last  = stack_alloc_aligned(&stack, 8, 8);
+    assert(first && last);
+
+    // JSON dumps list the blocks in the order of the walk.
+    FILE* file = tmpfile();
+    assert(file);
+    bool const json_dumped = stack_dump(&stack, file, ALLOHA_DUMP_JSON);
+    char        text[512];
+    usize const json_size = walk_read_file(file, (u8*)text, sizeof(text));
+    assert(json_dumped && json_size > 0);
+    fclose(file);
+
+    char expected[256];
+    snprintf(
+        expected,
+        sizeof(expected),
+        "\"capacity\":1024,\"used\":%zu,\"blocks\":[\n"
+        "{\"offset\":%zu,\"size\":8,\"padding\":%zu},\n"
+        "{\"offset\":%zu,\"size\":40,\"padding\":%zu}]}\n",
+        stack.offset,
+        (usize)(last - buf),
+        (usize)(last - first) - 40,
+        (usize)(first - buf),
+        (usize)(first - buf));
+    assert(strncmp(text, "{\"allocator\":\"stack\",\"address\":\"0x", 34) == 0);
+    assert(strstr(text, expected));
+
+    // Binary dumps hold a header followed by the blocks.
+    file = tmpfile();
+    assert(file);
+    bool const     binary_dumped = stack_dump(&stack, file, ALLOHA_DUMP_BINARY);
+    _Alignas(8) u8 data[256];
+    usize const    size = walk_read_file(file, data, sizeof(data));
+    fclose(file);
+    assert(binary_dumped);
+    assert(size == sizeof(struct alloha_dump_header) + 2 * sizeof(struct alloha_dump_block));
+
+    struct alloha_dump_header const* header = (struct alloha_dump_header const*)data;
+    assert(header->magic == ALLOHA_DUMP_MAGIC && header->version == ALLOHA_DUMP_VERSION);
+    assert(header->kind == ALLOHA_DUMP_STACK && header->address == (u64)(uptr)buf);
+    assert(header->capacity == 1024 && header->used == stack.offset && header->block_count == 2);
+    struct alloha_dump_block const* blocks = (struct alloha_dump_block const*)(header + 1);
+    assert(blocks[0].offset == (u64)(last - buf) && blocks[0].size == 8);
+    assert(blocks[1].offset == (u64)(first - buf) && blocks[1].size == 40);
+
+    // Untagged arenas only have their extents dumped.
+    struct arena arena = arena_new(sizeof(buf), buf);
+    u8* const    block = arena_alloc(&arena, 100);
+    assert(block);
+    file = tmpfile();
+    assert(file);
+    bool const  arena_dumped = arena_dump(&arena, file, ALLOHA_DUMP_JSON);
+    usize const arena_size   = walk_read_file(file, (u8*)text, sizeof(text));
+    assert(arena_dumped && arena_size > 0);
+    fclose(file);
+    assert(strstr(text, "\"allocator\":\"arena\""));
+    assert(strstr(text, "\"capacity\":1024,\"used\":100,\"blocks\":[]}\n"));
+    printf("Test `walk_dump_formats` passed.\n");
+}
+
+static void walk_arena_tags(void) {
+    _Alignas(64) u8   buf[256];
+    struct arena      arena = arena_new(sizeof(buf), buf);
+    struct arena_tag  records[4];
+    struct arena_tags tags   = {.tags = records, .capacity = 4};
+    bool const        tagged = arena_tag(&arena, &tags);
+
+#if defined(ALLOHA_ARENA_TAGGING)
+    u8* const first  = arena_alloc_aligned(&arena, 10, 1);
+    u8* const second = arena_alloc_aligned(&arena, 24, 16);
+    u8* const grown  = arena_realloc(&arena, second, 24, 40, 16);
+    assert(tagged && first == buf && second == buf + 16 && grown == second);
+
+    // Blocks are found in the order of their addresses, with the padding preceding them.
+    struct walk_record record = {.limit = WALK_MAX_BLOCKS};
+    usize const        both   = arena_walk(&arena, walk_record_block, &record);
+    assert(both == 2 && record.blocks[0].memory == first && record.blocks[1].memory == second);
+    assert(record.blocks[0].size == 10 && record.blocks[0].padding == 0);
+    assert(record.blocks[1].offset == 16 && record.blocks[1].size == 40);
+    assert(record.blocks[1].padding == 6);
+
+    // Blocks freed by a rewind aren't found anymore, and their records make room for new ones.
+    struct scratch_arena scratch = scratch_arena_start(&arena);
+    u8* const            freed   = arena_alloc_aligned(&arena, 8, 8);
+    scratch_arena_end(&scratch);
+    u8* const last = arena_alloc_aligned(&arena, 4, 64);
+    assert(freed == buf + 56 && last == buf + 64 && tags.count == 3);
+
+    record             = (struct walk_record){.limit = WALK_MAX_BLOCKS};
+    usize const blocks = arena_walk(&arena, walk_record_block, &record);
+    assert(blocks == 3 && record.blocks[2].memory == last && record.blocks[2].padding == 8);
+
+    // Blocks beyond the capacity of the table are dropped.
+    u8* const fourth = arena_alloc(&arena, 8);
+    u8* const fifth  = arena_alloc(&arena, 8);
+    assert(fourth && fifth && tags.count == 4 && tags.dropped == 1);
+
+    FILE* file = tmpfile();
+    assert(file);
+    bool const  dumped = arena_dump(&arena, file, ALLOHA_DUMP_JSON);
+    char        text[512];
+    usize const size = walk_read_file(file, (u8*)text, sizeof(text));
+    assert(dumped && size > 0);
+    fclose(file);
+    assert(strstr(text, "{\"offset\":16,\"size\":40,\"padding\":6},\n"));
+    assert(strstr(text, "{\"offset\":64,\"size\":4,\"padding\":8},\n"));
+#else
+    // Without tagging, arenas have no blocks to walk.
+    u8* const          block  = arena_alloc(&arena, 10);
+    struct walk_record record = {.limit = WALK_MAX_BLOCKS};
+    usize const        none   = arena_walk(&arena, walk_record_block, &record);
+    assert(!tagged && !arena.tags && block && none == 0);
+#endif
+
+    bool const untagged = arena_tag(&arena, NULL);
+    assert(!untagged && !arena.tags);
+    printf("Test `walk_arena_tags` passed.\n");
+}
+
+static void test_walk(void) {
+    walk_stack_blocks();
+    walk_gc_heap_objects();
+    walk_dump_formats();
+    walk_arena_tags();
+}
+
+#if !defined(ALLOHA_TEST_NO_MAIN)
+int main(void) {
+    test_walk();
+    return 0;
+}
+#endif